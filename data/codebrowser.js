@@ -81,6 +81,10 @@ $(function () {
     var start = new Date().getTime();
     var elapsed;
 
+    // With --blob-store, the footer is in the <page>.info.js of the page
+    if (typeof page_footer !== 'undefined')
+        $("#footer").html(page_footer);
+
     // ATTENTION: Keep in sync with C++ function of the same name in filesystem.cpp and `Generator::escapeAttrForFilename`
     var replace_invalid_filename_chars = function (str) {
         if(window.ecma_script_api_version && window.ecma_script_api_version >= 2) {
@@ -163,6 +167,68 @@ $(function () {
         return result;
     }
 
+    // The definition of a macro (with its continuation lines), from the line the href points to.
+    // Used when the pages were generated with --lazy-macro-expansions
+    function loadMacroDefinition(href, callback) {
+        var hashPos = href.indexOf("#");
+        var page = href.substr(0, hashPos);
+        var line = href.substr(hashPos + 1);
+        var extract = function(doc, isChunk) {
+            var th = doc.getElementById(line);
+            if (!th) {
+                // The line may be in a chunk of the page (see --chunk-lines)
+                var meta = doc.querySelector("meta[name='woboq:chunkLines']");
+                if (meta && !isChunk) {
+                    var n = Math.floor((parseInt(line) - 1) / parseInt(meta.content));
+                    var url = (page === "" ? root_path + "/" + file + ".html" : page);
+                    $.get(url.replace(/\.html$/, ".chunk" + n + ".html"), function(data) {
+                        extract(new DOMParser().parseFromString(data, "text/html"), true);
+                    }, "text");
+                }
+                return;
+            }
+            var definition = "";
+            for (var tr = th.parentNode; tr && definition.length < 30000; tr = tr.nextElementSibling) {
+                var td = tr.getElementsByTagName("td")[0];
+                if (!td)
+                    break;
+                definition += td.textContent + "\n";
+                if (!/\\\s*$/.test(td.textContent))
+                    break;
+            }
+            callback(definition);
+        };
+        if (page === "") {
+            extract(document);
+        } else {
+            $.get(page, function(data) {
+                extract(new DOMParser().parseFromString(data, "text/html"));
+            }, "text");
+        }
+    }
+
+    // The refs of the symbols of this page, fetched once from the bundle of the page
+    // (when generated with --refs-bundles). The refs that are not in there (too big,
+    // or past the size limit of the bundle) are fetched from refs/
+    var refsBundle;
+    if (typeof refs_bundle !== 'undefined' && refs_bundle) {
+        refsBundle = $.ajax({ url: root_path + "/" + file + ".refs", dataType: "json" });
+    }
+    function getRefs(url, bundleKey, callback) {
+        if (!refsBundle || !bundleKey) {
+            $.get(url, callback);
+            return;
+        }
+        refsBundle.done(function(bundle) {
+            if (Object.prototype.hasOwnProperty.call(bundle, bundleKey))
+                callback(bundle[bundleKey]);
+            else
+                $.get(url, callback);
+        }).fail(function() {
+            $.get(url, callback);
+        });
+    }
+
     // ident and highlight code (for macros)
     function identAndHighlightMacro(origin) {
 
@@ -396,15 +462,90 @@ $(function () {
 
     tooltip.init();
 
+/*-------------------------------------------------------------------------------------*/
+
+    // The pages of the very large files only have their first lines (--chunk-lines). Each
+    // next chunk of lines is an empty row of the table, replaced by the rows of the chunk
+    // file when it is scrolled to, or when an anchor that is not in the page is needed.
+    var chunkLines = parseInt($("meta[name='woboq:chunkLines']").attr("content"));
+    var pendingChunks = {}; // number -> the empty row
+    var loadingChunks = {}; // number -> the request
+    var chunkHandlers = []; // called with the rows of each chunk that is loaded
+    var onChunkLoaded = function(handler) { chunkHandlers.push(handler); }
+
+    $("tr.chunk").each(function() {
+        pendingChunks[$(this).attr("data-chunk")] = $(this);
+    });
+    if (!$.isEmptyObject(pendingChunks)) {
+        var rowHeight = $(".code tr").first().height() || 16;
+        $.each(pendingChunks, function(n, row) {
+            row.children().height(parseInt(row.attr("data-lines")) * rowHeight);
+        });
+    }
+
+    function loadChunk(n) {
+        if (!loadingChunks[n]) {
+            loadingChunks[n] = $.get(root_path + "/" + file + ".chunk" + n + ".html", function(data) {
+                var rows = $("<div/>").html(data).find("tr");
+                pendingChunks[n].replaceWith(rows);
+                delete pendingChunks[n];
+                chunkHandlers.forEach(function(handler) { handler(rows); });
+            }, "text");
+        }
+        return loadingChunks[n];
+    }
+
+    // Calls callback once the element with the id 'anchor' is in the page, if it exists.
+    // Called synchronously if no chunk needs to be loaded.
+    function whenAnchorLoaded(anchor, callback) {
+        if ($.isEmptyObject(pendingChunks) || document.getElementById(anchor)) {
+            callback();
+            return;
+        }
+        var requests;
+        if (/^\d+$/.test(anchor)) {
+            var n = Math.floor((parseInt(anchor) - 1) / chunkLines);
+            requests = n in pendingChunks ? [ loadChunk(n) ] : [];
+        } else {
+            // The definitions can be in any chunk
+            requests = $.map(pendingChunks, function(row, n) { return loadChunk(n); });
+        }
+        $.when.apply($, requests).always(callback);
+    }
+
+    var loadVisibleChunks = function() {
+        var top = $(window).scrollTop();
+        var height = $(window).height();
+        $.each(pendingChunks, function(n, row) {
+            var rowTop = row.offset().top;
+            // Also the ones one screen above or below
+            if (rowTop < top + 2 * height && rowTop + row.height() > top - height)
+                loadChunk(n);
+        });
+    }
+    if (!$.isEmptyObject(pendingChunks)) {
+        var chunkTimer = null;
+        $(window).on("scroll resize", function() {
+            if (!chunkTimer) {
+                chunkTimer = setTimeout(function() { chunkTimer = null; loadVisibleChunks(); }, 100);
+            }
+        });
+        loadVisibleChunks();
+    }
+
 /*-------------------------------------------------------------------------------------*/
 
     //highlight the line numbers of the warnings
-    $(".warning, .error").each(function() {
-        var t = $(this);
-        var l = t.parents("tr").find("th");
-        l.css( { "border-radius": 3, "background-color": t.css("border-bottom-color") });
-        l.attr("title", t.attr("title"));
-    } );
+    var highlightWarnings = function(rows) {
+        rows.find(".warning, .error").each(function() {
+            var t = $(this);
+            var l = t.parents("tr").find("th");
+            l.css( { "border-radius": 3, "background-color": t.css("border-bottom-color") });
+            l.attr("title", t.attr("title"));
+        } );
+    }
+    highlightWarnings($(document));
+    onChunkLoaded(highlightWarnings);
 
     // other highlighting stuff
     var highlighted_items;
@@ -419,25 +560,31 @@ $(function () {
 
     var anchor_id  = location.hash.substr(1); //Get the word after the hash from the url
     if (/^\d+$/.test(anchor_id)) {
-        highlighted_items = $("#" + anchor_id);
-        highlighted_items.addClass("highlight")
-        scrollToAnchor(anchor_id, false);
+        whenAnchorLoaded(anchor_id, function() {
+            highlighted_items = $("#" + anchor_id);
+            highlighted_items.addClass("highlight")
+            scrollToAnchor(anchor_id, false);
+        });
     } else if (/^\d+-\d+$/.test(anchor_id)) {
         var m = anchor_id.match(/^(\d+)-(\d+)$/);
         var a = parseInt(m[1]);
         var b = parseInt(m[2]);
-        if (a && b && a <= b) {
-            var select = "#" + a;
-            for (var x = a + 1; x <= b; ++x) {
-                select += ",#" + x;
+        whenAnchorLoaded("" + a, function() { whenAnchorLoaded("" + b, function() {
+            if (a && b && a <= b) {
+                var select = "#" + a;
+                for (var x = a + 1; x <= b; ++x) {
+                    select += ",#" + x;
+                }
             }
-        }
-        highlighted_items = $(select);
-        highlighted_items.addClass("highlight")
-        scrollToAnchor("" + a, false);
+            highlighted_items = $(select);
+            highlighted_items.addClass("highlight")
+            scrollToAnchor("" + a, false);
+        }); });
     } else if (anchor_id != "") {
-        highlight_items(anchor_id);
-        scrollToAnchor(anchor_id, false);
+        whenAnchorLoaded(anchor_id, function() {
+            highlight_items(anchor_id);
+            scrollToAnchor(anchor_id, false);
+        });
     }
 
 /*-------------------------------------------------------------------------------------*/
@@ -829,10 +976,18 @@ $(function () {
         }
 
         var tt = this;
+        if (isMacro && this.title_ === undefined && !this.definition_loaded && elem.attr("href")) {
+            this.definition_loaded = true;
+            loadMacroDefinition(elem.attr("href"), function(definition) {
+                tt.title_ = escape_html(definition);
+                if (tooltip.ref === ref)
+                    computeTooltipContent(tt.tooltip_data, tt.title_, tt.id);
+            });
+        }
         if (ref && !this.tooltip_loaded && !elem.hasClass("local") && !elem.hasClass("tu")
                 && !elem.hasClass("typedef") && !elem.hasClass("lbl")) {
             this.tooltip_loaded = true;
-            $.get(url, function(data) {
+            getRefs(url, proj ? undefined : replace_invalid_filename_chars(ref), function(data) {
                 tt.tooltip_data = data;
                 if (tooltip.ref === ref)
                     computeTooltipContent(data, tt.title_, tt.id);
@@ -1004,8 +1159,8 @@ $(function () {
         if (searchTerms)
             return;
         searchTerms = {}
-        var fileIndex = [];
-        var functionDict = {};
+        var fileTree = { dirs: undefined, pages: {}, buckets: {} };
+        var fnIndex = { counts: undefined, shardSize: 1, postings: {}, shards: {}, buckets: {} };
 
         // Do a google seatch of the text on the project.
         var text_search = function(text) {
@@ -1055,30 +1210,217 @@ $(function () {
             }
         };
 
-        var getFnNameKey = function (request) {
-            if (request.indexOf('/') != -1 || request.indexOf('.') != -1)
-                return false;
-            var mx = request.match(/::([^:]{2})[^:]*$/);
-            if (mx)
-                return mx[1].toLowerCase().replace(/[^a-z]/, '_');
-            request = request.replace(/^:*/, "");
-            if (request.length < 2)
-                return false;
-            var k = request.substr(0, 2).toLowerCase();
-            return k.replace(/[^a-z]/, '_')
+        // The function search uses the trigram index in fnIndex/ (see searchindex.h in the generator)
+        var fnNormalize = function(str) {
+            return str.toLowerCase().replace(/[^a-z0-9]/g, '_');
+        }
+
+        // The first letter of the words of the last component ("qsl" for QStringList)
+        var fnHumps = function(name) {
+            var pos = name.lastIndexOf("::");
+            if (pos >= 0)
+                name = name.slice(pos + 2);
+            var isUpper = function(c) { return c >= 'A' && c <= 'Z'; };
+            var humps = "";
+            for (var i = 0; i < name.length; ++i) {
+                var c = name.charAt(i);
+                var prev = name.charAt(i - 1);
+                if (i == 0 || (isUpper(c) && !isUpper(prev)) || (prev == '_' && c != '_'))
+                    humps += c;
+            }
+            return fnNormalize(humps);
+        }
+
+        // Fetch a file of the index, and search again when it arrived
+        var fnFetch = function(cache, key, url, parse) {
+            cache[key] = null; // loading
+            $.get(url, function(data) {
+                cache[key] = parse(data);
+                if (searchline.is(":focus")) {
+                    searchline.autocomplete("search", searchline.val());
+                }
+            }, "text");
+        }
+
+        // The terms too short to have a trigram are looked up in the fnSearch/ file of their
+        // first two letters, which has the functions whose name or one of the last two
+        // components starts with them.
+        var fnSearchShort = function(value) {
+            var prefix = value.replace(/^:*/, '');
+            if (prefix.length < 2)
+                return [];
+            var k = prefix.substr(0, 2).toLowerCase().replace(/[^a-z]/g, '_');
+            if (fnIndex.buckets[k] === undefined) {
+                fnFetch(fnIndex.buckets, k, root_path + '/fnSearch/' + k, function(data) {
+                    return data.split("\n");
+                });
+            }
+            var rx = new RegExp("(^|::)" + $.ui.autocomplete.escapeRegex(prefix), 'i');
+            var result = [];
+            var seen = {};
+            var lines = fnIndex.buckets[k] || [];
+            for (var i = 0; i < lines.length && result.length < 1000; ++i) {
+                var sep = lines[i].indexOf('|');
+                var name = lines[i].slice(sep + 1);
+                if (sep < 0 || seen[name] || !name.match(rx))
+                    continue;
+                seen[name] = true;
+                searchTerms[name] = { type:"ref", ref: lines[i].slice(0, sep) };
+                result.push(name);
+            }
+            return result;
+        }
+
+        // The functions whose name or humps contain the value, among the entries that were
+        // already fetched. Fetches what is missing.
+        var fnSearch = function(value) {
+            if (value.indexOf('/') != -1 || value.indexOf('.') != -1)
+                return [];
+            var term = fnNormalize(value.replace(/^:*/, ''));
+            if (term.length < 3)
+                return fnSearchShort(value);
+            if (!fnIndex.counts)
+                return [];
+            var trigrams = [];
+            for (var i = 0; i + 3 <= term.length; ++i)
+                trigrams.push(term.substr(i, 3));
+            var count = function(t) {
+                return Object.prototype.hasOwnProperty.call(fnIndex.counts, t) ? fnIndex.counts[t] : 0;
+            };
+            trigrams.sort(function(a, b) { return count(a) - count(b); });
+            if (!trigrams.length || !count(trigrams[0]))
+                return [];
+
+            // Intersect the two smallest postings
+            var postings = [];
+            for (var i = 0; i < 2 && i < trigrams.length; ++i) {
+                var t = trigrams[i];
+                if (fnIndex.postings[t] === undefined) {
+                    fnFetch(fnIndex.postings, t, root_path + '/fnIndex/t/' + t, function(data) {
+                        var ids = data.split(',');
+                        var id = 0;
+                        for (var j = 0; j < ids.length; ++j) {
+                            id += parseInt(ids[j], 36);
+                            ids[j] = id;
+                        }
+                        return ids;
+                    });
+                }
+                if (!fnIndex.postings[t])
+                    return [];
+                postings.push(fnIndex.postings[t]);
+            }
+            var ids = postings[0];
+            if (postings.length > 1) {
+                var a = postings[0], b = postings[1];
+                ids = [];
+                for (var i = 0, j = 0; i < a.length && j < b.length; ) {
+                    if (a[i] < b[j]) {
+                        ++i;
+                    } else if (a[i] > b[j]) {
+                        ++j;
+                    } else {
+                        ids.push(a[i]);
+                        ++i;
+                        ++j;
+                    }
+                }
+            }
+
+            var result = [];
+            var missing = 0;
+            var lastMissing = -1;
+            for (var i = 0; i < ids.length && result.length < 1000; ++i) {
+                var shard = Math.floor(ids[i] / fnIndex.shardSize);
+                var entries = fnIndex.shards[shard];
+                if (!entries) {
+                    if (entries === undefined) {
+                        fnFetch(fnIndex.shards, shard, root_path + '/fnIndex/e/' + shard, function(data) {
+                            return data.split("\n");
+                        });
+                    }
+                    if (shard != lastMissing && ++missing >= 8)
+                        break; // the rest when those arrived
+                    lastMissing = shard;
+                    continue;
+                }
+                var line = entries[ids[i] % fnIndex.shardSize];
+                var sep = line.indexOf('|');
+                var name = line.slice(sep + 1);
+                // The trigrams may not be consecutive
+                if (fnNormalize(name).indexOf(term) == -1 && fnHumps(name).indexOf(term) == -1)
+                    continue;
+                searchTerms[name] = { type:"ref", ref: line.slice(0, sep) };
+                result.push(name);
+            }
+            return result;
+        }
+
+        // The files are searched with the index in fileTree/ (see searchindex.h in the generator)
+        // The paths that match rx, among the ones that were already fetched: the files whose name
+        // starts like the name being typed, or else the files of the directories that match the
+        // path being typed. Fetches what is missing.
+        var fileSearch = function(value, rx) {
+            var result = [];
+            var add = function(f) {
+                if (result.length < 1000 && f.match(rx)) {
+                    searchTerms[f] = { type:"file", file: f };
+                    result.push(f);
+                }
+            };
+            var split = value.lastIndexOf('/');
+            var name = value.slice(split + 1);
+            if (name.length >= 2) {
+                var k = name.substr(0, 2).toLowerCase().replace(/[^a-z]/g, '_');
+                if (fileTree.buckets[k] === undefined) {
+                    fnFetch(fileTree.buckets, k, root_path + '/fileTree/n/' + k, function(data) {
+                        return data.split("\n");
+                    });
+                }
+                (fileTree.buckets[k] || []).forEach(function(f) { if (f) add(f); });
+                return result;
+            }
+            if (split < 0)
+                return result;
+            if (fileTree.dirs === undefined) {
+                fnFetch(fileTree, "dirs", root_path + '/fileTree/dirs', function(data) {
+                    return data.split("\n");
+                });
+            }
+            if (!fileTree.dirs)
+                return result;
+            var rxDir = new RegExp($.ui.autocomplete.escapeRegex(value.slice(0, split + 1)), 'i');
+            var missing = 0;
+            for (var i = 0; i < fileTree.dirs.length && result.length < 1000; ++i) {
+                var dir = fileTree.dirs[i];
+                if (!dir || !(dir + "/").match(rxDir))
+                    continue;
+                var page = fileTree.pages[i];
+                if (!page) {
+                    if (page === undefined) {
+                        fnFetch(fileTree.pages, i, root_path + '/fileTree/d/' + i, function(data) {
+                            return data.split("\n");
+                        });
+                    }
+                    if (++missing >= 8)
+                        break; // the rest when those arrived
+                    continue;
+                }
+                var prefix = dir == "." ? "" : dir + "/";
+                page.forEach(function(f) { if (f) add(prefix + f); });
+            }
+            return result;
         }
 
         var autocomplete = function(request, response) {
             var term = $.ui.autocomplete.escapeRegex(request.term);
             var rx1 = new RegExp(term, 'i');
             var rx2 = new RegExp("(^|::)"+term.replace(/^:*/, ''), 'i');
-            var functionList = [];
-            var k = getFnNameKey(request.term)
-            if (k && Object.prototype.hasOwnProperty.call(functionDict,k)) {
-                functionList = functionDict[k].filter(
-                    function(word) { return word.match(rx2) });
-            }
-            var l = fileIndex.filter( function(word) { return word.match(rx1); });
+            var functionList = fnSearch(request.term);
+            // The ones that start with the term first
+            functionList = functionList.filter(function(word) { return word.match(rx2) }).concat(
+                functionList.filter(function(word) { return !word.match(rx2) }));
+            var l = fileSearch(request.term, rx1);
             l = l.concat(functionList);
             l = l.slice(0,1000); // too big lists are too slow
             response(l);
@@ -1093,27 +1435,18 @@ $(function () {
             }
         });
 
-        // When the content changes, fetch the list of function that starts with ...
-        searchline.on('input', function() {
-            var value = $(this).val();
-            var k = getFnNameKey(value);
-            if (k && !Object.prototype.hasOwnProperty.call(functionDict, k)) {
-                functionDict[k] = []
-                $.get(root_path + '/fnSearch/' + k, function(data) {
-                    var list = data.split("\n");
-                    for (var i = 0; i < list.length; ++i) {
-                        var sep = list[i].indexOf('|');
-                        var ref = list[i].slice(0, sep);
-                        var name = list[i].slice(sep+1);
-                        searchTerms[name] = { type:"ref", ref: ref };
-                        functionDict[k].push(name);
-                    }
-                    if (searchline.is(":focus")) {
-                        searchline.autocomplete("search", searchline.val());
-                    }
-                });
+        // The number of entries of each trigram, to know which postings to fetch
+        $.get(root_path + '/fnIndex/trigrams', function(data) {
+            var lines = data.split("\n");
+            var counts = {};
+            for (var i = 1; i < lines.length; ++i) {
+                var sep = lines[i].indexOf(' ');
+                if (sep > 0)
+                    counts[lines[i].slice(0, sep)] = parseInt(lines[i].slice(sep + 1));
             }
-        });
+            fnIndex.shardSize = parseInt(lines[0]);
+            fnIndex.counts = counts;
+        }, "text");
 
         // Pasting should show the autocompletion
         searchline.on("paste", function() { setTimeout(function() {
@@ -1122,18 +1455,6 @@ $(function () {
         });
 //END
 
-        // Fetch the list of all files
-        $.get(root_path + '/fileIndex', function(data) {
-            var list = data.split("\n");
-            fileIndex = list;
-            for (var i = 0; i < list.length; ++i) {
-                searchTerms[list[i]] = { type:"file", file: list[i] };
-            }
-            if (searchline.is(":focus")) {
-                searchline.autocomplete("search", searchline.val());
-            }
-        });
-
         return false;
     });
 
@@ -1222,7 +1543,11 @@ $(function () {
 
     // fix scrolling to an anchor because of the header
     // isLink tells us if we are here because a link was cliked
-    function scrollToAnchor(anchor, isLink) {
+    function scrollToAnchor(anchor, isLink, loaded) {
+        if (!loaded && !document.getElementById(anchor)) {
+            whenAnchorLoaded(anchor, function() { scrollToAnchor(anchor, isLink, true); });
+            return;
+        }
         var target = $("#" + escape_selector(anchor));
         if (target.length) {
             //Smooth scrolling and let back go to the last location
@@ -1257,7 +1582,11 @@ $(function () {
     var isFirefox = typeof InstallTrigger != "undefined";
     if(isFirefox) {
         // Workaround Firefox selection bug with <q>, that would add fake quote in the clip board
-        $(".code q").replaceWith(function() { return $("<span class='string'/>").text($(this).text());  });
+        var replaceQuotes = function(rows) {
+            rows.find("q").replaceWith(function() { return $("<span class='string'/>").text($(this).text());  });
+        }
+        replaceQuotes($(".code"));
+        onChunkLoaded(replaceQuotes);
     }
 
 /*-------------------------------------------------------------------------------------*/
@@ -1266,31 +1595,39 @@ $(function () {
 
     // The definitions side bar
     var dfns = document.getElementsByClassName('def');
-    if (dfns.length) {
-        var dfnsDiv = $('<div id="symbolSideBox" class="sideBox"><h3>Definitions</h3><ul></ul></div>');
-        dfnsDiv.find('h3').click(function() {
-            var hidden = !$("#symbolSideBox ul").toggle().is(":visible");
-            createCookie('symboxhid', hidden, 5);
-        });
-        dfnsDiv.attr("style", "top:" + document.getElementById('header').clientHeight + "px;");
+    var showDefinitions = function() {
+        if (!dfns.length)
+            return;
+        var dfnsDiv = $("#symbolSideBox");
+        if (!dfnsDiv.length) {
+            dfnsDiv = $('<div id="symbolSideBox" class="sideBox"><h3>Definitions</h3><ul></ul></div>');
+            dfnsDiv.find('h3').click(function() {
+                var hidden = !$("#symbolSideBox ul").toggle().is(":visible");
+                createCookie('symboxhid', hidden, 5);
+            });
+            dfnsDiv.attr("style", "top:" + document.getElementById('header').clientHeight + "px;");
+
+            $('#allSideBoxes').append(dfnsDiv);
+
+            if (readCookie('symboxhid') === "true")
+                $("#symbolSideBox ul").hide()
+        }
 
         var theUl = dfnsDiv.find('ul');
         var html = "";
         for (var i = 0; i < dfns.length - 1; ++i) {
             html += '<li><a href="#' + dfns[i].id + '" title="'+ dfns[i].title+ '" data-ref="'+ dfns[i].id +'">'+escape_html(dfns[i].textContent) +'</a></li>';
         }
-        theUl.append(html);
-
-        $('#allSideBoxes').append(dfnsDiv);
+        theUl.html(html);
 
         var links = $("#symbolSideBox ul li a");
         links.on({"mouseenter": onMouseEnterRef,
                     "mouseleave": onMouseLeave
                     , "click": applyTo(onMouseEnterRef) });
-
-        if (readCookie('symboxhid') === "true")
-            $("#symbolSideBox ul").hide()
     }
+    showDefinitions();
+    // The list is made again, to keep the order of the page
+    onChunkLoaded(showDefinitions);
 
 
     var historylog = [];
@@ -1368,9 +1705,6 @@ $(function () {
     }
 
 
-    // Pre-fetch index. The XMLHttpRequest above will take it from browser cache then
-    $("head").append('<link rel="prefetch" href="'+root_path + '/fileIndex'+'">');
-
 /*-------------------------------------------------------------------------------------*/
     // End: print the time that was required to execute the code browser javascript
     elapsed = new Date().getTime() - start;
@@ -53,9 +53,9 @@ $(function() {
         window.location = "http://google.com/search?sitesearch=" + encodeURIComponent(location) + "&q=" + encodeURIComponent(text);
     }
 
-    var fileIndex = [];
+    var fileTree = { dirs: undefined, pages: {}, buckets: {} };
     var searchTerms = {}
-    var functionDict = {};
+    var fnIndex = { counts: undefined, shardSize: 1, postings: {}, shards: {}, buckets: {} };
     var file = path;
 
     var searchline = $("input#searchline");
@@ -98,30 +98,217 @@ $(function() {
             }
         };
 
-        var getFnNameKey = function (request) {
-            if (request.indexOf('/') != -1 || request.indexOf('.') != -1)
-                return false;
-            var mx = request.match(/::([^:]{2})[^:]*$/);
-            if (mx)
-                return mx[1].toLowerCase().replace(/[^a-z]/, '_');
-            request = request.replace(/^:*/, "");
-            if (request.length < 2)
-                return false;
-            var k = request.substr(0, 2).toLowerCase();
-            return k.replace(/[^a-z]/, '_')
+        // The function search uses the trigram index in fnIndex/ (see searchindex.h in the generator)
+        var fnNormalize = function(str) {
+            return str.toLowerCase().replace(/[^a-z0-9]/g, '_');
+        }
+
+        // The first letter of the words of the last component ("qsl" for QStringList)
+        var fnHumps = function(name) {
+            var pos = name.lastIndexOf("::");
+            if (pos >= 0)
+                name = name.slice(pos + 2);
+            var isUpper = function(c) { return c >= 'A' && c <= 'Z'; };
+            var humps = "";
+            for (var i = 0; i < name.length; ++i) {
+                var c = name.charAt(i);
+                var prev = name.charAt(i - 1);
+                if (i == 0 || (isUpper(c) && !isUpper(prev)) || (prev == '_' && c != '_'))
+                    humps += c;
+            }
+            return fnNormalize(humps);
+        }
+
+        // Fetch a file of the index, and search again when it arrived
+        var fnFetch = function(cache, key, url, parse) {
+            cache[key] = null; // loading
+            $.get(url, function(data) {
+                cache[key] = parse(data);
+                if (searchline.is(":focus")) {
+                    searchline.autocomplete("search", searchline.val());
+                }
+            }, "text");
+        }
+
+        // The terms too short to have a trigram are looked up in the fnSearch/ file of their
+        // first two letters, which has the functions whose name or one of the last two
+        // components starts with them.
+        var fnSearchShort = function(value) {
+            var prefix = value.replace(/^:*/, '');
+            if (prefix.length < 2)
+                return [];
+            var k = prefix.substr(0, 2).toLowerCase().replace(/[^a-z]/g, '_');
+            if (fnIndex.buckets[k] === undefined) {
+                fnFetch(fnIndex.buckets, k, root_path + '/fnSearch/' + k, function(data) {
+                    return data.split("\n");
+                });
+            }
+            var rx = new RegExp("(^|::)" + $.ui.autocomplete.escapeRegex(prefix), 'i');
+            var result = [];
+            var seen = {};
+            var lines = fnIndex.buckets[k] || [];
+            for (var i = 0; i < lines.length && result.length < 1000; ++i) {
+                var sep = lines[i].indexOf('|');
+                var name = lines[i].slice(sep + 1);
+                if (sep < 0 || seen[name] || !name.match(rx))
+                    continue;
+                seen[name] = true;
+                searchTerms[name] = { type:"ref", ref: lines[i].slice(0, sep) };
+                result.push(name);
+            }
+            return result;
+        }
+
+        // The functions whose name or humps contain the value, among the entries that were
+        // already fetched. Fetches what is missing.
+        var fnSearch = function(value) {
+            if (value.indexOf('/') != -1 || value.indexOf('.') != -1)
+                return [];
+            var term = fnNormalize(value.replace(/^:*/, ''));
+            if (term.length < 3)
+                return fnSearchShort(value);
+            if (!fnIndex.counts)
+                return [];
+            var trigrams = [];
+            for (var i = 0; i + 3 <= term.length; ++i)
+                trigrams.push(term.substr(i, 3));
+            var count = function(t) {
+                return Object.prototype.hasOwnProperty.call(fnIndex.counts, t) ? fnIndex.counts[t] : 0;
+            };
+            trigrams.sort(function(a, b) { return count(a) - count(b); });
+            if (!trigrams.length || !count(trigrams[0]))
+                return [];
+
+            // Intersect the two smallest postings
+            var postings = [];
+            for (var i = 0; i < 2 && i < trigrams.length; ++i) {
+                var t = trigrams[i];
+                if (fnIndex.postings[t] === undefined) {
+                    fnFetch(fnIndex.postings, t, root_path + '/fnIndex/t/' + t, function(data) {
+                        var ids = data.split(',');
+                        var id = 0;
+                        for (var j = 0; j < ids.length; ++j) {
+                            id += parseInt(ids[j], 36);
+                            ids[j] = id;
+                        }
+                        return ids;
+                    });
+                }
+                if (!fnIndex.postings[t])
+                    return [];
+                postings.push(fnIndex.postings[t]);
+            }
+            var ids = postings[0];
+            if (postings.length > 1) {
+                var a = postings[0], b = postings[1];
+                ids = [];
+                for (var i = 0, j = 0; i < a.length && j < b.length; ) {
+                    if (a[i] < b[j]) {
+                        ++i;
+                    } else if (a[i] > b[j]) {
+                        ++j;
+                    } else {
+                        ids.push(a[i]);
+                        ++i;
+                        ++j;
+                    }
+                }
+            }
+
+            var result = [];
+            var missing = 0;
+            var lastMissing = -1;
+            for (var i = 0; i < ids.length && result.length < 1000; ++i) {
+                var shard = Math.floor(ids[i] / fnIndex.shardSize);
+                var entries = fnIndex.shards[shard];
+                if (!entries) {
+                    if (entries === undefined) {
+                        fnFetch(fnIndex.shards, shard, root_path + '/fnIndex/e/' + shard, function(data) {
+                            return data.split("\n");
+                        });
+                    }
+                    if (shard != lastMissing && ++missing >= 8)
+                        break; // the rest when those arrived
+                    lastMissing = shard;
+                    continue;
+                }
+                var line = entries[ids[i] % fnIndex.shardSize];
+                var sep = line.indexOf('|');
+                var name = line.slice(sep + 1);
+                // The trigrams may not be consecutive
+                if (fnNormalize(name).indexOf(term) == -1 && fnHumps(name).indexOf(term) == -1)
+                    continue;
+                searchTerms[name] = { type:"ref", ref: line.slice(0, sep) };
+                result.push(name);
+            }
+            return result;
+        }
+
+        // The files are searched with the index in fileTree/ (see searchindex.h in the generator)
+        // The paths that match rx, among the ones that were already fetched: the files whose name
+        // starts like the name being typed, or else the files of the directories that match the
+        // path being typed. Fetches what is missing.
+        var fileSearch = function(value, rx) {
+            var result = [];
+            var add = function(f) {
+                if (result.length < 1000 && f.match(rx)) {
+                    searchTerms[f] = { type:"file", file: f };
+                    result.push(f);
+                }
+            };
+            var split = value.lastIndexOf('/');
+            var name = value.slice(split + 1);
+            if (name.length >= 2) {
+                var k = name.substr(0, 2).toLowerCase().replace(/[^a-z]/g, '_');
+                if (fileTree.buckets[k] === undefined) {
+                    fnFetch(fileTree.buckets, k, root_path + '/fileTree/n/' + k, function(data) {
+                        return data.split("\n");
+                    });
+                }
+                (fileTree.buckets[k] || []).forEach(function(f) { if (f) add(f); });
+                return result;
+            }
+            if (split < 0)
+                return result;
+            if (fileTree.dirs === undefined) {
+                fnFetch(fileTree, "dirs", root_path + '/fileTree/dirs', function(data) {
+                    return data.split("\n");
+                });
+            }
+            if (!fileTree.dirs)
+                return result;
+            var rxDir = new RegExp($.ui.autocomplete.escapeRegex(value.slice(0, split + 1)), 'i');
+            var missing = 0;
+            for (var i = 0; i < fileTree.dirs.length && result.length < 1000; ++i) {
+                var dir = fileTree.dirs[i];
+                if (!dir || !(dir + "/").match(rxDir))
+                    continue;
+                var page = fileTree.pages[i];
+                if (!page) {
+                    if (page === undefined) {
+                        fnFetch(fileTree.pages, i, root_path + '/fileTree/d/' + i, function(data) {
+                            return data.split("\n");
+                        });
+                    }
+                    if (++missing >= 8)
+                        break; // the rest when those arrived
+                    continue;
+                }
+                var prefix = dir == "." ? "" : dir + "/";
+                page.forEach(function(f) { if (f) add(prefix + f); });
+            }
+            return result;
         }
 
         var autocomplete = function(request, response) {
             var term = $.ui.autocomplete.escapeRegex(request.term);
             var rx1 = new RegExp(term, 'i');
             var rx2 = new RegExp("(^|::)"+term.replace(/^:*/, ''), 'i');
-            var functionList = [];
-            var k = getFnNameKey(request.term)
-            if (k && Object.prototype.hasOwnProperty.call(functionDict,k)) {
-                functionList = functionDict[k].filter(
-                    function(word) { return word.match(rx2) });
-            }
-            var l = fileIndex.filter( function(word) { return word.match(rx1); });
+            var functionList = fnSearch(request.term);
+            // The ones that start with the term first
+            functionList = functionList.filter(function(word) { return word.match(rx2) }).concat(
+                functionList.filter(function(word) { return !word.match(rx2) }));
+            var l = fileSearch(request.term, rx1);
             l = l.concat(functionList);
             l = l.slice(0,1000); // too big lists are too slow
             response(l);
@@ -136,27 +323,18 @@ $(function() {
             }
         });
 
-        // When the content changes, fetch the list of function that starts with ...
-        searchline.on('input', function() {
-            var value = $(this).val();
-            var k = getFnNameKey(value);
-            if (k && !Object.prototype.hasOwnProperty.call(functionDict, k)) {
-                functionDict[k] = []
-                $.get(root_path + '/fnSearch/' + k, function(data) {
-                    var list = data.split("\n");
-                    for (var i = 0; i < list.length; ++i) {
-                        var sep = list[i].indexOf('|');
-                        var ref = list[i].slice(0, sep);
-                        var name = list[i].slice(sep+1);
-                        searchTerms[name] = { type:"ref", ref: ref };
-                        functionDict[k].push(name);
-                    }
-                    if (searchline.is(":focus")) {
-                        searchline.autocomplete("search", searchline.val());
-                    }
-                });
+        // The number of entries of each trigram, to know which postings to fetch
+        $.get(root_path + '/fnIndex/trigrams', function(data) {
+            var lines = data.split("\n");
+            var counts = {};
+            for (var i = 1; i < lines.length; ++i) {
+                var sep = lines[i].indexOf(' ');
+                if (sep > 0)
+                    counts[lines[i].slice(0, sep)] = parseInt(lines[i].slice(sep + 1));
             }
-        });
+            fnIndex.shardSize = parseInt(lines[0]);
+            fnIndex.counts = counts;
+        }, "text");
 
         // Pasting should show the autocompletion
         searchline.on("paste", function() { setTimeout(function() {
@@ -167,15 +345,10 @@ $(function() {
     //END  copied from codebrowser.js
 
 
-    $.get(root_path + '/fileIndex', function(data) {
-        var list = data.split("\n");
-        list.sort();
-
-        fileIndex = list;
-        for (var i = 0; i < list.length; ++i) {
-            searchTerms[list[i]] = { type:"file", file: list[i] };
-        }
-
+    // The sub directories come from fileTree/dirs, the files from the page of the directory
+    $.get(root_path + '/fileTree/dirs', function(data) {
+        var dirs = data.split("\n");
+        fileTree.dirs = dirs;
 
         function openFolder() {
             var t = $(this);
@@ -188,36 +361,53 @@ $(function() {
                 var subPath = path=="" ? p : p.substr(path.length);
                 t.text("[-]");
                 var content = $("<table/>");
-                var dict = {};
-                var toOpenNow = [];
-                for (var i=0; i < fileIndex.length; ++i) {
-                    var f = fileIndex[i];
-                    if (f.indexOf(p) == 0) {
-                        var sl = f.indexOf('/',  p.length + 1);
-
-                        if (sl !== -1) {
-                            var name = f.substr( p.length, sl - p.length);
+                var showContent = function(files) {
+                    if (!t.get(0)._opened)
+                        return; // closed meanwhile
+                    // Sorted like the paths, the folders are the name followed by '/'
+                    var entries = [];
+                    var dict = {};
+                    for (var i=0; i < dirs.length; ++i) {
+                        if (dirs[i].indexOf(p) == 0) {
+                            var sl = dirs[i].indexOf('/', p.length);
+                            var name = sl == -1 ? dirs[i].substr(p.length) : dirs[i].substr(p.length, sl - p.length);
                             if (dict[name])
                                 continue;
                             dict[name] = true;
+                            entries.push(name + "/");
+                        }
+                    }
+                    entries = entries.concat(files.filter(function(f) { return f.length; }));
+                    entries.sort();
+                    var toOpenNow = [];
+                    entries.forEach(function(entry) {
+                        if (entry.charAt(entry.length - 1) == '/') {
+                            var name = entry.slice(0, -1);
                             content.append("<tr><td class='folder'><a class='opener' data-path='" + p + name + "'  href='"+subPath + name+"'>[+]</a> " +
                                         "<a href='" + subPath + name + "/'>" + name + "/</a></td></tr>\n");
                             if (state[p+name])
                                 toOpenNow.push(p+name);
                         } else {
-                            var name = f.substr(p.length);
-                            content.append("<tr><td class='file'>    <a href='" + subPath + name + ".html'>" + name + "</a></td></tr>\n");
+                            content.append("<tr><td class='file'>    <a href='" + subPath + entry + ".html'>" + entry + "</a></td></tr>\n");
                         }
-                    }
+                    });
+                    content.find(".opener").click(openFolder);
+                    t.parent().append(content);
+                    toOpenNow.forEach(function(toOpen) {
+                        var e = $("a[data-path='"+toOpen+"']").get(0)
+                        if (e)
+                            openFolder.call(e);
+                    });
+                };
+                var page = dirs.indexOf(p.slice(0, -1));
+                if (page >= 0) {
+                    $.get(root_path + '/fileTree/d/' + page, function(data) {
+                        showContent(data.split("\n"));
+                    }, "text");
+                } else {
+                    showContent([]);
                 }
-                content.find(".opener").click(openFolder);
-                t.parent().append(content);
                 state[t.attr("data-path")]=true;
-                toOpenNow.forEach(function(toOpen) { 
-                    var e = $("a[data-path='"+toOpen+"']").get(0)
-                    if (e) 
-                        openFolder.call(e);
-                });
             } else {
                 t.parent().find("> table").empty();
                 t.text("[+]");
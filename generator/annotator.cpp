@@ -38,18 +38,28 @@
 #include <clang/Sema/Sema.h>
 #include <clang/Tooling/Tooling.h>
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include <time.h>
 
 #include <llvm/ADT/SmallString.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/Path.h>
 #include <llvm/Support/raw_ostream.h>
 
 #include "compat.h"
+#include "manifest.h"
+#include "memorybudget.h"
 #include "projectmanager.h"
+#include "refsbundles.h"
+#include "refsdatabase.h"
+#include "stats.h"
 #include "stringbuilder.h"
 
 namespace {
@@ -111,7 +121,7 @@ ssize_t getFieldOffset(const clang::Decl *decl) {
 
 } // namespace
 
-Annotator::~Annotator() {}
+Annotator::~Annotator() { projectManager.releaseClaims(this); }
 
 Annotator::Visibility Annotator::getVisibility(const clang::NamedDecl *decl) {
   if (llvm::isa<clang::EnumConstantDecl>(decl) ||
@@ -180,6 +190,46 @@ bool Annotator::shouldProcess(clang::FileID FID) {
   return it->second.first;
 }
 
+bool Annotator::canSkipDeclarations(clang::SourceRange range) {
+  if (range.isInvalid())
+    return false;
+  clang::SourceManager &sm = getSourceMgr();
+  clang::SourceLocation B = sm.getExpansionLoc(range.getBegin());
+  clang::SourceLocation E = sm.getExpansionLoc(range.getEnd());
+  // The files loaded from a precompiled header are not in includeOffsets
+  if (!sm.isLocalSourceLocation(B))
+    return false;
+  clang::FileID FID = sm.getFileID(B);
+  if (FID.isInvalid() || sm.getFileID(E) != FID || shouldProcess(FID))
+    return false;
+
+  if (!includeOffsetsBuilt) {
+    includeOffsetsBuilt = true;
+    // The first entry is a sentinel
+    for (unsigned i = 1, n = sm.local_sloc_entry_size(); i < n; ++i) {
+      const clang::SrcMgr::SLocEntry &entry = sm.getLocalSLocEntry(i);
+      if (!entry.isFile())
+        continue;
+      clang::SourceLocation includeLoc = entry.getFile().getIncludeLoc();
+      if (includeLoc.isInvalid() || !includeLoc.isFileID())
+        continue;
+      includeOffsets[sm.getFileID(includeLoc)].push_back(
+          sm.getFileOffset(includeLoc));
+    }
+    for (auto &it : includeOffsets)
+      std::sort(it.second.begin(), it.second.end());
+  }
+
+  // A file included within the range (as in a namespace) may be processed:
+  // its declarations are children of the ones of the range.
+  auto it = includeOffsets.find(FID);
+  if (it == includeOffsets.end())
+    return true;
+  auto include = std::lower_bound(it->second.begin(), it->second.end(),
+                                  sm.getFileOffset(B));
+  return include == it->second.end() || *include > sm.getFileOffset(E);
+}
+
 std::string Annotator::htmlNameForFile(clang::FileID id) {
   {
     auto it = cache.find(id);
@@ -198,7 +248,8 @@ std::string Annotator::htmlNameForFile(clang::FileID id) {
 
   ProjectInfo *project = projectManager.projectForFile(filename);
   if (project) {
-    bool should_process = projectManager.shouldProcess(filename, project);
+    bool should_process =
+        projectManager.shouldProcess(filename, project, this);
     project_cache[id] = project;
     std::string fn =
         project->name % "/" % filename.substr(project->source_path.size());
@@ -241,6 +292,81 @@ bool Annotator::generate(clang::Sema &Sema, bool WasInDatabase) {
   // make sure the main file is in the cache.
   htmlNameForFile(getSourceMgr().getMainFileID());
 
+  char buf[80];
+  {
+    // localtime is not reentrant
+    std::lock_guard<std::mutex> lock(projectManager.outputMutex);
+    auto now = time(0);
+    auto tm = localtime(&now);
+    strftime(buf, sizeof(buf), "%Y-%b-%d", tm);
+  }
+
+  // What this translation unit contributes, for the incremental generation
+  std::unique_ptr<Manifest::Record> record;
+  if (projectManager.manifest) {
+    record.reset(new Manifest::Record);
+    llvm::SmallString<256> mainFile;
+    canonicalize(
+        getSourceMgr().getFileEntryForID(getSourceMgr().getMainFileID())
+            ->getName(),
+        mainFile);
+    record->mainFile = mainFile.str();
+    record->commandFile = commandFile;
+    record->commandHash = commandHash;
+  }
+
+  // The pages are written once all of them are highlighted when they are
+  // written by several threads (see ProjectManager::pageJobs): the
+  // highlighting uses the Preprocessor and the SourceManager, which are not
+  // thread safe.
+  struct Page {
+    Generator *generator;
+    std::string fn;
+    std::string footer;
+    const llvm::MemoryBuffer *buffer;
+    const std::set<std::string> *interestingDefinitions;
+  };
+  std::vector<Page> pages;
+  const bool parallelPages = projectManager.pageJobs > 1;
+
+  // The memory used by this translation unit at its peak, for --max-memory:
+  // the AST and the buffers, with the tags once the pages are highlighted, or
+  // with the refs once they are built.
+  MemoryBudget *budget = projectManager.memoryBudget;
+  uint64_t peakMemory = 0;
+  auto sampleMemory = [&](size_t annotatorMemory) {
+    clang::ASTContext &Ctx = Sema.getASTContext();
+    clang::SourceManager &sm = getSourceMgr();
+    auto buffers = sm.getMemoryBufferSizes();
+    uint64_t bytes = Ctx.getASTAllocatedMemory() +
+                     Ctx.getSideTableAllocatedMemory() +
+                     sm.getDataStructureSizes() + buffers.malloc_bytes +
+                     buffers.mmap_bytes +
+                     Sema.getPreprocessor().getTotalMemory() + annotatorMemory;
+    peakMemory = std::max(peakMemory, bytes);
+  };
+  auto writePage = [&](Page &page) {
+    if (projectManager.refsBundles) {
+      projectManager.refsBundles->addPage(page.fn,
+                                          page.generator->bundledRefs());
+      page.generator->hasRefsBundle = true;
+    }
+    page.generator->chunkLines = projectManager.chunkLines;
+    page.generator->generate(
+        projectManager.outputPrefix, projectManager.dataPath, page.fn,
+        page.buffer->getBufferStart(), page.buffer->getBufferEnd(),
+        page.footer,
+        WasInDatabase
+            ? ""
+            : "Warning: That file was not part of the compilation database. "
+              "It may have many parsing errors.",
+        *page.interestingDefinitions, projectManager.overlayPath);
+    // The page is written, its tags are not needed anymore
+    *page.generator = Generator();
+    ++projectManager.generatedPages;
+  };
+
+  std::vector<std::string> indexedFiles;
   std::set<std::string> done;
   for (auto it : cache) {
     if (!it.second.first)
@@ -265,7 +391,13 @@ bool Annotator::generate(clang::Sema &Sema, bool WasInDatabase) {
 
     Generator &g = generator(FID);
 
-    syntaxHighlight(g, FID, Sema);
+    {
+      Stats::Timer timer(Stats::SyntaxHighlight);
+      syntaxHighlight(g, FID, Sema);
+    }
+    if (budget)
+      sampleMemory(memoryUsage());
+    commentHandler.releaseFile(FID);
     //        clang::html::HighlightMacros(R, FID, PP);
 
     std::string footer;
@@ -275,11 +407,6 @@ bool Annotator::generate(clang::Sema &Sema, bool WasInDatabase) {
                "'>" % htmlNameForFile(mainFID) % "</a><br/>";
     }
 
-    auto now = time(0);
-    auto tm = localtime(&now);
-    char buf[80];
-    strftime(buf, sizeof(buf), "%Y-%b-%d", tm);
-
     const ProjectInfo &projectinfo = *project_it;
     footer %= "Generated on <em>" % std::string(buf) % "</em>" %
               " from project " % projectinfo.name;
@@ -291,54 +418,116 @@ bool Annotator::generate(clang::Sema &Sema, bool WasInDatabase) {
     Generator::escapeAttr(args)   <<"\"" */
 
     // Emit the HTML.
-    const llvm::MemoryBuffer *Buf = getSourceMgr().getBuffer(FID);
-    g.generate(
-        projectManager.outputPrefix, projectManager.dataPath, fn,
-        Buf->getBufferStart(), Buf->getBufferEnd(), footer,
-        WasInDatabase
-            ? ""
-            : "Warning: That file was not part of the compilation database. "
-              "It may have many parsing errors.",
-        interestingDefinitionsInFile[FID]);
+    pages.push_back({&g, fn, std::move(footer), getSourceMgr().getBuffer(FID),
+                     &interestingDefinitionsInFile[FID]});
+    if (!parallelPages) {
+      writePage(pages.back());
+      pages.clear();
+    }
+
+    if (record) {
+      llvm::SmallString<256> filename;
+      canonicalize(getSourceMgr().getFileEntryForID(FID)->getName(), filename);
+      record->generated.push_back({fn, filename.str()});
+    }
 
     if (projectinfo.type == ProjectInfo::Normal)
-      fileIndex << fn << '\n';
+      indexedFiles.push_back(fn);
+  }
+
+  // The tags of the pages that are written while the refs are built
+  size_t pagesMemory = 0;
+  if (budget) {
+    for (const auto &page : pages)
+      pagesMemory += page.generator->memoryUsage();
   }
 
+  // The threads write the pages while this thread builds the refs, then it
+  // helps them.
+  std::atomic<size_t> nextPage(0);
+  auto pageWorker = [&] {
+    for (size_t i = nextPage++; i < pages.size(); i = nextPage++)
+      writePage(pages[i]);
+  };
+  std::vector<std::thread> pageThreads;
+  for (unsigned i = 1; i < projectManager.pageJobs && i <= pages.size(); ++i)
+    pageThreads.emplace_back(pageWorker);
+
+  if (record) {
+    record->fileIndex = indexedFiles;
+    clang::SourceManager &sm = getSourceMgr();
+    for (auto it = sm.fileinfo_begin(); it != sm.fileinfo_end(); ++it) {
+      bool invalid = false;
+      const llvm::MemoryBuffer *buffer =
+          sm.getMemoryBufferForFile(it->first, &invalid);
+      if (invalid || !buffer)
+        continue;
+      llvm::SmallString<256> filename;
+      canonicalize(it->first->getName(), filename);
+      Manifest::Input input;
+      // The virtual files (the builtin includes) are not on the disk
+      if (Manifest::makeInput(filename, buffer->getBuffer(), input))
+        record->inputs.push_back(std::move(input));
+    }
+    // The files of the precompiled header are not all in the SourceManager
+    std::set<std::string> inputs;
+    for (const auto &input : record->inputs)
+      inputs.insert(input.path);
+    for (const auto &file : precompiledInputs) {
+      if (inputs.count(file))
+        continue;
+      auto buffer = llvm::MemoryBuffer::getFile(file);
+      if (!buffer)
+        continue;
+      Manifest::Input input;
+      if (Manifest::makeInput(file, (*buffer)->getBuffer(), input))
+        record->inputs.push_back(std::move(input));
+    }
+  }
+
+  Stats::Timer refsTimer(Stats::Refs);
   // make sure all the docs are in the references
   // (There might not be when the comment is in the .cpp file (for \class))
-  for (auto it : commentHandler.docs)
-    references[it.first];
-
-  create_directories(llvm::Twine(projectManager.outputPrefix, "/refs/_M"));
-  for (const auto &it : references) {
-    if (llvm::StringRef(it.first).startswith("__builtin"))
+  commentHandler.sortDocs();
+  for (const auto &it : commentHandler.docs)
+    symbol(it.first).referenced = true;
+
+  // In the order of the refs
+  std::vector<unsigned> referenced;
+  for (unsigned id = 0; id < symbols.size(); ++id) {
+    if (symbols[id].referenced)
+      referenced.push_back(id);
+  }
+  std::sort(referenced.begin(), referenced.end(),
+            [this](unsigned a, unsigned b) { return strings[a] < strings[b]; });
+
+  RefsDatabase::Chunk refsChunk;
+  size_t recordMemory = 0; // of the refEntries of the record
+  for (unsigned id : referenced) {
+    llvm::StringRef ref = strings[id];
+    const Symbol &sym = symbols[id];
+    if (ref.startswith("__builtin"))
       continue;
-    if (it.first == "main")
+    if (ref == "main")
       continue;
 
-    auto refFilename = it.first;
-    replace_invalid_filename_chars(refFilename);
-
-    std::string filename = projectManager.outputPrefix % "/refs/" % refFilename;
-#if CLANG_VERSION_MAJOR == 3 && CLANG_VERSION_MINOR <= 5
-    std::string error;
-    llvm::raw_fd_ostream myfile(filename.c_str(), error,
-                                llvm::sys::fs::F_Append);
-    if (!error.empty()) {
-      std::cerr << error << std::endl;
-      continue;
-    }
-#else
-    std::error_code error_code;
-    llvm::raw_fd_ostream myfile(filename, error_code, llvm::sys::fs::F_Append);
-    if (error_code) {
-      std::cerr << "Error writing ref file " << filename << ": "
-                << error_code.message() << std::endl;
-      continue;
-    }
-#endif
-    for (const auto &it2 : it.second) {
+    if (record)
+      record->refs.push_back(ref.str());
+    // The entries without a 'f' attribute are recorded in the manifest, so
+    // they can be removed when this translation unit is outdated
+    auto addEntry = [&](const RefsDatabase::Entry &entry) {
+      refsChunk.add(ref, entry);
+      Stats::count(Stats::References);
+      if (record && !entry.hasFile()) {
+        std::string text;
+        llvm::raw_string_ostream os(text);
+        RefsDatabase::render(os, entry);
+        record->refEntries.push_back({ref.str(), os.str()});
+        recordMemory += ref.size() + text.size() +
+                        sizeof(record->refEntries.front());
+      }
+    };
+    for (const auto &it2 : sym.references) {
       clang::SourceRange loc = it2.loc;
       clang::SourceManager &sm = getSourceMgr();
       clang::SourceLocation expBegin = sm.getExpansionLoc(loc.getBegin());
@@ -348,116 +537,142 @@ bool Annotator::generate(clang::Sema &Sema, bool WasInDatabase) {
         continue;
       clang::PresumedLoc fixedBegin = sm.getPresumedLoc(expBegin);
       clang::PresumedLoc fixedEnd = sm.getPresumedLoc(expEnd);
-      const char *tag = "";
-      char usetype = '\0';
+      RefsDatabase::Entry entry;
       switch (it2.what) {
       case Use:
       case Use_NestedName:
-        tag = "use";
+        entry.kind = RefsDatabase::Entry::Use;
         break;
       case Use_Address:
-        tag = "use";
-        usetype = 'a';
+        entry.kind = RefsDatabase::Entry::Use;
+        entry.useType = 'a';
         break;
       case Use_Call:
-        tag = "use";
-        usetype = 'c';
+        entry.kind = RefsDatabase::Entry::Use;
+        entry.useType = 'c';
         break;
       case Use_Read:
-        tag = "use";
-        usetype = 'r';
+        entry.kind = RefsDatabase::Entry::Use;
+        entry.useType = 'r';
         break;
       case Use_Write:
-        tag = "use";
-        usetype = 'w';
+        entry.kind = RefsDatabase::Entry::Use;
+        entry.useType = 'w';
         break;
       case Use_MemberAccess:
-        tag = "use";
-        usetype = 'm';
+        entry.kind = RefsDatabase::Entry::Use;
+        entry.useType = 'm';
         break;
       case Declaration:
-        tag = "dec";
+        entry.kind = RefsDatabase::Entry::Declaration;
         break;
       case Definition:
-        tag = "def";
+        entry.kind = RefsDatabase::Entry::Definition;
         break;
       case Override:
-        tag = "ovr";
+        entry.kind = RefsDatabase::Entry::Override;
         break;
       case Inherit:
-        tag = "inh";
+        entry.kind = RefsDatabase::Entry::Inherit;
       }
-      myfile << "<" << tag << " f='";
-      Generator::escapeAttr(myfile, fn);
-      myfile << "' l='" << fixedBegin.getLine() << "'";
+      entry.file = fn;
+      entry.line = fixedBegin.getLine();
       if (fixedEnd.isValid() && fixedBegin.getLine() != fixedEnd.getLine())
-        myfile << " ll='" << fixedEnd.getLine() << "'";
-      if (loc.getBegin().isMacroID())
-        myfile << " macro='1'";
-      if (!WasInDatabase)
-        myfile << " brk='1'";
-      if (usetype)
-        myfile << " u='" << usetype << "'";
-      const auto &refType = it2.typeOrContext;
-      if (!refType.empty()) {
-        myfile << ((it2.what < Use) ? " type='" : " c='");
-        Generator::escapeAttr(myfile, refType);
-        myfile << "'";
-      }
-      myfile << "/>\n";
+        entry.endLine = fixedEnd.getLine();
+      entry.macro = loc.getBegin().isMacroID();
+      entry.broken = !WasInDatabase;
+      entry.text = strings[it2.typeOrContext];
+      addEntry(entry);
     }
-    auto itS = structure_sizes.find(it.first);
-    if (itS != structure_sizes.end() && itS->second != -1) {
-      myfile << "<size>" << itS->second << "</size>\n";
+    if (sym.size != -1) {
+      RefsDatabase::Entry entry;
+      entry.kind = RefsDatabase::Entry::Size;
+      entry.value = sym.size;
+      addEntry(entry);
     }
-    auto itF = field_offsets.find(it.first);
-    if (itF != field_offsets.end() && itF->second != -1) {
-      myfile << "<offset>" << itF->second << "</offset>\n";
+    if (sym.offset != -1) {
+      RefsDatabase::Entry entry;
+      entry.kind = RefsDatabase::Entry::Offset;
+      entry.value = sym.offset;
+      addEntry(entry);
     }
-    auto range = commentHandler.docs.equal_range(it.first);
+    auto range = commentHandler.docsFor(id);
     for (auto it2 = range.first; it2 != range.second; ++it2) {
       clang::SourceManager &sm = getSourceMgr();
       clang::SourceLocation exp = sm.getExpansionLoc(it2->second.loc);
       clang::PresumedLoc fixed = sm.getPresumedLoc(exp);
       std::string fn = htmlNameForFile(sm.getFileID(exp));
-      myfile << "<doc f='";
-      Generator::escapeAttr(myfile, fn);
-      myfile << "' l='" << fixed.getLine() << "'>";
-      Generator::escapeAttr(myfile, it2->second.content);
-      myfile << "</doc>\n";
+      RefsDatabase::Entry entry;
+      entry.kind = RefsDatabase::Entry::Doc;
+      entry.file = fn;
+      entry.line = fixed.getLine();
+      entry.text = it2->second.content;
+      addEntry(entry);
     }
-    auto itU = sub_refs.find(it.first);
-    if (itU != sub_refs.end()) {
-      for (const auto &sub : itU->second) {
-        switch (sub.what) {
-        case SubRef::Function:
-          myfile << "<fun ";
-          break;
-        case SubRef::Member:
-          myfile << "<mbr ";
-          break;
-        case SubRef::Static:
-          myfile << "<smbr ";
-          break;
-        case SubRef::None:
-          continue; // should not happen
-        }
-        const auto &r = sub.ref;
-        myfile << "r='" << Generator::EscapeAttr{r} << "'";
-        auto itF = field_offsets.find(r);
-        if (itF != field_offsets.end() && itF->second != -1)
-          myfile << " o='" << itF->second << "'";
-        if (!sub.type.empty())
-          myfile << " t='" << Generator::EscapeAttr{sub.type} << "'";
-        myfile << "/>\n";
+    for (const auto &sub : sym.subRefs) {
+      RefsDatabase::Entry entry;
+      switch (sub.what) {
+      case SubRef::Function:
+        entry.kind = RefsDatabase::Entry::Function;
+        break;
+      case SubRef::Member:
+        entry.kind = RefsDatabase::Entry::Member;
+        break;
+      case SubRef::Static:
+        entry.kind = RefsDatabase::Entry::StaticMember;
+        break;
+      case SubRef::None:
+        continue; // should not happen
       }
+      entry.text = strings[sub.ref];
+      if (sub.ref < symbols.size())
+        entry.value = symbols[sub.ref].offset;
+      entry.type = strings[sub.type];
+      addEntry(entry);
     }
   }
-
-  // now the function names
-  create_directories(llvm::Twine(projectManager.outputPrefix, "/fnSearch"));
-  for (auto &fnIt : functionIndex) {
-    auto fnName = fnIt.first;
+  projectManager.refsDatabase.addChunk(refsChunk);
+  refsTimer.stop();
+  if (budget) {
+    // The generators are not read while the threads are writing the pages
+    sampleMemory(memoryUsage(false) + pagesMemory + refsChunk.memoryUsage() +
+                 recordMemory);
+    llvm::SmallString<256> mainFile;
+    canonicalize(
+        getSourceMgr().getFileEntryForID(getSourceMgr().getMainFileID())
+            ->getName(),
+        mainFile);
+    budget->record(mainFile, peakMemory);
+  }
+  // Only the strings are still needed, for the function index
+  refsChunk = RefsDatabase::Chunk();
+  std::vector<Symbol>().swap(symbols);
+  commentHandler.docs.clear();
+  mangle_cache.clear();
+
+  pageWorker();
+  for (auto &t : pageThreads)
+    t.join();
+  generators.clear();
+
+  // now the function names, grouped by their file in fnSearch/
+  Stats::Timer fnSearchTimer(Stats::FnSearch);
+  // By name, the first ref registered for a name wins
+  std::stable_sort(functionIndex.begin(), functionIndex.end(),
+                   [this](const std::pair<unsigned, unsigned> &a,
+                          const std::pair<unsigned, unsigned> &b) {
+                     return strings[a.first] < strings[b.first];
+                   });
+  functionIndex.erase(std::unique(functionIndex.begin(), functionIndex.end(),
+                                  [](const std::pair<unsigned, unsigned> &a,
+                                     const std::pair<unsigned, unsigned> &b) {
+                                    return a.first == b.first;
+                                  }),
+                      functionIndex.end());
+  std::map<std::string, std::string> fnSearchLines; // file -> its new lines
+  for (const auto &fnIt : functionIndex) {
+    std::string fnName = strings[fnIt.first].str();
+    llvm::StringRef fnRef = strings[fnIt.second];
     if (fnName.size() < 4)
       continue;
     if (fnName.find("__") != std::string::npos)
@@ -485,34 +700,68 @@ bool Annotator::generate(clang::Sema &Sema, bool WasInDatabase) {
                      normalizeForfnIndex(fnName[pos + 1]), '\0'};
       llvm::StringRef idxRef(idx, 3); // include the '\0' on purpose
       if (saved.find(idxRef) == std::string::npos) {
-        std::string funcIndexFN =
-            projectManager.outputPrefix % "/fnSearch/" % idx;
-#if CLANG_VERSION_MAJOR == 3 && CLANG_VERSION_MINOR <= 5
-        std::string error;
-        llvm::raw_fd_ostream funcIndexFile(funcIndexFN.c_str(), error,
-                                           llvm::sys::fs::F_Append);
-        if (!error.empty()) {
-          std::cerr << error << std::endl;
-          return false;
-        }
-#else
-        std::error_code error_code;
-        llvm::raw_fd_ostream funcIndexFile(funcIndexFN, error_code,
-                                           llvm::sys::fs::F_Append);
-        if (error_code) {
-          std::cerr << "Error writing index file " << funcIndexFN << ": "
-                    << error_code.message() << std::endl;
-          continue;
-        }
-#endif
-        funcIndexFile << fnIt.second << '|' << fnIt.first << '\n';
+        std::string line = fnRef % "|" % fnName;
+        std::string &lines = fnSearchLines[idx];
+        lines += line;
+        lines += '\n';
+        if (record)
+          record->fnSearch.push_back({idx, std::move(line)});
         saved.append(idxRef); // include \0;
       }
     }
   }
+  create_directories(llvm::Twine(projectManager.outputPrefix, "/fnSearch"));
+
+  // The index files are shared with the other translation units that may be
+  // processed at the same time. Each of them is appended once.
+  std::lock_guard<std::mutex> lock(projectManager.outputMutex);
+  for (const auto &fn : indexedFiles)
+    fileIndex << fn << '\n';
+  fileIndex.close();
+
+  for (const auto &it : fnSearchLines) {
+    std::string funcIndexFN =
+        projectManager.outputPrefix % "/fnSearch/" % it.first;
+#if CLANG_VERSION_MAJOR == 3 && CLANG_VERSION_MINOR <= 5
+    std::string error;
+    llvm::raw_fd_ostream funcIndexFile(funcIndexFN.c_str(), error,
+                                       llvm::sys::fs::F_Append);
+    if (!error.empty()) {
+      std::cerr << error << std::endl;
+      return false;
+    }
+#else
+    std::error_code error_code;
+    llvm::raw_fd_ostream funcIndexFile(funcIndexFN, error_code,
+                                       llvm::sys::fs::F_Append);
+    if (error_code) {
+      std::cerr << "Error writing index file " << funcIndexFN << ": "
+                << error_code.message() << std::endl;
+      continue;
+    }
+#endif
+    funcIndexFile << it.second;
+  }
+
+  if (record)
+    projectManager.manifest->add(std::move(*record));
   return true;
 }
 
+size_t Annotator::memoryUsage(bool withPages) const {
+  size_t result = symbols.capacity() * sizeof(Symbol);
+  for (const auto &sym : symbols) {
+    result += sym.references.capacity() * sizeof(Reference) +
+              sym.subRefs.capacity() * sizeof(SubRef);
+  }
+  if (withPages) {
+    for (const auto &it : generators)
+      result += it.second.memoryUsage();
+  }
+  result += commentHandler.memoryUsage();
+  return result;
+}
+
 std::string Annotator::pathTo(clang::FileID From, clang::FileID To,
                               std::string *dataProj) {
   std::string &result = pathTo_cache[{From.getHashValue(), To.getHashValue()}];
@@ -637,8 +886,8 @@ void Annotator::registerReference(clang::NamedDecl *decl,
         if (usedContext && typeText.empty() && declType >= Use) {
           typeText = getContextStr(usedContext);
         }
-        addReference(getReferenceAndTitle(decl).first, range, type, declType,
-                     typeText, decl);
+        addReference(getReferenceAndTitle(decl).ref, range, type, declType,
+                     strings.intern(typeText), decl);
       }
       return;
     }
@@ -655,7 +904,9 @@ void Annotator::registerReference(clang::NamedDecl *decl,
 
   std::string tags;
   std::string clas = computeClas(decl);
-  std::string ref;
+  llvm::StringRef ref;
+  unsigned refId = 0; // for the non local refs
+  std::string localRef;
 
   const clang::Decl *canonDecl = decl->getCanonicalDecl();
   if (type != Namespace) {
@@ -668,16 +919,18 @@ void Annotator::registerReference(clang::NamedDecl *decl,
       if (id == 0)
         id = localeNumbers.size();
       llvm::StringRef name = decl->getName();
-      ref = (llvm::Twine(id) + name).str();
+      localRef = (llvm::Twine(id) + name).str();
+      ref = localRef;
       if (type != Label) {
         llvm::SmallString<64> buffer;
         tags %= " title='" % Generator::escapeAttr(name, buffer) % "'";
         clas %= " local col" % llvm::Twine(id % 10).str();
       }
     } else {
-      auto cached = getReferenceAndTitle(decl);
-      ref = cached.first;
-      tags %= " title='" % cached.second % "'";
+      const auto &cached = getReferenceAndTitle(decl);
+      refId = cached.ref;
+      ref = strings[refId];
+      tags %= " title='" % cached.title % "'";
     }
 
     if (visibility == Visibility::Global && type != Typedef) {
@@ -688,12 +941,14 @@ void Annotator::registerReference(clang::NamedDecl *decl,
       clang::SourceRange definitionRange = range;
       if (declType == Definition)
         definitionRange = decl->getSourceRange();
-      addReference(ref, definitionRange, type, declType, typeText, decl);
+      addReference(refId, definitionRange, type, declType,
+                   strings.intern(typeText), decl);
 
       if (declType == Definition && ref.find('{') >= ref.size()) {
         if (clang::FunctionDecl *fun =
                 llvm::dyn_cast<clang::FunctionDecl>(decl)) {
-          functionIndex.insert({fun->getQualifiedNameAsString(), ref});
+          functionIndex.push_back(
+              {strings.intern(fun->getQualifiedNameAsString()), refId});
         }
       }
     } else {
@@ -705,8 +960,9 @@ void Annotator::registerReference(clang::NamedDecl *decl,
 
     if (visibility == Visibility::Static) {
       if (declType < Use) {
-        commentHandler.decl_offsets.insert(
-            {decl->getSourceRange().getBegin(), {ref, false}});
+        commentHandler.addDeclOffset(getSourceMgr(),
+                                     decl->getSourceRange().getBegin(), refId,
+                                     false);
       } else
         switch (+declType) {
         case Use_Address:
@@ -842,31 +1098,34 @@ void Annotator::registerReference(clang::NamedDecl *decl,
   }
 }
 
-void Annotator::addReference(const std::string &ref, clang::SourceRange refLoc,
-                             TokenType type, DeclType dt,
-                             const std::string &typeRef, clang::Decl *decl) {
+void Annotator::addReference(unsigned ref, clang::SourceRange refLoc,
+                             TokenType type, DeclType dt, unsigned typeRef,
+                             clang::Decl *decl) {
   if (type == Ref || type == Member || type == Decl || type == Call ||
       type == EnumDecl ||
       (type == Type && dt != Use_NestedName && dt != Declaration) ||
       (type == Enum && dt == Definition)) {
+    Symbol &sym = symbol(ref);
+    sym.referenced = true;
     ssize_t size = getDeclSize(decl);
     if (size >= 0) {
-      structure_sizes[ref] = size;
+      sym.size = size;
     }
-    references[ref].push_back({dt, refLoc, typeRef});
+    sym.references.push_back({dt, refLoc, typeRef});
     if (dt < Use) {
       ssize_t offset = getFieldOffset(decl);
       if (offset >= 0) {
-        field_offsets[ref] = offset;
+        sym.offset = offset;
       }
       clang::FullSourceLoc fulloc(decl->getSourceRange().getBegin(),
                                   getSourceMgr());
-      commentHandler.decl_offsets.insert(
-          {fulloc.getSpellingLoc(), {ref, true}});
+      commentHandler.addDeclOffset(getSourceMgr(), fulloc.getSpellingLoc(), ref,
+                                   true);
       if (auto parentStruct =
               llvm::dyn_cast<clang::RecordDecl>(decl->getDeclContext())) {
-        auto parentRef = getReferenceAndTitle(parentStruct).first;
-        if (!parentRef.empty()) {
+        // (symbol() below may invalidate 'sym')
+        auto parentRef = getReferenceAndTitle(parentStruct).ref;
+        if (parentRef != 0) {
           SubRef sr;
           sr.ref = ref;
           if (decl->isFunctionOrFunctionTemplate())
@@ -877,7 +1136,7 @@ void Annotator::addReference(const std::string &ref, clang::SourceRange refLoc,
             sr.what = SubRef::Static;
           if (sr.what != SubRef::Function)
             sr.type = typeRef;
-          sub_refs[parentRef].push_back(sr);
+          symbol(parentRef).subRefs.push_back(sr);
         }
       }
     }
@@ -895,21 +1154,25 @@ void Annotator::registerOverride(clang::NamedDecl *decl,
   if (getVisibility(overrided) != Visibility::Global)
     return;
 
-  auto ovrRef = getReferenceAndTitle(overrided).first;
-  auto declRef = getReferenceAndTitle(decl).first;
-  references[ovrRef].push_back({Override, expensionloc, declRef});
+  auto ovrRef = getReferenceAndTitle(overrided).ref;
+  auto declRef = getReferenceAndTitle(decl).ref;
+  symbol(ovrRef).referenced = true;
+  symbol(ovrRef).references.push_back({Override, expensionloc, declRef});
 
   // Register the reversed relation.
   clang::SourceLocation ovrLoc =
       sm.getExpansionLoc(getDefinitionDecl(overrided)->getLocation());
-  references[declRef].push_back({Inherit, ovrLoc, ovrRef});
+  symbol(declRef).referenced = true;
+  symbol(declRef).references.push_back({Inherit, ovrLoc, ovrRef});
 }
 
 void Annotator::registerMacro(const std::string &ref,
                               clang::SourceLocation refLoc, DeclType declType) {
-  references[ref].push_back({declType, refLoc, std::string()});
+  unsigned id = strings.intern(ref);
+  symbol(id).referenced = true;
+  symbol(id).references.push_back({declType, refLoc, 0});
   if (declType == Annotator::Declaration) {
-    commentHandler.decl_offsets.insert({refLoc, {ref, true}});
+    commentHandler.addDeclOffset(getSourceMgr(), refLoc, id, true);
   }
 }
 
@@ -995,19 +1258,20 @@ static clang::NamedDecl *getSpecializedCursorTemplate(clang::NamedDecl *D) {
     return D;
 }
 
-std::pair<std::string, std::string>
+const Annotator::MangledDecl &
 Annotator::getReferenceAndTitle(clang::NamedDecl *decl) {
   clang::Decl *canonDecl = decl->getCanonicalDecl();
   auto &cached = mangle_cache[canonDecl];
-  if (cached.first.empty()) {
+  if (cached.ref == 0) {
     decl = getSpecializedCursorTemplate(decl);
+    std::string ref;
 
     std::string qualName = decl->getQualifiedNameAsString();
     if (llvm::isa<clang::FunctionDecl>(decl) &&
         mangle->shouldMangleDeclName(decl)
         // workaround crash in clang while trying to mangle some builtin types
         && !llvm::StringRef(qualName).startswith("__")) {
-      llvm::raw_string_ostream s(cached.first);
+      llvm::raw_string_ostream s(ref);
       if (llvm::isa<clang::CXXDestructorDecl>(decl)) {
         mangle->mangleCXXDtor(llvm::cast<clang::CXXDestructorDecl>(decl),
                               clang::Dtor_Complete, s);
@@ -1021,39 +1285,38 @@ Annotator::getReferenceAndTitle(clang::NamedDecl *decl) {
 #ifdef _WIN32
       s.flush();
 
-      const char *mangledName = cached.first.data();
+      const char *mangledName = ref.data();
       if (mangledName[0] == 1) {
         if (mangledName[1] == '_' || mangledName[1] == '?') {
           if (mangledName[2] == '?') {
-            cached.first = cached.first.substr(3);
+            ref = ref.substr(3);
           } else {
-            cached.first = cached.first.substr(2);
+            ref = ref.substr(2);
           }
         }
       }
 #endif
     } else if (clang::FieldDecl *d = llvm::dyn_cast<clang::FieldDecl>(decl)) {
-      cached.first = getReferenceAndTitle(d->getParent()).first +
-                     "::" + decl->getName().str();
+      ref = strings[getReferenceAndTitle(d->getParent()).ref].str() +
+            "::" + decl->getName().str();
     } else {
-      cached.first = qualName;
-      cached.first.erase(
-          std::remove(cached.first.begin(), cached.first.end(), ' '),
-          cached.first.end());
+      ref = qualName;
+      ref.erase(std::remove(ref.begin(), ref.end(), ' '), ref.end());
       // replace < and > because alse jquery can't match them.
-      std::replace(cached.first.begin(), cached.first.end(), '<', '{');
-      std::replace(cached.first.begin(), cached.first.end(), '>', '}');
+      std::replace(ref.begin(), ref.end(), '<', '{');
+      std::replace(ref.begin(), ref.end(), '>', '}');
     }
     llvm::SmallString<64> buffer;
-    cached.second = Generator::escapeAttr(qualName, buffer);
+    cached.title = Generator::escapeAttr(qualName, buffer);
 
-    if (cached.first.size() > 170) {
+    if (ref.size() > 170) {
       // If the name is too big, truncate it and add the hash at the end.
-      auto hash = std::hash<std::string>()(cached.first) & 0x00ffffff;
-      cached.first.resize(150);
+      auto hash = std::hash<std::string>()(ref) & 0x00ffffff;
+      ref.resize(150);
       buffer.clear();
-      cached.first += llvm::Twine(hash).toStringRef(buffer);
+      ref += llvm::Twine(hash).toStringRef(buffer);
     }
+    cached.ref = strings.intern(ref);
   }
   return cached;
 }
@@ -1072,14 +1335,14 @@ std::string Annotator::getContextStr(clang::NamedDecl *usedContext) {
     context = context->getParent();
   }
   if (fun)
-    return getReferenceAndTitle(fun).first;
+    return strings[getReferenceAndTitle(fun).ref].str();
   return {};
 }
 
 std::string Annotator::getVisibleRef(clang::NamedDecl *Decl) {
   if (getVisibility(Decl) != Visibility::Global)
     return {};
-  return getReferenceAndTitle(Decl).first;
+  return strings[getReferenceAndTitle(Decl).ref].str();
 }
 
 // return the classes to add in the span
@@ -1110,19 +1373,26 @@ void Annotator::syntaxHighlight(Generator &generator, clang::FileID FID,
   const char *BufferStart = FromFile->getBufferStart();
   const char *BufferEnd = FromFile->getBufferEnd();
 
+  // Since we are lexing unexpanded tokens, all tokens are from the main
+  // FileID, and their offset is the distance from its start location.
+  const unsigned FileStart = SM.getLocForStartOfFile(FID).getRawEncoding();
+  auto offsetOf = [FileStart](SourceLocation Loc) {
+    return Loc.getRawEncoding() - FileStart;
+  };
+
   // Inform the preprocessor that we want to retain comments as tokens, so we
   // can highlight them.
   L.SetCommentRetentionState(true);
 
   // Lex all the tokens in raw mode, to avoid entering #includes or expanding
-  // macros.
+  // macros. (The tokens the preprocessor lexed while parsing are not reused:
+  // the comments, the directives and the blocks skipped by #if are not among
+  // them, and they would still need this lexer.)
   Token Tok;
   L.LexFromRawLexer(Tok);
 
   while (Tok.isNot(tok::eof)) {
-    // Since we are lexing unexpanded tokens, all tokens are from the main
-    // FileID.
-    unsigned TokOffs = SM.getFileOffset(Tok.getLocation());
+    unsigned TokOffs = offsetOf(Tok.getLocation());
     unsigned TokLen = Tok.getLength();
     switch (Tok.getKind()) {
     default:
@@ -1130,6 +1400,12 @@ void Annotator::syntaxHighlight(Generator &generator, clang::FileID FID,
     case tok::identifier:
       llvm_unreachable("tok::identifier in raw lexing mode!");
     case tok::raw_identifier: {
+      // The keywords all start with a lowercase letter or '_': the other
+      // identifiers are not looked up in the identifier table.
+      char First = *Tok.getRawIdentifier().data();
+      if (!(First >= 'a' && First <= 'z') && First != '_' &&
+          !Tok.needsCleaning())
+        break;
       // Fill in Result.IdentifierInfo and update the token kind,
       // looking up the identifier in the identifier table.
       PP.LookUpIdentifierInfo(Tok);
@@ -1174,7 +1450,7 @@ void Annotator::syntaxHighlight(Generator &generator, clang::FileID FID,
       // Merge consecutive comments
       if (startOfLine /*&&  BufferStart[CommentBegin+1] == '/'*/) {
         while (Tok.is(tok::comment)) {
-          unsigned int Off = SM.getFileOffset(Tok.getLocation());
+          unsigned int Off = offsetOf(Tok.getLocation());
           if (BufferStart[Off + 1] != '/')
             break;
           CommentLen = Off + Tok.getLength() - CommentBegin;
@@ -1185,7 +1461,7 @@ void Annotator::syntaxHighlight(Generator &generator, clang::FileID FID,
       std::string attributes;
 
       if (startOfLine) {
-        unsigned int NonCommentBegin = SM.getFileOffset(Tok.getLocation());
+        unsigned int NonCommentBegin = offsetOf(Tok.getLocation());
         // Find the location of the next \n
         const char *nl_it = BufferStart + NonCommentBegin;
         while (nl_it < BufferEnd && *nl_it && *nl_it != '\n')
@@ -1248,7 +1524,7 @@ void Annotator::syntaxHighlight(Generator &generator, clang::FileID FID,
       unsigned TokEnd = TokOffs + TokLen;
       L.LexFromRawLexer(Tok);
       while (!Tok.isAtStartOfLine() && Tok.isNot(tok::eof)) {
-        TokEnd = SM.getFileOffset(Tok.getLocation()) + Tok.getLength();
+        TokEnd = offsetOf(Tok.getLocation()) + Tok.getLength();
         L.LexFromRawLexer(Tok);
       }
 
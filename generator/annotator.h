@@ -23,6 +23,8 @@
 
 #include "commenthandler.h"
 #include "generator.h"
+#include "qtsupport.h"
+#include "stringinterner.h"
 #include <clang/AST/Mangle.h>
 #include <clang/Basic/SourceLocation.h>
 #include <map>
@@ -107,40 +109,64 @@ private:
 
   std::string htmlNameForFile(clang::FileID id); // keep a cache;
 
-  void addReference(const std::string &ref, clang::SourceRange refLoc,
+  void addReference(unsigned ref, clang::SourceRange refLoc,
                     Annotator::TokenType type, Annotator::DeclType dt,
-                    const std::string &typeRef, clang::Decl *decl);
+                    unsigned typeRef, clang::Decl *decl);
+
+  // The refs, and the strings of the references (types and contexts). The
+  // tables below are keyed by their ids; the strings are only looked up when
+  // the refs/ entries are written.
+  StringInterner strings;
 
   struct Reference {
     DeclType what;
     clang::SourceRange loc;
-    std::string typeOrContext;
+    unsigned typeOrContext;
   };
-  std::map<std::string, std::vector<Reference>> references;
-  std::map<std::string, ssize_t> structure_sizes;
-  std::map<std::string, ssize_t> field_offsets;
   struct SubRef {
-    std::string ref;
-    std::string type;
+    unsigned ref = 0;
+    unsigned type = 0;
     enum Type { None, Function, Member, Static } what = None;
   };
-  std::map<std::string, std::vector<SubRef>> sub_refs;
+  struct Symbol {
+    bool referenced = false; // has an entry in refs/
+    std::vector<Reference> references;
+    std::vector<SubRef> subRefs;
+    ssize_t size = -1;
+    ssize_t offset = -1;
+  };
+  std::vector<Symbol> symbols; // by id of the ref
+  Symbol &symbol(unsigned ref) {
+    if (ref >= symbols.size())
+      symbols.resize(strings.size());
+    return symbols[ref];
+  }
   std::unordered_map<pathTo_cache_key_t, std::string> pathTo_cache;
   CommentHandler commentHandler;
 
   std::unique_ptr<clang::MangleContext> mangle;
-  std::unordered_map<void *, std::pair<std::string, std::string>>
-      mangle_cache; // canonical Decl*  -> ref,  escapred_title
-  std::pair<std::string, std::string>
-  getReferenceAndTitle(clang::NamedDecl *decl);
-  // project -> { pretty name, ref }
-  std::map<std::string, std::string> functionIndex;
+  struct MangledDecl {
+    unsigned ref = 0;
+    std::string title; // escaped
+  };
+  std::unordered_map<void *, MangledDecl> mangle_cache; // by canonical Decl*
+  const MangledDecl &getReferenceAndTitle(clang::NamedDecl *decl);
+  // { pretty name, ref } for the function search, the first ref of a name wins
+  std::vector<std::pair<unsigned, unsigned>> functionIndex;
 
   std::unordered_map<unsigned, int> localeNumbers;
 
   std::map<clang::FileID, std::set<std::string>> interestingDefinitionsInFile;
 
+  // File -> sorted offsets of its #include directives, built the first time
+  // canSkipDeclarations needs it
+  std::map<clang::FileID, std::vector<unsigned>> includeOffsets;
+  bool includeOffsetsBuilt = false;
+
   std::string args;
+  std::string commandFile;
+  std::string commandHash;
+  std::vector<std::string> precompiledInputs;
   clang::SourceManager *sourceManager = nullptr;
   const clang::LangOptions *langOption = nullptr;
 
@@ -151,6 +177,7 @@ public:
   ~Annotator();
 
   ProjectManager &projectManager;
+  QtSupport::Cache qtCache;
 
   void setSourceMgr(clang::SourceManager &sm, const clang::LangOptions &lo) {
     sourceManager = &sm;
@@ -160,9 +187,25 @@ public:
   clang::SourceManager &getSourceMgr() { return *sourceManager; }
   const clang::LangOptions &getLangOpts() const { return *langOption; }
   void setArgs(std::string a) { args = std::move(a); }
+  // The file whose compile command was used, and the hash of that command
+  void setCommandInfo(std::string file, std::string hash) {
+    commandFile = std::move(file);
+    commandHash = std::move(hash);
+  }
+  // The files that were loaded from a precompiled header (see PchCache)
+  void setPrecompiledInputs(std::vector<std::string> files) {
+    precompiledInputs = std::move(files);
+  }
 
+  // The pages are written as they are generated, and the memory of their tags
+  // and of the references is released once written. With --max-memory, the
+  // peak memory of the translation unit is recorded in the MemoryBudget.
   bool generate(clang::Sema &, bool WasInDatabase);
 
+  // An estimate of the memory used by the references, and with 'withPages' by
+  // the tags of the pages that are not written yet
+  size_t memoryUsage(bool withPages = true) const;
+
   /**
    * Returns a string with the URL to go from one file to an other.
    * In case the file is in an external project that needs a data-proj tag, the
@@ -199,6 +242,10 @@ public:
   void registerMacro(const std::string &ref, clang::SourceLocation refLoc,
                      DeclType declType);
 
+  // The id of a ref, for the tables of the CommentHandler
+  unsigned refId(llvm::StringRef ref) { return strings.intern(ref); }
+  llvm::StringRef refString(unsigned id) const { return strings[id]; }
+
   // Class names, structs, objective C identifiers, main function
   void registerInterestingDefinition(clang::SourceRange range,
                                      clang::NamedDecl *decl);
@@ -213,6 +260,10 @@ public:
                         const std::string &clas);
 
   bool shouldProcess(clang::FileID);
+  /* Whether the declarations within 'range' do not need to be visited: the
+   * range is in a file that is not processed (which includes the files that
+   * were already generated) and no file is included from within the range. */
+  bool canSkipDeclarations(clang::SourceRange range);
   Generator &generator(clang::FileID fid) { return generators[fid]; }
 
   std::string getTypeRef(clang::QualType type);
@@ -0,0 +1,160 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+/* Helpers shared by the benchmarks of the suite (see CMakeLists.txt).
+ *
+ * Each measure runs once to warm up, then Repetitions times, and prints one
+ * line with the median and the minimum, so that the output of two commits can
+ * be compared line by line:
+ *   <name>  median <ms> ms  min <ms> ms  <rate> <unit>/s
+ */
+
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+const int Repetitions = 7;
+
+// 'items' is the number of 'unit' processed by one call of f, for the rate
+template <typename F>
+void measure(llvm::StringRef name, double items, const char *unit, F f,
+             int repetitions = Repetitions) {
+  f();
+  std::vector<double> times;
+  for (int i = 0; i < repetitions; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto stop = std::chrono::steady_clock::now();
+    times.push_back(std::chrono::duration<double>(stop - start).count());
+  }
+  std::sort(times.begin(), times.end());
+  double median = times[times.size() / 2];
+  llvm::outs() << llvm::format("%-40s median %10.3f ms  min %10.3f ms  "
+                               "%12.1f %s/s\n",
+                               name.str().c_str(), median * 1000,
+                               times.front() * 1000, items / median, unit);
+  llvm::outs().flush();
+}
+
+// The path of a file of the pinned corpus
+inline std::string corpusFile(llvm::StringRef name) {
+  return std::string(CODEBROWSER_BENCH_CORPUS) + "/" + name.str();
+}
+
+inline std::string readCorpusFile(llvm::StringRef name) {
+  auto buffer = llvm::MemoryBuffer::getFile(corpusFile(name));
+  if (!buffer) {
+    std::cerr << "Error reading " << corpusFile(name) << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  return (*buffer)->getBuffer().str();
+}
+
+struct RecordedTag {
+  std::string name;
+  std::string attributes;
+  int pos;
+  int len;
+};
+
+// Tags like the ones of the Annotator, for the identifiers, numbers, strings
+// and comments of the source
+inline void makeUpTags(llvm::StringRef source, std::vector<RecordedTag> &tags) {
+  auto find = [&](llvm::StringRef what, size_t from) {
+    return std::min(source.find(what, from), source.size());
+  };
+  size_t i = 0;
+  unsigned n = 0;
+  while (i < source.size()) {
+    char c = source[i];
+    size_t start = i;
+    if (std::isalpha(c) || c == '_') {
+      while (i < source.size() && (std::isalnum(source[i]) || source[i] == '_'))
+        ++i;
+      if (++n % 3)
+        tags.push_back({"a",
+                        "href=\"#" + std::to_string(n) +
+                            "\" class=\"ref\" data-ref=\"_Z" +
+                            std::to_string(n % 97) + "\"",
+                        int(start), int(i - start)});
+      else
+        tags.push_back({"b", std::string(), int(start), int(i - start)});
+    } else if (std::isdigit(c)) {
+      while (i < source.size() && std::isalnum(source[i]))
+        ++i;
+      tags.push_back({"var", std::string(), int(start), int(i - start)});
+    } else if (source.substr(i).startswith("/*")) {
+      i = std::min(find("*/", i + 2) + 2, source.size());
+      tags.push_back({"i", std::string(), int(start), int(i - start)});
+    } else if (source.substr(i).startswith("//")) {
+      i = find("\n", i);
+      tags.push_back({"i", std::string(), int(start), int(i - start)});
+    } else if (c == '"') {
+      i = std::min(find("\"", i + 1) + 1, source.size());
+      tags.push_back({"q", std::string(), int(start), int(i - start)});
+    } else {
+      ++i;
+    }
+  }
+}
+
+/* The very large file of the corpus, like the generated tables of a parser:
+ * it is generated rather than stored, but does not depend on anything. */
+inline std::string largeSource(int count = 4000) {
+  std::string source = "// Generated file\n\nnamespace generated {\n\n"
+                       "struct Entry {\n  int id;\n  const char *name;\n"
+                       "  int (*handler)(int);\n};\n\n";
+  for (int i = 0; i < count; ++i) {
+    std::string n = std::to_string(i);
+    source += "/* Handler " + n + " */\nstatic int handler_" + n +
+              "(int value) {\n  int result = value * " + n + " + " +
+              std::to_string(i % 7) + ";\n  if (result > " +
+              std::to_string(1000 + i) + ")\n    result -= " +
+              std::to_string(i % 13) +
+              ";\n  return result;\n}\n\nstruct Node_" + n +
+              " {\n  int field_a = " + n + ";\n  double field_b = " + n +
+              ".5;\n  int compute() const { return handler_" + n +
+              "(field_a); }\n};\n\n";
+  }
+  source += "const Entry table[] = {\n";
+  for (int i = 0; i < count; ++i) {
+    std::string n = std::to_string(i);
+    source += "    {" + n + ", \"handler_" + n + "\", handler_" + n + "},\n";
+  }
+  source += "};\n\n} // namespace generated\n\nint main() {\n  int total = 0;\n"
+            "  for (const auto &entry : generated::table)\n"
+            "    total += entry.handler(entry.id);\n  return total;\n}\n";
+  return source;
+}
+
+} // namespace bench
@@ -0,0 +1,203 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+/* Micro-benchmarks of the components of the generator that do not need a
+ * parsed translation unit, on the pinned corpus (see corpus/):
+ *  - Generator::generate, which writes the pages
+ *  - Generator::escapeAttr
+ *  - ProjectManager::projectForFile
+ *  - the refs/ writer (RefsDatabase::addChunk and consolidate)
+ *
+ * Usage: bench_components
+ */
+
+#include "bench.h"
+#include "filesystem.h"
+#include "generator.h"
+#include "projectmanager.h"
+#include "refsdatabase.h"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct CorpusFile {
+  std::string name;
+  std::string source;
+  std::vector<bench::RecordedTag> tags;
+};
+
+std::vector<CorpusFile> loadCorpus() {
+  std::vector<CorpusFile> corpus;
+  for (const char *name : {"templates.cpp", "macros.c", "signals.cpp"})
+    corpus.push_back({name, bench::readCorpusFile(name), {}});
+  corpus.push_back({"large.cpp", bench::largeSource(), {}});
+  for (auto &file : corpus)
+    bench::makeUpTags(file.source, file.tags);
+  return corpus;
+}
+
+void benchGenerate(const std::vector<CorpusFile> &corpus,
+                   const std::string &output) {
+  for (const auto &file : corpus) {
+    // The small files are generated several times, so that the measure is
+    // not only the noise
+    std::size_t iterations =
+        std::max<std::size_t>(1, (4 << 20) / file.source.size());
+    bench::measure("Generator::generate " + file.name,
+                   iterations * file.source.size() / 1e6, "MB", [&] {
+                     for (std::size_t i = 0; i < iterations; ++i) {
+                       Generator g;
+                       for (const auto &t : file.tags)
+                         g.addTag(t.name, t.attributes, t.pos, t.len);
+                       g.generate(output, "../data", "bench/" + file.name,
+                                  file.source.data(),
+                                  file.source.data() + file.source.size(),
+                                  "Generated by the benchmark", "",
+                                  std::set<std::string>(), "");
+                     }
+                   });
+  }
+}
+
+void benchEscapeAttr(const std::vector<CorpusFile> &corpus) {
+  // The attributes of the tags, and the source lines (which have the
+  // characters to escape)
+  std::vector<std::string> strings;
+  std::size_t bytes = 0;
+  for (const auto &file : corpus) {
+    for (const auto &t : file.tags)
+      strings.push_back(t.attributes);
+    llvm::SmallVector<llvm::StringRef, 64> lines;
+    llvm::StringRef(file.source).split(lines, '\n');
+    for (auto line : lines)
+      strings.push_back(line.str());
+  }
+  for (const auto &s : strings)
+    bytes += s.size();
+
+  std::size_t escaped = 0;
+  bench::measure("Generator::escapeAttr", bytes / 1e6, "MB", [&] {
+    llvm::SmallString<256> buffer;
+    for (const auto &s : strings)
+      escaped += Generator::escapeAttr(s, buffer).size();
+  });
+  if (!escaped)
+    std::cerr << "Error: nothing was escaped" << std::endl;
+}
+
+void benchProjectForFile(const std::string &output) {
+  // 50 projects of 20 sub-projects, like a distribution with its libraries.
+  // The source paths are canonicalized, so they must exist.
+  ProjectManager projectManager(output, "../data");
+  std::string src = output + "/src";
+  for (int i = 0; i < 50; ++i) {
+    std::string root = src + "/project" + std::to_string(i);
+    create_directories(root);
+    projectManager.addProject({"project" + std::to_string(i), root});
+    for (int j = 0; j < 20; ++j) {
+      std::string lib = root + "/libs/lib" + std::to_string(j);
+      create_directories(lib);
+      projectManager.addProject(
+          {"project" + std::to_string(i) + "-lib" + std::to_string(j), lib});
+    }
+  }
+  llvm::SmallString<128> canonical;
+  canonicalize(src, canonical);
+  std::vector<std::string> files;
+  for (int i = 0; i < 100000; ++i) {
+    files.push_back(canonical.str().str() + "/project" +
+                    std::to_string(i % 53) + "/" +
+                    (i % 2 ? "libs/lib" + std::to_string(i % 23) + "/" : "") +
+                    "src/module" + std::to_string(i % 17) + "/file" +
+                    std::to_string(i) + ".cpp");
+  }
+
+  std::size_t found = 0;
+  bench::measure("ProjectManager::projectForFile", files.size(), "lookups",
+                 [&] {
+                   for (const auto &file : files)
+                     found += projectManager.projectForFile(file) != nullptr;
+                 });
+  if (!found)
+    std::cerr << "Error: no project was found" << std::endl;
+}
+
+void benchRefs(const std::string &output) {
+  // 200 translation units which use the same 2000 refs, in 50 files
+  const int unitCount = 200, refCount = 2000;
+  std::vector<std::string> refs, files;
+  for (int i = 0; i < refCount; ++i)
+    refs.push_back("_ZN9namespace5Class" + std::to_string(i) + "6methodEv");
+  for (int i = 0; i < 50; ++i)
+    files.push_back("bench/dir" + std::to_string(i % 7) + "/file" +
+                    std::to_string(i) + ".cpp");
+  std::vector<RefsDatabase::Chunk> chunks(unitCount);
+  std::size_t entryCount = 0;
+  for (int unit = 0; unit < unitCount; ++unit) {
+    for (int i = 0; i < refCount; i += 1 + unit % 3) {
+      RefsDatabase::Entry entry;
+      entry.kind = i % 11 ? RefsDatabase::Entry::Use
+                          : RefsDatabase::Entry::Definition;
+      entry.useType = i % 5 ? 'c' : '\0';
+      entry.file = files[(unit + i) % files.size()];
+      entry.line = 1 + (unit * 31 + i) % 900;
+      entry.text = refs[(i + 1) % refs.size()];
+      chunks[unit].add(refs[i], entry);
+      ++entryCount;
+    }
+  }
+
+  int run = 0;
+  bench::measure("RefsDatabase addChunk+consolidate", entryCount, "entries",
+                 [&] {
+                   std::string dir = output + "/refs" + std::to_string(run++);
+                   RefsDatabase database(dir);
+                   for (const auto &chunk : chunks)
+                     database.addChunk(chunk);
+                   database.consolidate();
+                   llvm::sys::fs::remove_directories(dir);
+                 });
+}
+
+} // namespace
+
+int main() {
+  llvm::SmallString<128> path;
+  if (llvm::sys::fs::createUniqueDirectory("codebrowser-bench", path)) {
+    std::cerr << "Error creating a temporary directory" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string output(path.str());
+
+  auto corpus = loadCorpus();
+  benchGenerate(corpus, output);
+  benchEscapeAttr(corpus);
+  benchProjectForFile(output);
+  benchRefs(output);
+
+  llvm::sys::fs::remove_directories(output);
+  return EXIT_SUCCESS;
+}
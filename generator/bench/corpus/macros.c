@@ -0,0 +1,126 @@
+/* Macro-heavy C without any include: X-macros, token pasting, stringizing
+ * and nested expansions. */
+
+#define STR_(x) #x
+#define STR(x) STR_(x)
+#define CAT_(a, b) a##b
+#define CAT(a, b) CAT_(a, b)
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define CLAMP(x, lo, hi) MIN(MAX(x, lo), hi)
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define UNUSED(x) (void)(x)
+
+#define COLORS(X)                                                              \
+  X(RED, 0xff0000)                                                             \
+  X(GREEN, 0x00ff00)                                                           \
+  X(BLUE, 0x0000ff)                                                            \
+  X(YELLOW, 0xffff00)                                                          \
+  X(CYAN, 0x00ffff)                                                            \
+  X(MAGENTA, 0xff00ff)                                                         \
+  X(WHITE, 0xffffff)                                                           \
+  X(BLACK, 0x000000)
+
+#define AS_ENUM(name, value) COLOR_##name,
+enum color { COLORS(AS_ENUM) COLOR_COUNT };
+
+#define AS_VALUE(name, value) value,
+static const unsigned color_values[] = {COLORS(AS_VALUE)};
+
+#define AS_NAME(name, value) STR(name),
+static const char *const color_names[] = {COLORS(AS_NAME)};
+
+#define OPCODES(X)                                                             \
+  X(add, +)                                                                    \
+  X(sub, -)                                                                    \
+  X(mul, *)                                                                    \
+  X(div, /)                                                                    \
+  X(mod, %)                                                                    \
+  X(and, &)                                                                    \
+  X(or, |)                                                                     \
+  X(xor, ^)
+
+#define DEFINE_OP(name, op)                                                    \
+  static long CAT(op_, name)(long a, long b) { return a op b; }
+OPCODES(DEFINE_OP)
+
+#define AS_TABLE(name, op) {STR(name), CAT(op_, name)},
+struct opcode {
+  const char *name;
+  long (*fn)(long, long);
+};
+static const struct opcode opcodes[] = {OPCODES(AS_TABLE)};
+
+#define LIST_FOREACH(item, list) for (item = (list); item; item = item->next)
+#define CONTAINER_OF(ptr, type, member)                                        \
+  ((type *)((char *)(ptr) - (unsigned long)&((type *)0)->member))
+
+struct link {
+  struct link *next;
+};
+struct node {
+  int value;
+  struct link link;
+};
+
+#define DECLARE_STACK(type)                                                    \
+  struct CAT(type, _stack) {                                                   \
+    type items[64];                                                            \
+    int top;                                                                   \
+  };                                                                           \
+  static void CAT(type, _push)(struct CAT(type, _stack) * s, type v) {         \
+    if (s->top < (int)ARRAY_SIZE(s->items))                                    \
+      s->items[s->top++] = v;                                                  \
+  }                                                                            \
+  static type CAT(type, _pop)(struct CAT(type, _stack) * s) {                  \
+    return s->top ? s->items[--s->top] : (type)0;                              \
+  }
+
+DECLARE_STACK(int)
+DECLARE_STACK(long)
+DECLARE_STACK(double)
+
+#define REPEAT_2(m, x) m(x) m(x + 1)
+#define REPEAT_4(m, x) REPEAT_2(m, x) REPEAT_2(m, x + 2)
+#define REPEAT_8(m, x) REPEAT_4(m, x) REPEAT_4(m, x + 4)
+#define REPEAT_16(m, x) REPEAT_8(m, x) REPEAT_8(m, x + 8)
+#define REPEAT_32(m, x) REPEAT_16(m, x) REPEAT_16(m, x + 16)
+#define SQUARE_TERM(x) +CLAMP((x) * (x), 0, 500)
+
+static long sum_of_squares(void) { return 0 REPEAT_32(SQUARE_TERM, 0); }
+
+#ifdef NDEBUG
+#define CHECK(cond) ((void)0)
+#else
+#define CHECK(cond) ((cond) ? (void)0 : check_failed(STR(cond), __LINE__))
+#endif
+
+static int failures;
+static void check_failed(const char *cond, int line) {
+  UNUSED(cond);
+  UNUSED(line);
+  ++failures;
+}
+
+int main(void) {
+  unsigned i;
+  long total = 0;
+  struct int_stack ints = {{0}, 0};
+  struct node a = {1, {0}}, b = {2, {0}};
+  struct link *it;
+
+  CHECK(ARRAY_SIZE(color_values) == COLOR_COUNT);
+  CHECK(ARRAY_SIZE(color_names) == COLOR_COUNT);
+  for (i = 0; i < ARRAY_SIZE(opcodes); ++i)
+    total += opcodes[i].fn(CLAMP((long)i, 1, 5), 3);
+  for (i = 0; i < COLOR_COUNT; ++i)
+    int_push(&ints, (int)(color_values[i] & 0xff));
+  while (ints.top)
+    total += int_pop(&ints);
+
+  a.link.next = &b.link;
+  LIST_FOREACH(it, &a.link) {
+    total += CONTAINER_OF(it, struct node, link)->value;
+  }
+  return (int)(total + sum_of_squares()) + failures;
+}
@@ -0,0 +1,40 @@
+// A minimal stand-in of the parts of QObject that QtSupport recognizes, so the
+// benchmark does not need Qt.
+#pragma once
+
+#define Q_OBJECT
+#define signals public
+#define slots
+#define emit
+#define QLOCATION "\0" __FILE__ ":" "0"
+#define SLOT(a) qFlagLocation("1" #a QLOCATION)
+#define SIGNAL(a) qFlagLocation("2" #a QLOCATION)
+
+const char *qFlagLocation(const char *method);
+
+class QString {
+public:
+  QString() = default;
+  QString(const char *) {}
+};
+
+class QObject {
+public:
+  virtual ~QObject() {}
+  static bool connect(const QObject *sender, const char *signal,
+                      const QObject *receiver, const char *member);
+  static bool disconnect(const QObject *sender, const char *signal,
+                         const QObject *receiver, const char *member);
+  QObject *parent() const { return parentObject; }
+
+private:
+  QObject *parentObject = nullptr;
+};
+
+class QTimer : public QObject {
+  Q_OBJECT
+public:
+  static void singleShot(int msec, const QObject *receiver, const char *member);
+signals:
+  void timeout();
+};
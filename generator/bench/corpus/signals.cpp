@@ -0,0 +1,87 @@
+// A Qt-style translation unit: signals, slots, and connections with the
+// SIGNAL and SLOT macros (see qt/qobject.h).
+#include "qobject.h"
+
+class Document : public QObject {
+  Q_OBJECT
+public:
+  void setTitle(const QString &title) {
+    this->title = title;
+    emit titleChanged(title);
+  }
+  void setModified(bool modified) {
+    this->modified = modified;
+    emit modificationChanged(modified);
+  }
+
+signals:
+  void titleChanged(const QString &title);
+  void modificationChanged(bool modified);
+  void saved();
+
+private:
+  QString title;
+  bool modified = false;
+};
+
+class Window : public QObject {
+  Q_OBJECT
+public:
+  explicit Window(Document *document) : document(document) {
+    QObject::connect(document, SIGNAL(titleChanged(QString)), this,
+                     SLOT(updateTitle(QString)));
+    QObject::connect(document, SIGNAL(modificationChanged(bool)), this,
+                     SLOT(updateModified(bool)));
+    QObject::connect(document, SIGNAL(saved()), this, SLOT(clearStatus()));
+    QObject::connect(&autoSave, SIGNAL(timeout()), this, SLOT(save()));
+    QTimer::singleShot(100, this, SLOT(clearStatus()));
+  }
+  ~Window() {
+    QObject::disconnect(document, SIGNAL(saved()), this,
+                        SLOT(clearStatus()));
+  }
+
+public slots:
+  void updateTitle(const QString &title) { currentTitle = title; }
+  void updateModified(bool modified) { dirty = modified; }
+  void clearStatus() { status = QString(); }
+  void save() {
+    if (dirty)
+      document->setModified(false);
+  }
+
+signals:
+  void closed();
+
+private:
+  Document *document;
+  QTimer autoSave;
+  QString currentTitle;
+  QString status;
+  bool dirty = false;
+};
+
+class Application : public QObject {
+  Q_OBJECT
+public:
+  void addWindow(Window *window) {
+    QObject::connect(window, SIGNAL(closed()), this, SLOT(windowClosed()));
+    ++windowCount;
+  }
+
+public slots:
+  void windowClosed() { --windowCount; }
+
+private:
+  int windowCount = 0;
+};
+
+int main() {
+  Document document;
+  Window window(&document);
+  Application app;
+  app.addWindow(&window);
+  document.setTitle("untitled");
+  document.setModified(true);
+  return 0;
+}
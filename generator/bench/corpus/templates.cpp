@@ -0,0 +1,247 @@
+// Template-heavy C++ without any include, so the result does not depend on
+// the standard library installed on the machine.
+
+namespace meta {
+
+template <typename T, T V> struct constant {
+  static constexpr T value = V;
+  using type = constant;
+};
+using true_type = constant<bool, true>;
+using false_type = constant<bool, false>;
+
+template <typename A, typename B> struct is_same : false_type {};
+template <typename A> struct is_same<A, A> : true_type {};
+
+template <bool C, typename T = void> struct enable_if {};
+template <typename T> struct enable_if<true, T> { using type = T; };
+
+template <bool C, typename A, typename B> struct conditional {
+  using type = A;
+};
+template <typename A, typename B> struct conditional<false, A, B> {
+  using type = B;
+};
+
+template <typename T> struct remove_ref { using type = T; };
+template <typename T> struct remove_ref<T &> { using type = T; };
+template <typename T> struct remove_ref<T &&> { using type = T; };
+
+template <typename T> T &&forward(typename remove_ref<T>::type &t) {
+  return static_cast<T &&>(t);
+}
+
+template <typename... Ts> struct list {};
+
+template <typename L> struct size;
+template <typename... Ts> struct size<list<Ts...>> {
+  static constexpr int value = sizeof...(Ts);
+};
+
+template <typename L, typename T> struct push_back;
+template <typename... Ts, typename T> struct push_back<list<Ts...>, T> {
+  using type = list<Ts..., T>;
+};
+
+template <int N, typename L> struct at;
+template <typename T, typename... Ts> struct at<0, list<T, Ts...>> {
+  using type = T;
+};
+template <int N, typename T, typename... Ts> struct at<N, list<T, Ts...>> {
+  using type = typename at<N - 1, list<Ts...>>::type;
+};
+
+template <int N> struct fib {
+  static constexpr long value = fib<N - 1>::value + fib<N - 2>::value;
+};
+template <> struct fib<1> { static constexpr long value = 1; };
+template <> struct fib<0> { static constexpr long value = 0; };
+
+template <int... Is> struct sequence {};
+template <int N, int... Is> struct make_sequence : make_sequence<N - 1, N - 1, Is...> {};
+template <int... Is> struct make_sequence<0, Is...> {
+  using type = sequence<Is...>;
+};
+
+} // namespace meta
+
+namespace containers {
+
+template <typename T> class Vector {
+public:
+  Vector() = default;
+  ~Vector() { delete[] data_; }
+  void push_back(const T &value) {
+    if (size_ == capacity_)
+      grow();
+    data_[size_++] = value;
+  }
+  template <typename... Args> T &emplace_back(Args &&... args) {
+    push_back(T(meta::forward<Args>(args)...));
+    return data_[size_ - 1];
+  }
+  T &operator[](int i) { return data_[i]; }
+  const T &operator[](int i) const { return data_[i]; }
+  int size() const { return size_; }
+  T *begin() { return data_; }
+  T *end() { return data_ + size_; }
+
+private:
+  void grow() {
+    int capacity = capacity_ ? capacity_ * 2 : 4;
+    T *data = new T[capacity];
+    for (int i = 0; i < size_; ++i)
+      data[i] = data_[i];
+    delete[] data_;
+    data_ = data;
+    capacity_ = capacity;
+  }
+  T *data_ = nullptr;
+  int size_ = 0;
+  int capacity_ = 0;
+};
+
+template <typename K, typename V> struct Pair {
+  K first;
+  V second;
+};
+
+template <typename K, typename V, typename Less> class Map {
+public:
+  V &operator[](const K &key) {
+    for (auto &p : entries)
+      if (!Less()(p.first, key) && !Less()(key, p.first))
+        return p.second;
+    return entries.emplace_back(Pair<K, V>{key, V()}).second;
+  }
+  int size() const { return entries.size(); }
+
+private:
+  Vector<Pair<K, V>> entries;
+};
+
+template <typename T> struct LessThan {
+  bool operator()(const T &a, const T &b) const { return a < b; }
+};
+
+} // namespace containers
+
+namespace shapes {
+
+template <typename Derived> class Shape {
+public:
+  double area() const { return self().areaImpl(); }
+  double scaled(double factor) const { return area() * factor * factor; }
+
+private:
+  const Derived &self() const { return static_cast<const Derived &>(*this); }
+};
+
+class Square : public Shape<Square> {
+public:
+  explicit Square(double side) : side(side) {}
+  double areaImpl() const { return side * side; }
+
+private:
+  double side;
+};
+
+class Circle : public Shape<Circle> {
+public:
+  explicit Circle(double radius) : radius(radius) {}
+  double areaImpl() const { return 3.14159 * radius * radius; }
+
+private:
+  double radius;
+};
+
+template <typename... Shapes> double totalArea(const Shapes &... shapes) {
+  double areas[] = {0.0, shapes.area()...};
+  double total = 0;
+  for (double a : areas)
+    total += a;
+  return total;
+}
+
+} // namespace shapes
+
+namespace tuple {
+
+template <int I, typename T> struct Leaf {
+  T value;
+};
+
+template <typename Seq, typename... Ts> struct Impl;
+template <int... Is, typename... Ts>
+struct Impl<meta::sequence<Is...>, Ts...> : Leaf<Is, Ts>... {
+  Impl(Ts... values) : Leaf<Is, Ts>{values}... {}
+};
+
+template <typename... Ts>
+struct Tuple : Impl<typename meta::make_sequence<sizeof...(Ts)>::type, Ts...> {
+  using Base = Impl<typename meta::make_sequence<sizeof...(Ts)>::type, Ts...>;
+  Tuple(Ts... values) : Base(values...) {}
+};
+
+template <int I, typename T> T &get(Leaf<I, T> &leaf) { return leaf.value; }
+
+template <typename F, typename... Ts, int... Is>
+auto applyImpl(F f, Tuple<Ts...> &t, meta::sequence<Is...>)
+    -> decltype(f(get<Is>(t)...)) {
+  return f(get<Is>(t)...);
+}
+
+template <typename F, typename... Ts>
+auto apply(F f, Tuple<Ts...> &t)
+    -> decltype(applyImpl(f, t,
+                          typename meta::make_sequence<sizeof...(Ts)>::type())) {
+  return applyImpl(f, t, typename meta::make_sequence<sizeof...(Ts)>::type());
+}
+
+} // namespace tuple
+
+template <typename T>
+typename meta::enable_if<meta::is_same<T, int>::value, T>::type twice(T t) {
+  return 2 * t;
+}
+
+template <typename T>
+typename meta::enable_if<!meta::is_same<T, int>::value, T>::type twice(T t) {
+  return t + t;
+}
+
+struct Sum {
+  template <typename... Ts> double operator()(Ts... values) const {
+    double total = 0;
+    double all[] = {0.0, double(values)...};
+    for (double v : all)
+      total += v;
+    return total;
+  }
+};
+
+int main() {
+  static_assert(meta::fib<20>::value == 6765, "fib");
+  static_assert(meta::size<meta::list<int, char, double>>::value == 3, "size");
+  static_assert(
+      meta::is_same<meta::at<1, meta::list<int, char, double>>::type,
+                    char>::value,
+      "at");
+  using L = meta::push_back<meta::list<int>, long>::type;
+  static_assert(meta::size<L>::value == 2, "push_back");
+
+  containers::Vector<int> v;
+  for (int i = 0; i < 10; ++i)
+    v.push_back(twice(i));
+  containers::Map<int, double, containers::LessThan<int>> m;
+  for (int x : v)
+    m[x % 3] += twice(1.5);
+
+  shapes::Square square(2);
+  shapes::Circle circle(1);
+  double area = shapes::totalArea(square, circle, square);
+
+  tuple::Tuple<int, double, char> t(1, 2.5, 'c');
+  double sum = tuple::apply(Sum(), t);
+  return int(area + sum) + m.size();
+}
@@ -0,0 +1,150 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+/* End-to-end benchmark: runs the generator on the translation units of the
+ * corpus (see corpus/), with one job, and measures the translation units per
+ * second. A last run with --stats prints the time of each phase.
+ *
+ * Usage: bench_e2e [<generator> [<work directory>]]
+ */
+
+#include "bench.h"
+#include "filesystem.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::string quote(const std::string &arg) { return "\"" + arg + "\""; }
+
+std::string jsonString(const std::string &str) {
+  std::string result = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\')
+      result += '\\';
+    result += c;
+  }
+  return result + "\"";
+}
+
+bool writeFile(const std::string &file, llvm::StringRef content) {
+  if (auto error_code = write_file_atomically(file, content)) {
+    std::cerr << "Error writing " << file << ": " << error_code.message()
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Prints the phases of the line of the whole run in the --stats file
+void printPhases(const std::string &statsFile) {
+  auto buffer = llvm::MemoryBuffer::getFile(statsFile);
+  if (!buffer)
+    return;
+  llvm::StringRef lastLine = (*buffer)->getBuffer().rtrim().rsplit('\n').second;
+  if (lastLine.empty())
+    lastLine = (*buffer)->getBuffer().rtrim();
+  auto run = llvm::json::parse(lastLine);
+  if (!run) {
+    llvm::consumeError(run.takeError());
+    return;
+  }
+  const llvm::json::Object *object = run->getAsObject();
+  const llvm::json::Object *phases =
+      object ? object->getObject("phases") : nullptr;
+  if (!phases)
+    return;
+  std::vector<std::pair<std::string, double>> times;
+  for (const auto &phase : *phases) {
+    const llvm::json::Object *time = phase.second.getAsObject();
+    auto wall = time ? time->getNumber("wall") : llvm::None;
+    if (wall)
+      times.push_back({llvm::StringRef(phase.first).str(), *wall});
+  }
+  std::sort(times.begin(), times.end());
+  for (const auto &time : times) {
+    llvm::outs() << llvm::format("  %-20s %10.3f ms\n", time.first.c_str(),
+                                 time.second * 1000);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string generator = argc > 1 ? argv[1] : CODEBROWSER_GENERATOR;
+  std::string work = argc > 2 ? argv[2] : CODEBROWSER_BENCH_WORKDIR;
+
+  // The sources are copied, with the large file, so that they are all in one
+  // project directory
+  std::string src = work + "/src";
+  create_directories(src + "/qt");
+  for (const char *name :
+       {"templates.cpp", "macros.c", "signals.cpp", "qt/qobject.h"}) {
+    if (!writeFile(src + "/" + name, bench::readCorpusFile(name)))
+      return EXIT_FAILURE;
+  }
+  if (!writeFile(src + "/large.cpp", bench::largeSource()))
+    return EXIT_FAILURE;
+
+  const std::vector<std::pair<std::string, std::string>> commands = {
+      {"templates.cpp", "clang++ -std=c++11 -c templates.cpp"},
+      {"macros.c", "clang -std=c99 -c macros.c"},
+      {"signals.cpp", "clang++ -std=c++11 -Iqt -c signals.cpp"},
+      {"large.cpp", "clang++ -std=c++11 -c large.cpp"}};
+  std::string database = "[\n";
+  for (const auto &command : commands) {
+    database += "  { \"directory\": " + jsonString(src) +
+                ", \"file\": " + jsonString(src + "/" + command.first) +
+                ", \"command\": " + jsonString(command.second) + " },\n";
+  }
+  database.resize(database.size() - 2);
+  database += "\n]\n";
+  std::string databaseFile = work + "/compile_commands.json";
+  if (!writeFile(databaseFile, database))
+    return EXIT_FAILURE;
+
+  std::string output = work + "/output";
+  std::string statsFile = work + "/stats.jsonl";
+  std::string commandLine = quote(generator) + " -b " + quote(databaseFile) +
+                            " -a -p " + quote("bench:" + src) + " -o " +
+                            quote(output) + " -j 1";
+  std::string log = " > " + quote(work + "/log") + " 2>&1";
+  auto runGenerator = [&](const std::string &extraArgs) {
+    // The pages that exist are not generated again
+    llvm::sys::fs::remove_directories(output);
+    if (std::system((commandLine + extraArgs + log).c_str()) != 0) {
+      std::cerr << "Error running the generator, see " << work << "/log"
+                << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  };
+
+  bench::measure("generator end to end", commands.size(), "TUs",
+                 [&] { runGenerator(""); }, 5);
+  runGenerator(" --stats=" + quote(statsFile));
+  printPhases(statsFile);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+/* Micro-benchmark of Annotator::getReferenceAndTitle, which computes the ref
+ * (the mangled name) and the title of the declarations, on the declarations
+ * of the C++ files of the corpus (see corpus/), including the template
+ * instantiations. It is reached through Annotator::getContextStr for the
+ * functions and Annotator::getVisibleRef for the other declarations.
+ *  - cold: a new Annotator each time, so every ref is computed
+ *  - cached: the same Annotator, so the refs come from its cache
+ *
+ * Usage: bench_frontend
+ */
+
+#include "annotator.h"
+#include "bench.h"
+#include "projectmanager.h"
+
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/Frontend/ASTUnit.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct DeclCollector : clang::RecursiveASTVisitor<DeclCollector> {
+  std::vector<clang::NamedDecl *> decls;
+  bool shouldVisitTemplateInstantiations() const { return true; }
+  bool VisitNamedDecl(clang::NamedDecl *decl) {
+    if (decl->getDeclName().isIdentifier() && !decl->getName().empty())
+      decls.push_back(decl);
+    return true;
+  }
+};
+
+std::size_t lookUp(Annotator &annotator,
+                   const std::vector<clang::NamedDecl *> &decls) {
+  std::size_t size = 0;
+  for (auto *decl : decls) {
+    if (llvm::isa<clang::FunctionDecl>(decl))
+      size += annotator.getContextStr(decl).size();
+    else
+      size += annotator.getVisibleRef(decl).size();
+  }
+  return size;
+}
+
+} // namespace
+
+int main() {
+  llvm::SmallString<128> path;
+  if (llvm::sys::fs::createUniqueDirectory("codebrowser-bench", path)) {
+    std::cerr << "Error creating a temporary directory" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string output(path.str());
+  ProjectManager projectManager(output, "../data");
+
+  struct Source {
+    std::string name;
+    std::string code;
+  };
+  std::vector<Source> sources = {
+      {"templates.cpp", bench::readCorpusFile("templates.cpp")},
+      {"signals.cpp", bench::readCorpusFile("signals.cpp")},
+      {"large.cpp", bench::largeSource()}};
+  std::vector<std::string> args = {"-std=c++11",
+                                   "-I" + bench::corpusFile("qt")};
+
+  std::size_t size = 0;
+  for (const auto &source : sources) {
+    std::unique_ptr<clang::ASTUnit> ast =
+        clang::tooling::buildASTFromCodeWithArgs(
+            source.code, args, bench::corpusFile(source.name));
+    if (!ast) {
+      std::cerr << "Error parsing " << source.name << std::endl;
+      return EXIT_FAILURE;
+    }
+    clang::ASTContext &ctx = ast->getASTContext();
+    DeclCollector collector;
+    collector.TraverseDecl(ctx.getTranslationUnitDecl());
+
+    bench::measure("getReferenceAndTitle cold " + source.name,
+                   collector.decls.size(), "decls", [&] {
+                     Annotator annotator(projectManager);
+                     annotator.setSourceMgr(ctx.getSourceManager(),
+                                            ctx.getLangOpts());
+                     annotator.setMangleContext(ctx.createMangleContext());
+                     size += lookUp(annotator, collector.decls);
+                   });
+
+    Annotator annotator(projectManager);
+    annotator.setSourceMgr(ctx.getSourceManager(), ctx.getLangOpts());
+    annotator.setMangleContext(ctx.createMangleContext());
+    bench::measure("getReferenceAndTitle cached " + source.name,
+                   collector.decls.size(), "decls",
+                   [&] { size += lookUp(annotator, collector.decls); });
+  }
+  if (!size)
+    std::cerr << "Error: no ref was computed" << std::endl;
+
+  llvm::sys::fs::remove_directories(output);
+  return EXIT_SUCCESS;
+}
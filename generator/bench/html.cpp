@@ -0,0 +1,261 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+/* Benchmark of the HTML emission of Generator: replays a set of tags over a
+ * source buffer with Generator::generateCode, and with the character by
+ * character loop that was used before, and checks that both write the same
+ * bytes.
+ *
+ * Usage: bench_html [<source file> [<tag file>]]
+ *
+ * The tag file contains one tag per line: "<pos> <len> <name> <attributes>".
+ * Without tag file, tags are made up for the identifiers, numbers, strings and
+ * comments of the source. Without source, a synthetic source of 200k lines is
+ * used.
+ */
+
+#include "bench.h"
+#include "generator.h"
+
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using bench::RecordedTag;
+
+std::string syntheticSource() {
+  std::string source;
+  for (int i = 0; i < 200000; ++i) {
+    switch (i % 5) {
+    case 0:
+      source += "/* A comment with <html> & entities\n   on two lines */\n";
+      break;
+    case 1:
+      source += "int function" + std::to_string(i) + "(int a, int b) {\n";
+      break;
+    case 2:
+      source += "    return a < b && b > 0x42 ? a : b; // \"string\"\n";
+      break;
+    default:
+      source += "    std::vector<int> values" + std::to_string(i) +
+                " = { 1, 2, 3 };\n";
+    }
+  }
+  return source;
+}
+
+bool readTags(llvm::StringRef file, std::vector<RecordedTag> &tags) {
+  auto buffer = llvm::MemoryBuffer::getFile(file);
+  if (!buffer)
+    return false;
+  llvm::SmallVector<llvm::StringRef, 64> lines;
+  (*buffer)->getBuffer().split(lines, '\n', -1, false);
+  for (auto line : lines) {
+    RecordedTag t;
+    llvm::StringRef field;
+    std::tie(field, line) = line.split(' ');
+    field.getAsInteger(10, t.pos);
+    std::tie(field, line) = line.split(' ');
+    field.getAsInteger(10, t.len);
+    std::tie(field, line) = line.split(' ');
+    t.name = field.str();
+    t.attributes = line.str();
+    tags.push_back(std::move(t));
+  }
+  return true;
+}
+
+// The implementation before Generator::generateCode
+void legacyGenerateCode(llvm::raw_ostream &myfile, const char *begin,
+                        const char *end, const Generator::TagList &tags) {
+  typedef Generator::Tag Tag;
+  const char *c = begin;
+  unsigned int line = 1;
+  const char *bufferStart = c;
+
+  auto tags_it = tags.begin();
+  const char *next_start = tags_it != tags.end() ? (begin + tags_it->pos) : end;
+  const char *next_end = end;
+  const char *next = next_start;
+
+  auto flush = [&]() {
+    if (bufferStart != c)
+      myfile.write(bufferStart, c - bufferStart);
+    bufferStart = c;
+  };
+  std::string style = "style=\"background-color:lightcoral;\"";
+  std::string style2 = "";
+  myfile << "<tr " << style << " ><th " << style2 << " id=\"1\">" << 1
+         << "</th><td>";
+
+  std::deque<const Tag *> stack;
+
+  while (true) {
+    if (c == next) {
+      flush();
+      while (!stack.empty() && c >= next_end) {
+        const Tag *top = stack.back();
+        stack.pop_back();
+        tags.close(myfile, *top);
+        next_end = end;
+        if (!stack.empty()) {
+          top = stack.back();
+          next_end = begin + top->pos + top->len;
+        }
+      }
+      if (c >= end)
+        break;
+      while (c == next_start && tags_it != tags.end()) {
+        tags.open(myfile, *tags_it);
+        if (tags_it->len) {
+          stack.push_back(&(*tags_it));
+          next_end = c + tags_it->len;
+        }
+        tags_it++;
+        next_start = tags_it != tags.end() ? (begin + tags_it->pos) : end;
+      };
+      next = std::min(next_end, next_start);
+    }
+
+    switch (*c) {
+    case '\n': {
+      flush();
+      ++bufferStart;
+      ++line;
+      for (auto it = stack.crbegin(); it != stack.crend(); ++it)
+        tags.close(myfile, **it);
+      std::string style = "style=\"background-color:lightcoral;\"";
+      std::string style2 = "";
+      myfile << "</td></tr>\n"
+                "<tr "
+             << style << " ><th " << style2 << " id=\"" << line << "\">"
+             << line << "</th><td>";
+      for (auto it = stack.cbegin(); it != stack.cend(); ++it)
+        tags.open(myfile, **it);
+      break;
+    }
+    case '&':
+      flush();
+      ++bufferStart;
+      myfile << "&amp;";
+      break;
+    case '<':
+      flush();
+      ++bufferStart;
+      myfile << "&lt;";
+      break;
+    case '>':
+      flush();
+      ++bufferStart;
+      myfile << "&gt;";
+      break;
+    default:
+      break;
+    }
+    ++c;
+  }
+}
+
+template <typename F> double measure(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string source;
+  if (argc > 1) {
+    auto buffer = llvm::MemoryBuffer::getFile(argv[1]);
+    if (!buffer) {
+      std::cerr << "Error reading " << argv[1] << std::endl;
+      return EXIT_FAILURE;
+    }
+    source = (*buffer)->getBuffer().str();
+  } else {
+    source = syntheticSource();
+  }
+
+  std::vector<RecordedTag> recorded;
+  if (argc > 2) {
+    if (!readTags(argv[2], recorded)) {
+      std::cerr << "Error reading " << argv[2] << std::endl;
+      return EXIT_FAILURE;
+    }
+  } else {
+    bench::makeUpTags(source, recorded);
+  }
+
+  const char *begin = source.data();
+  const char *end = begin + source.size();
+  std::vector<bool> noLines;
+
+  Generator::TagList legacyTags;
+  for (const auto &t : recorded)
+    legacyTags.add(t.name, t.attributes, t.pos, t.len);
+  legacyTags.sort();
+  Generator generator;
+  for (const auto &t : recorded)
+    generator.addTag(t.name, t.attributes, t.pos, t.len);
+
+  // Check that the output is the same (this also sorts the tags)
+  std::string legacyOutput;
+  std::string output;
+  {
+    llvm::raw_string_ostream legacyOs(legacyOutput);
+    legacyGenerateCode(legacyOs, begin, end, legacyTags);
+    llvm::raw_string_ostream os(output);
+    generator.generateCode(os, begin, end, noLines, noLines);
+  }
+
+  // Measure with a buffer of the same size as the one of the generated files
+  const int iterations = 5;
+  llvm::raw_null_ostream null;
+  null.SetBufferSize(256 * 1024);
+  double legacyTime = measure([&] {
+    for (int i = 0; i < iterations; ++i)
+      legacyGenerateCode(null, begin, end, legacyTags);
+  }) / iterations;
+  double time = measure([&] {
+    for (int i = 0; i < iterations; ++i)
+      generator.generateCode(null, begin, end, noLines, noLines);
+  }) / iterations;
+
+  std::cout << "source: " << source.size() << " bytes, " << recorded.size()
+            << " tags, " << output.size() << " bytes of HTML\n"
+            << "character loop:         " << legacyTime * 1000 << " ms\n"
+            << "Generator::generateCode: " << time * 1000 << " ms\n";
+  if (output != legacyOutput) {
+    std::cerr << "Error: the output differs" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
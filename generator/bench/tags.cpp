@@ -0,0 +1,181 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+/* Micro-benchmark of the storage of the tags in Generator: compares
+ * Generator::TagList with the std::multiset<Tag> that was used before, on a
+ * synthetic file with the tag density of a big generated source.
+ *
+ * Usage: bench_tags [number of tokens]
+ */
+
+#include "generator.h"
+
+#include <llvm/Support/raw_ostream.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <set>
+#include <string>
+#include <tuple>
+
+static size_t allocationCount = 0;
+
+void *operator new(std::size_t size) {
+  ++allocationCount;
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  // The generator is built without exceptions
+  std::abort();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+// The implementation before Generator::TagList
+struct LegacyTag {
+  std::string name;
+  std::string attributes;
+  int pos;
+  int len;
+  bool operator<(const LegacyTag &other) const {
+    return (pos != other.pos) ? pos < other.pos
+                              : len == 0 || (other.len != 0 && len > other.len);
+  }
+  bool operator==(const LegacyTag &other) const {
+    return std::tie(pos, len, name, attributes) ==
+           std::tie(other.pos, other.len, other.name, other.attributes);
+  }
+};
+
+struct LegacyTagList {
+  std::multiset<LegacyTag> tags;
+  void add(std::string name, std::string attributes, int pos, int len) {
+    LegacyTag t = {std::move(name), std::move(attributes), pos, len};
+    auto it = tags.find(t);
+    if (it != tags.end() && *it == t)
+      return;
+    tags.insert(std::move(t));
+  }
+};
+
+// Calls f(name, attributes, pos, len) for each tag of the synthetic file
+template <typename F> void forEachTag(unsigned tokenCount, F f) {
+  static const char *const keywords[] = {"b", "em", "var", "q", "kbd"};
+  unsigned seed = 42;
+  auto rand = [&] {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+  };
+  int pos = 0;
+  for (unsigned i = 0; i < tokenCount; ++i) {
+    int len = 1 + rand() % 12;
+    switch (rand() % 8) {
+    case 0:
+    case 1:
+      f("a",
+        "href=\"#" + std::to_string(rand()) + "\" class=\"ref\" data-ref=\"" +
+            "_ZN3foo3barEv" + std::to_string(i % 1000) + "\"",
+        pos, len);
+      break;
+    case 2:
+      f("span", "class=\"local col" + std::to_string(rand() % 10) + " ref\"",
+        pos, len);
+      break;
+    case 3:
+      // A macro expansion: the same tag added twice, around a smaller one
+      f("span", "class=\"macro\" data-ref=\"_M/FOO\"", pos, len + 4);
+      f("span", "class=\"macro\" data-ref=\"_M/FOO\"", pos, len + 4);
+      f("a", "href=\"#x\"", pos, len);
+      break;
+    case 4:
+      f("a", "id=\"" + std::to_string(i) + "\"", pos, 0);
+      f("a", "id=\"" + std::to_string(i) + "\"", pos, 0);
+      f("a", "id=\"x" + std::to_string(i) + "\"", pos, 0);
+      f(keywords[rand() % 5], std::string(), pos, len);
+      break;
+    default:
+      f(keywords[rand() % 5], std::string(), pos, len);
+    }
+    pos += len + 1 + rand() % 3;
+  }
+}
+
+struct Result {
+  double seconds;
+  size_t allocations;
+  std::string output;
+};
+
+template <typename F> Result measure(F f) {
+  Result r;
+  size_t allocations = allocationCount;
+  auto start = std::chrono::steady_clock::now();
+  f(r.output);
+  auto stop = std::chrono::steady_clock::now();
+  r.allocations = allocationCount - allocations;
+  r.seconds = std::chrono::duration<double>(stop - start).count();
+  return r;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  unsigned tokenCount = argc > 1 ? std::atoi(argv[1]) : 500000;
+
+  // The output is the sequence of opening tags, so both can be compared
+  Result legacy = measure([&](std::string &out) {
+    LegacyTagList list;
+    forEachTag(tokenCount,
+               [&](const char *name, std::string attr, int pos, int len) {
+                 list.add(name, std::move(attr), pos, len);
+               });
+    llvm::raw_string_ostream os(out);
+    for (const auto &t : list.tags)
+      os << '<' << t.name << ' ' << t.attributes << ' ' << t.pos << ' '
+         << t.len << '\n';
+  });
+
+  Result tagList = measure([&](std::string &out) {
+    Generator::TagList list;
+    forEachTag(tokenCount,
+               [&](const char *name, std::string attr, int pos, int len) {
+                 list.add(name, attr, pos, len);
+               });
+    list.sort();
+    llvm::raw_string_ostream os(out);
+    for (const auto &t : list)
+      os << '<' << list.name(t) << ' ' << t.attributes << ' ' << t.pos << ' '
+         << t.len << '\n';
+  });
+
+  std::cout << "tokens: " << tokenCount << "\n"
+            << "std::multiset<Tag>:  " << legacy.seconds * 1000 << " ms, "
+            << legacy.allocations << " allocations\n"
+            << "Generator::TagList:  " << tagList.seconds * 1000 << " ms, "
+            << tagList.allocations << " allocations\n";
+  if (legacy.output != tagList.output) {
+    std::cerr << "Error: the tags are not in the same order" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -23,6 +23,7 @@
 
 #include "annotator.h"
 #include "qtsupport.h"
+#include "stats.h"
 #include <clang/AST/ASTConsumer.h>
 #include <clang/AST/Attr.h>
 #include <clang/AST/Decl.h>
@@ -358,6 +359,13 @@ struct BrowserASTVisitor : clang::RecursiveASTVisitor<BrowserASTVisitor> {
   bool TraverseDecl(clang::Decl *d) {
     if (!d)
       return true;
+    // Nothing is registered in the files that are not processed, such as the
+    // headers already generated by a previous translation unit. (The
+    // translation unit itself has no source range.)
+    if (annotator.canSkipDeclarations(d->getSourceRange())) {
+      Stats::count(Stats::SkippedDecls);
+      return true;
+    }
     auto saved = currentContext;
     if (clang::FunctionDecl::classof(d) || clang::RecordDecl::classof(d) ||
         clang::NamespaceDecl::classof(d) || clang::TemplateDecl::classof(d)) {
@@ -22,6 +22,7 @@
 #include "commenthandler.h"
 #include "annotator.h"
 #include "generator.h"
+#include "stats.h"
 #include "stringbuilder.h"
 #include <cctype>
 #include <clang/AST/ASTContext.h>
@@ -34,6 +35,7 @@
 #include <clang/Lex/Preprocessor.h>
 #include <clang/Sema/Lookup.h>
 #include <clang/Sema/Sema.h>
+#include <algorithm>
 #include <iostream>
 
 clang::NamedDecl *parseDeclarationReference(llvm::StringRef Text,
@@ -167,13 +169,15 @@ struct CommentHandler::CommentVisitor
   typedef clang::comments::ConstCommentVisitor<CommentVisitor> Base;
   CommentVisitor(Annotator &annotator, Generator &generator,
                  const clang::comments::CommandTraits &traits,
-                 clang::Sema &Sema)
-      : annotator(annotator), generator(generator), traits(traits), Sema(Sema) {
-  }
+                 clang::Sema &Sema,
+                 llvm::StringMap<clang::NamedDecl *> &declRefs)
+      : annotator(annotator), generator(generator), traits(traits), Sema(Sema),
+        declRefs(declRefs) {}
   Annotator &annotator;
   Generator &generator;
   const clang::comments::CommandTraits &traits;
   clang::Sema &Sema;
+  llvm::StringMap<clang::NamedDecl *> &declRefs;
 
   clang::NamedDecl *Decl = nullptr;
   std::string DeclRef;
@@ -239,10 +243,15 @@ struct CommentHandler::CommentVisitor
     std::string ref;
     auto Info = traits.getCommandInfo(C->getCommandID());
     if (Info->IsDeclarationCommand) {
-      auto D = parseDeclarationReference(
-          C->getText(), Sema,
-          Info->IsFunctionDeclarationCommand ||
-              Info->getID() == clang::comments::CommandTraits::KCI_fn);
+      bool isFunction = Info->IsFunctionDeclarationCommand ||
+                        Info->getID() == clang::comments::CommandTraits::KCI_fn;
+      // The same references are often repeated in the comments of a file
+      auto cached = declRefs.insert(
+          {std::string((isFunction ? "f" : "d") % C->getText()), nullptr});
+      if (cached.second)
+        cached.first->second =
+            parseDeclarationReference(C->getText(), Sema, isFunction);
+      auto D = cached.first->second;
       if (D) {
         Decl = D;
         DeclRef = annotator.getVisibleRef(Decl);
@@ -370,6 +379,7 @@ void CommentHandler::handleComment(Annotator &A, Generator &generator,
                                    clang::SourceLocation searchLocBegin,
                                    clang::SourceLocation searchLocEnd,
                                    clang::SourceLocation commentLoc) {
+  Stats::Timer timer(Stats::Comments);
   llvm::StringRef rawString(bufferStart + commentStart, len);
 
   handleUrlsInComment(generator, rawString, commentStart);
@@ -409,31 +419,92 @@ void CommentHandler::handleComment(Annotator &A, Generator &generator,
                                      PP.getSourceManager(), PP.getDiagnostics(),
                                      traits);
       auto fullComment = parser.parseFullComment();
-      CommentVisitor visitor{A, generator, traits, Sema};
+      CommentVisitor visitor{A, generator, traits, Sema, declRefs};
       visitor.visit(fullComment);
       if (!visitor.DeclRef.empty()) {
         for (auto &p : visitor.SubDocs)
-          docs.insert(std::move(p));
-        docs.insert(
-            {std::move(visitor.DeclRef), {rawString.str(), commentLoc}});
+          docs.push_back({A.refId(p.first), std::move(p.second)});
+        docs.push_back(
+            {A.refId(visitor.DeclRef), Doc{rawString.str(), commentLoc}});
         generator.addTag("i", attributes, commentStart, len);
         return;
       }
     }
 
   // Try to find a matching declaration
-  const auto &dof = decl_offsets;
-  // is there one and one single decl in that range.
-  auto it_before = dof.lower_bound(searchLocBegin);
-  auto it_after = dof.upper_bound(searchLocEnd);
-  if (it_before != dof.end() && it_after != dof.begin() &&
-      it_before == (--it_after)) {
-    if (it_before->second.second) {
-      docs.insert({it_before->second.first, {rawString.str(), commentLoc}});
-    } else {
-      attributes %= " data-doc=\"" % it_before->second.first % "\"";
+  auto file = decl_offsets.find(A.getSourceMgr().getFileID(commentLoc));
+  if (file != decl_offsets.end()) {
+    auto &dof = file->second;
+    if (!dof.sorted) {
+      std::sort(dof.decls.begin(), dof.decls.end(),
+                [](const DeclOffset &a, const DeclOffset &b) {
+                  return a.loc < b.loc;
+                });
+      dof.sorted = true;
+    }
+    // is there one and one single decl in that range.
+    auto it_before =
+        std::lower_bound(dof.decls.begin(), dof.decls.end(), searchLocBegin,
+                         [](const DeclOffset &d, clang::SourceLocation loc) {
+                           return d.loc < loc;
+                         });
+    auto it_after =
+        std::upper_bound(it_before, dof.decls.end(), searchLocEnd,
+                         [](clang::SourceLocation loc, const DeclOffset &d) {
+                           return loc < d.loc;
+                         });
+    if (it_after - it_before == 1) {
+      if (it_before->global) {
+        docs.push_back({it_before->id, Doc{rawString.str(), commentLoc}});
+      } else {
+        attributes %= " data-doc=\"" % A.refString(it_before->id) % "\"";
+      }
     }
   }
 
   generator.addTag("i", attributes, commentStart, len);
 }
+
+void CommentHandler::addDeclOffset(const clang::SourceManager &SM,
+                                   clang::SourceLocation loc, unsigned id,
+                                   bool global) {
+  // The comments are searched in the files, never in the macro expansions
+  if (loc.isInvalid() || loc.isMacroID())
+    return;
+  auto &file = decl_offsets[SM.getFileID(loc)];
+  if (!file.decls.empty() && loc < file.decls.back().loc)
+    file.sorted = false;
+  file.decls.push_back({loc, id, global});
+}
+
+void CommentHandler::sortDocs() {
+  std::stable_sort(docs.begin(), docs.end(),
+                   [](const std::pair<unsigned, Doc> &a,
+                      const std::pair<unsigned, Doc> &b) {
+                     return a.first < b.first;
+                   });
+}
+
+std::pair<CommentHandler::DocIterator, CommentHandler::DocIterator>
+CommentHandler::docsFor(unsigned id) const {
+  auto begin = std::lower_bound(
+      docs.begin(), docs.end(), id,
+      [](const std::pair<unsigned, Doc> &d, unsigned value) {
+        return d.first < value;
+      });
+  auto end = std::upper_bound(
+      begin, docs.end(), id,
+      [](unsigned value, const std::pair<unsigned, Doc> &d) {
+        return value < d.first;
+      });
+  return {begin, end};
+}
+
+size_t CommentHandler::memoryUsage() const {
+  size_t result = docs.capacity() * sizeof(docs[0]);
+  for (const auto &doc : docs)
+    result += doc.second.content.capacity();
+  for (const auto &file : decl_offsets)
+    result += file.second.decls.capacity() * sizeof(DeclOffset);
+  return result;
+}
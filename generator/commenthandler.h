@@ -22,13 +22,18 @@
 #pragma once
 
 #include <clang/Basic/SourceLocation.h>
-#include <map>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringMap.h>
 #include <string>
+#include <utility>
+#include <vector>
 
 class Annotator;
 namespace clang {
+class NamedDecl;
 class Preprocessor;
 class Sema;
+class SourceManager;
 } // namespace clang
 
 class Generator;
@@ -42,11 +47,24 @@ public:
     clang::SourceLocation loc;
   };
 
-  std::multimap<std::string, Doc> docs;
+  // [id of the ref (see Annotator::refId), doc], sorted by id in sortDocs()
+  std::vector<std::pair<unsigned, Doc>> docs;
+  using DocIterator = std::vector<std::pair<unsigned, Doc>>::const_iterator;
 
-  // fileId -> [ref, global_visibility]
-  std::multimap<clang::SourceLocation, std::pair<std::string, bool>>
-      decl_offsets;
+  // Sort the docs by id, keeping the order of the docs of the same ref
+  void sortDocs();
+  // The docs of the ref 'id'. The docs must be sorted.
+  std::pair<DocIterator, DocIterator> docsFor(unsigned id) const;
+
+  // Register the declaration of the ref 'id' at 'loc', for the comments next to
+  // it. A 'global' declaration gets the doc, the others only link to it.
+  void addDeclOffset(const clang::SourceManager &SM, clang::SourceLocation loc,
+                     unsigned id, bool global);
+
+  // Forget the declarations of a file once its comments are handled
+  void releaseFile(clang::FileID FID) { decl_offsets.erase(FID); }
+
+  size_t memoryUsage() const;
 
   /**
    * Handle the comment startig at @a commentstart within @a bufferStart with
@@ -59,4 +77,21 @@ public:
                      clang::SourceLocation searchLocBegin,
                      clang::SourceLocation searchLocEnd,
                      clang::SourceLocation commentLoc);
-};
\ No newline at end of file
+
+private:
+  struct DeclOffset {
+    clang::SourceLocation loc;
+    unsigned id;
+    bool global;
+  };
+  // The declarations of a file, sorted by location before the first lookup
+  struct FileDecls {
+    std::vector<DeclOffset> decls;
+    bool sorted = true;
+  };
+  llvm::DenseMap<clang::FileID, FileDecls> decl_offsets;
+
+  // The results of parseDeclarationReference, by kind and text of the
+  // reference
+  llvm::StringMap<clang::NamedDecl *> declRefs;
+};
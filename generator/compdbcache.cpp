@@ -0,0 +1,356 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#include "compdbcache.h"
+#include "filesystem.h"
+
+#include <clang/Basic/Version.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/JSONCompilationDatabase.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+/* The layout of the cache file. All the numbers are 32 bits little endian.
+ *  - The magic (8 bytes)
+ *  - The size and the modification time of the JSON file (64 bits each, low
+ *    half first), and its MD5 (32 hexadecimal characters)
+ *  - The counts: strings, files, commands, arguments, size of the hash table
+ *  - The offsets of the strings in the string data (count + 1)
+ *  - The files, sorted: name, first command, number of commands
+ *  - The commands: directory, file name, first argument, number of arguments
+ *  - The arguments: the strings of the command lines. The commands which have
+ *    the same arguments share them.
+ *  - The hash table of the file names: index of the file + 1, or 0 if empty
+ *  - The string data
+ */
+const char Magic[8] = {'C', 'B', 'C', 'D', 'B', '\0', '\0', '\1'};
+const std::size_t CountsOffset = sizeof(Magic) + 4 * 4 + 32;
+const std::size_t TablesOffset = CountsOffset + 5 * 4;
+
+void appendNumber(std::string &out, uint32_t value) {
+  char buffer[4];
+  llvm::support::endian::write32le(buffer, value);
+  out.append(buffer, sizeof(buffer));
+}
+
+uint32_t readNumber(const char *table, std::size_t index) {
+  return llvm::support::endian::read32le(table + 4 * index);
+}
+
+class CachedCompilationDatabase : public clang::tooling::CompilationDatabase {
+public:
+  // Returns false if the buffer is not a valid cache
+  bool init(std::unique_ptr<llvm::MemoryBuffer> buffer);
+
+  std::vector<clang::tooling::CompileCommand>
+  getCompileCommands(llvm::StringRef FilePath) const override;
+  std::vector<std::string> getAllFiles() const override;
+
+  uint64_t jsonSize = 0;
+  int64_t jsonMTime = 0;
+  llvm::StringRef jsonMD5;
+
+private:
+  // The commands of the index-th file of the table
+  std::vector<clang::tooling::CompileCommand> commandsOf(uint32_t file) const;
+
+  llvm::StringRef string(uint32_t id) const {
+    if (id >= stringCount)
+      return {};
+    uint32_t begin = readNumber(offsets, id);
+    uint32_t end = readNumber(offsets, id + 1);
+    if (begin > end || end > dataSize)
+      return {};
+    return llvm::StringRef(data + begin, end - begin);
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer> buffer;
+  uint32_t stringCount = 0, fileCount = 0, commandCount = 0, argCount = 0,
+           hashSize = 0;
+  const char *offsets = nullptr, *files = nullptr, *commands = nullptr,
+             *args = nullptr, *hash = nullptr, *data = nullptr;
+  std::size_t dataSize = 0;
+
+  // file name -> the files of the table with that name, built the first time
+  // a path is not found as it is.
+  mutable llvm::StringMap<std::vector<uint32_t>> filesByName;
+  mutable std::once_flag filesByNameBuilt;
+};
+
+bool CachedCompilationDatabase::init(std::unique_ptr<llvm::MemoryBuffer> B) {
+  buffer = std::move(B);
+  llvm::StringRef content = buffer->getBuffer();
+  if (content.size() < TablesOffset ||
+      std::memcmp(content.data(), Magic, sizeof(Magic)) != 0)
+    return false;
+  const char *header = content.data() + sizeof(Magic);
+  jsonSize = readNumber(header, 0) | uint64_t(readNumber(header, 1)) << 32;
+  jsonMTime = int64_t(readNumber(header, 2) |
+                      uint64_t(readNumber(header, 3)) << 32);
+  jsonMD5 = content.substr(sizeof(Magic) + 4 * 4, 32);
+
+  const char *counts = content.data() + CountsOffset;
+  stringCount = readNumber(counts, 0);
+  fileCount = readNumber(counts, 1);
+  commandCount = readNumber(counts, 2);
+  argCount = readNumber(counts, 3);
+  hashSize = readNumber(counts, 4);
+  if (hashSize == 0 || (hashSize & (hashSize - 1)) != 0 ||
+      hashSize < fileCount)
+    return false;
+  uint64_t tablesSize =
+      4 * (uint64_t(stringCount) + 1 + 3 * uint64_t(fileCount) +
+           4 * uint64_t(commandCount) + argCount + hashSize);
+  if (content.size() - TablesOffset < tablesSize)
+    return false;
+
+  offsets = content.data() + TablesOffset;
+  files = offsets + 4 * (std::size_t(stringCount) + 1);
+  commands = files + 4 * 3 * std::size_t(fileCount);
+  args = commands + 4 * 4 * std::size_t(commandCount);
+  hash = args + 4 * std::size_t(argCount);
+  data = hash + 4 * std::size_t(hashSize);
+  dataSize = content.size() - TablesOffset - tablesSize;
+  return true;
+}
+
+std::vector<clang::tooling::CompileCommand>
+CachedCompilationDatabase::getCompileCommands(llvm::StringRef FilePath) const {
+  // The files are stored the way JSONCompilationDatabase returns them
+  llvm::SmallString<256> nativePath;
+  llvm::sys::path::native(FilePath, nativePath);
+
+  uint32_t mask = hashSize - 1;
+  uint32_t slot = fnv1a(nativePath) & mask;
+  for (uint32_t probe = 0; probe < hashSize;
+       ++probe, slot = (slot + 1) & mask) {
+    uint32_t entry = readNumber(hash, slot);
+    if (entry == 0 || entry > fileCount)
+      break;
+    if (string(readNumber(files, 3 * (entry - 1))) == nativePath)
+      return commandsOf(entry - 1);
+  }
+
+  // Like the FileMatchTrie of JSONCompilationDatabase, find the file reached
+  // through another path (such as a symlink) among the ones with that name.
+  std::call_once(filesByNameBuilt, [this] {
+    for (uint32_t file = 0; file < fileCount; ++file) {
+      llvm::StringRef name = string(readNumber(files, 3 * file));
+      filesByName[llvm::sys::path::filename(name)].push_back(file);
+    }
+  });
+  auto it = filesByName.find(llvm::sys::path::filename(nativePath));
+  if (it == filesByName.end())
+    return {};
+  for (uint32_t file : it->second) {
+    if (llvm::sys::fs::equivalent(string(readNumber(files, 3 * file)),
+                                  nativePath))
+      return commandsOf(file);
+  }
+  return {};
+}
+
+std::vector<clang::tooling::CompileCommand>
+CachedCompilationDatabase::commandsOf(uint32_t file) const {
+  std::vector<clang::tooling::CompileCommand> result;
+  uint32_t first = readNumber(files, 3 * file + 1);
+  uint32_t count = readNumber(files, 3 * file + 2);
+  for (uint32_t i = first; i < first + count && i < commandCount; ++i) {
+    clang::tooling::CompileCommand command;
+    command.Directory = string(readNumber(commands, 4 * i)).str();
+#if CLANG_VERSION_MAJOR != 3 || CLANG_VERSION_MINOR >= 8
+    command.Filename = string(readNumber(commands, 4 * i + 1)).str();
+#endif
+    uint32_t firstArg = readNumber(commands, 4 * i + 2);
+    uint32_t argc = readNumber(commands, 4 * i + 3);
+    for (uint32_t a = firstArg; a < firstArg + argc && a < argCount; ++a)
+      command.CommandLine.push_back(string(readNumber(args, a)).str());
+    result.push_back(std::move(command));
+  }
+  return result;
+}
+
+std::vector<std::string> CachedCompilationDatabase::getAllFiles() const {
+  std::vector<std::string> result;
+  result.reserve(fileCount);
+  for (uint32_t file = 0; file < fileCount; ++file)
+    result.push_back(string(readNumber(files, 3 * file)).str());
+  return result;
+}
+
+bool writeCache(const clang::tooling::CompilationDatabase &db,
+                const std::string &cacheFile, uint64_t jsonSize,
+                int64_t jsonMTime, llvm::StringRef jsonMD5) {
+  llvm::StringMap<uint32_t> stringIds;
+  std::vector<llvm::StringRef> strings; // the keys of stringIds, by id
+  auto intern = [&](llvm::StringRef str) -> uint32_t {
+    auto inserted = stringIds.insert({str, uint32_t(strings.size())});
+    if (inserted.second)
+      strings.push_back(inserted.first->getKey());
+    return inserted.first->getValue();
+  };
+
+  std::vector<std::string> allFiles = db.getAllFiles();
+  std::sort(allFiles.begin(), allFiles.end());
+  allFiles.erase(std::unique(allFiles.begin(), allFiles.end()),
+                 allFiles.end());
+
+  std::string fileTable, commandTable, argTable;
+  uint32_t commandCount = 0, argCount = 0;
+  std::map<std::vector<uint32_t>, uint32_t> argVectors; // -> first argument
+  for (const auto &file : allFiles) {
+    auto fileCommands = db.getCompileCommands(file);
+    appendNumber(fileTable, intern(file));
+    appendNumber(fileTable, commandCount);
+    appendNumber(fileTable, fileCommands.size());
+    for (const auto &command : fileCommands) {
+      std::vector<uint32_t> ids;
+      for (const auto &arg : command.CommandLine)
+        ids.push_back(intern(arg));
+      auto inserted = argVectors.insert({ids, argCount});
+      if (inserted.second) {
+        for (uint32_t id : ids)
+          appendNumber(argTable, id);
+        argCount += ids.size();
+      }
+      appendNumber(commandTable, intern(command.Directory));
+#if CLANG_VERSION_MAJOR != 3 || CLANG_VERSION_MINOR >= 8
+      appendNumber(commandTable, intern(command.Filename));
+#else
+      appendNumber(commandTable, intern(file));
+#endif
+      appendNumber(commandTable, inserted.first->second);
+      appendNumber(commandTable, ids.size());
+      ++commandCount;
+    }
+  }
+
+  // Open addressing, with at least half of the slots empty
+  uint32_t hashSize = 1;
+  while (hashSize < 2 * allFiles.size())
+    hashSize *= 2;
+  std::vector<uint32_t> hashTable(hashSize, 0);
+  for (std::size_t i = 0; i < allFiles.size(); ++i) {
+    uint32_t slot = fnv1a(allFiles[i]) & (hashSize - 1);
+    while (hashTable[slot])
+      slot = (slot + 1) & (hashSize - 1);
+    hashTable[slot] = i + 1;
+  }
+
+  std::string content(Magic, sizeof(Magic));
+  appendNumber(content, uint32_t(jsonSize));
+  appendNumber(content, uint32_t(jsonSize >> 32));
+  appendNumber(content, uint32_t(uint64_t(jsonMTime)));
+  appendNumber(content, uint32_t(uint64_t(jsonMTime) >> 32));
+  content.append(jsonMD5.data(), jsonMD5.size());
+  appendNumber(content, strings.size());
+  appendNumber(content, allFiles.size());
+  appendNumber(content, commandCount);
+  appendNumber(content, argCount);
+  appendNumber(content, hashSize);
+  uint32_t offset = 0;
+  appendNumber(content, offset);
+  for (auto str : strings) {
+    offset += str.size();
+    appendNumber(content, offset);
+  }
+  content += fileTable;
+  content += commandTable;
+  content += argTable;
+  for (uint32_t entry : hashTable)
+    appendNumber(content, entry);
+  for (auto str : strings)
+    content.append(str.data(), str.size());
+
+  if (auto error_code = write_file_atomically(cacheFile, content)) {
+    std::cerr << "Error writing " << cacheFile << ": " << error_code.message()
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+std::unique_ptr<clang::tooling::CompilationDatabase>
+loadCompilationDatabaseCache(const std::string &jsonFile,
+                             const std::string &cacheFile,
+                             std::string &errorMessage) {
+  llvm::sys::fs::file_status status;
+  if (auto error_code = llvm::sys::fs::status(jsonFile, status)) {
+    errorMessage = "Could not read " + jsonFile + ": " + error_code.message();
+    return nullptr;
+  }
+  uint64_t jsonSize = status.getSize();
+  int64_t jsonMTime =
+      status.getLastModificationTime().time_since_epoch().count();
+
+  std::string jsonMD5;
+  auto B = llvm::MemoryBuffer::getFile(cacheFile, -1,
+                                       /*RequiresNullTerminator=*/false);
+  if (B) {
+    std::unique_ptr<CachedCompilationDatabase> cached(
+        new CachedCompilationDatabase);
+    if (cached->init(std::move(B.get()))) {
+      if (cached->jsonSize == jsonSize && cached->jsonMTime == jsonMTime)
+        return std::move(cached);
+      // The file was touched, check if the content really changed
+      auto json = llvm::MemoryBuffer::getFile(jsonFile);
+      if (json) {
+        jsonMD5 = md5Hex(json.get()->getBuffer());
+        if (cached->jsonMD5 == jsonMD5)
+          return std::move(cached);
+      }
+    }
+  }
+
+  using clang::tooling::JSONCompilationDatabase;
+  std::unique_ptr<clang::tooling::CompilationDatabase> db(
+      JSONCompilationDatabase::loadFromFile(jsonFile, errorMessage
+#if CLANG_VERSION_MAJOR >= 4
+          , clang::tooling::JSONCommandLineSyntax::AutoDetect
+#endif
+          ));
+  if (!db)
+    return nullptr;
+  if (jsonMD5.empty()) {
+    auto json = llvm::MemoryBuffer::getFile(jsonFile);
+    if (!json)
+      return db;
+    jsonMD5 = md5Hex(json.get()->getBuffer());
+  }
+  std::cerr << "Writing the compilation database cache " << cacheFile
+            << std::endl;
+  writeCache(*db, cacheFile, jsonSize, jsonMTime, jsonMD5);
+  return db;
+}
@@ -0,0 +1,52 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+namespace clang {
+namespace tooling {
+class CompilationDatabase;
+}
+} // namespace clang
+
+/**
+ * Loads the compilation database 'jsonFile' (a compile_commands.json) through
+ * a binary cache of its content in 'cacheFile' (--compdb-cache).
+ *
+ * When the cache was written from the same content of the JSON file, it is
+ * memory-mapped and used instead of parsing the JSON: the commands of a file
+ * are found with a hash table, and their arguments are strings shared by all
+ * the commands. Otherwise the JSON file is parsed and the cache is written
+ * again for the next runs.
+ *
+ * As with JSONCompilationDatabase, a file reached through another path (such
+ * as a symlink) is found: when the path is not in the database as it is, it is
+ * compared with sys::fs::equivalent to the files that have the same name.
+ *
+ * The database returned is read only, so the jobs can use it concurrently.
+ * Returns null and sets 'errorMessage' if the JSON could not be loaded.
+ */
+std::unique_ptr<clang::tooling::CompilationDatabase>
+loadCompilationDatabaseCache(const std::string &jsonFile,
+                             const std::string &cacheFile,
+                             std::string &errorMessage);
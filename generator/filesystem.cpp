@@ -25,7 +25,9 @@
 #include <llvm/ADT/SmallString.h>
 #include <llvm/ADT/Twine.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
 #include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
 
 #include <iostream>
 
@@ -191,3 +193,50 @@ std::string naive_uncomplete(llvm::StringRef base, llvm::StringRef path) {
     }
   }
 }
+
+std::error_code write_file_atomically(const llvm::Twine &path,
+                                      llvm::StringRef content) {
+  llvm::SmallString<256> tmpPath;
+  int fd;
+  if (auto ec =
+          llvm::sys::fs::createUniqueFile(path + ".tmp-%%%%%%", fd, tmpPath))
+    return ec;
+  {
+    llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+    os << content;
+    os.close();
+    if (os.has_error()) {
+      os.clear_error();
+      llvm::sys::fs::remove(tmpPath);
+      return std::make_error_code(std::errc::io_error);
+    }
+  }
+  if (auto ec = llvm::sys::fs::rename(tmpPath, path)) {
+    llvm::sys::fs::remove(tmpPath);
+    return ec;
+  }
+  return {};
+}
+
+uint32_t fnv1a(llvm::StringRef str) {
+  uint32_t hash = 2166136261u;
+  for (char c : str) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+std::string md5Hex(llvm::StringRef content) {
+  llvm::MD5 hash;
+  hash.update(content);
+  return md5Hex(hash);
+}
+
+std::string md5Hex(llvm::MD5 hash) {
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  llvm::SmallString<32> str;
+  llvm::MD5::stringifyResult(result, str);
+  return std::string(str.str());
+}
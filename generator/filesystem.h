@@ -25,9 +25,12 @@
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/Support/FileSystem.h>
 
+#include <cstdint>
+#include <string>
 #include <system_error>
 
 namespace llvm {
+class MD5;
 class Twine;
 }
 
@@ -44,3 +47,16 @@ std::string naive_uncomplete(llvm::StringRef base, llvm::StringRef path);
 void make_forward_slashes(char *str);
 void make_forward_slashes(std::string &str);
 void replace_invalid_filename_chars(std::string &str);
+
+/* Write the content to a temporary file, then rename it, so that the
+ * readers never see a partially written file */
+std::error_code write_file_atomically(const llvm::Twine &path,
+                                      llvm::StringRef content);
+
+/* FNV-1a: a hash that does not depend on the platform or the run */
+uint32_t fnv1a(llvm::StringRef str);
+
+/* The MD5 of the content, or of what was added to 'hash', in 32 hexadecimal
+ * characters */
+std::string md5Hex(llvm::StringRef content);
+std::string md5Hex(llvm::MD5 hash);
@@ -21,13 +21,22 @@
 
 #include "generator.h"
 #include "filesystem.h"
+#include "outputfile.h"
+#include "stats.h"
 #include "stringbuilder.h"
 
 #include <clang/Basic/Version.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/StringSwitch.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
 #include <llvm/Support/raw_ostream.h>
 
 template <int N>
@@ -115,68 +124,388 @@ Generator::escapeAttrForFilename(llvm::StringRef s,
   return llvm::StringRef(buffer.begin(), buffer.size());
 }
 
-void Generator::Tag::open(llvm::raw_ostream &myfile) const {
-  myfile << "<" << name;
-  if (!attributes.empty())
-    myfile << " " << attributes;
+static const char *const predefinedTagNames[] = {
+    "a", "b", "dfn", "em", "i", "kbd", "q", "span", "u", "var"};
+static const char *const predefinedClosingTags[] = {
+    "</a>", "</b>", "</dfn>",  "</em>", "</i>",
+    "</kbd>", "</q>", "</span>", "</u>", "</var>"};
+static const unsigned predefinedTagCount =
+    sizeof(predefinedTagNames) / sizeof(*predefinedTagNames);
+static_assert(sizeof(predefinedClosingTags) == sizeof(predefinedTagNames),
+              "missing closing tag");
+
+void Generator::TagList::add(llvm::StringRef name, llvm::StringRef attributes,
+                             int pos, int len) {
+  Tag t;
+  t.pos = pos;
+  t.len = len;
+  t.order = tags.size();
+  unsigned n = 0;
+  while (n < predefinedTagCount && name != predefinedTagNames[n])
+    ++n;
+  if (n == predefinedTagCount) {
+    auto it = std::find(otherNames.begin(), otherNames.end(), name);
+    n += it - otherNames.begin();
+    if (it == otherNames.end()) {
+      assert(n <= UINT8_MAX);
+      // Stored as "</name>", the name being in the middle
+      char *data = arena.Allocate<char>(name.size() + 3);
+      data[0] = '<';
+      data[1] = '/';
+      std::copy(name.begin(), name.end(), data + 2);
+      data[name.size() + 2] = '>';
+      otherNames.emplace_back(data, name.size() + 3);
+    }
+  }
+  t.name = n;
+  if (!attributes.empty()) {
+    char *data = arena.Allocate<char>(attributes.size());
+    std::copy(attributes.begin(), attributes.end(), data);
+    t.attributes = llvm::StringRef(data, attributes.size());
+  }
+  tags.push_back(t);
+  sorted = false;
+}
 
-  if (len) {
-    myfile << ">";
+void Generator::TagList::sort() {
+  if (sorted)
+    return;
+  sorted = true;
+  // This is the order of the opening tag. Order first by position, then by
+  // length (in the reverse order) with the exception of length of 0 which
+  // always goes first. The tags of length 0 at the same position are in the
+  // reverse order in which they were added, the other ones with the same
+  // position and length in that order.
+  std::sort(tags.begin(), tags.end(), [](const Tag &a, const Tag &b) {
+    if (a.pos != b.pos)
+      return a.pos < b.pos;
+    if ((a.len == 0) != (b.len == 0))
+      return a.len == 0;
+    if (a.len == 0)
+      return a.order > b.order;
+    if (a.len != b.len)
+      return a.len > b.len;
+    return a.order < b.order;
+  });
+
+  // Remove the tags which are the same as the first one added with the same
+  // position and length. (Hapens in macro for example)
+  auto first = tags.begin();
+  auto out = tags.begin();
+  for (auto it = tags.begin(); it != tags.end(); ++it) {
+    if (it->len != 0 && it != first && it->pos == first->pos &&
+        it->len == first->len && it->name == first->name &&
+        it->attributes == first->attributes)
+      continue;
+    if (it->pos != first->pos || it->len != first->len)
+      first = out;
+    *out++ = *it;
+  }
+  tags.erase(out, tags.end());
+}
+
+llvm::StringRef Generator::TagList::name(const Tag &tag) const {
+  return closing(tag).drop_front(2).drop_back();
+}
+
+llvm::StringRef Generator::TagList::closing(const Tag &tag) const {
+  if (tag.name < predefinedTagCount)
+    return predefinedClosingTags[tag.name];
+  return otherNames[tag.name - predefinedTagCount];
+}
+
+void Generator::TagList::appendOpening(std::string &out,
+                                       const Tag &tag) const {
+  llvm::StringRef closing = this->closing(tag);
+  out += '<';
+  out.append(closing.data() + 2, closing.size() - 3);
+  if (!tag.attributes.empty()) {
+    out += ' ';
+    out.append(tag.attributes.data(), tag.attributes.size());
+  }
+  out += '>';
+  if (!tag.len)
+    out.append(closing.data(), closing.size());
+}
+
+void Generator::TagList::open(llvm::raw_ostream &myfile, const Tag &tag) const {
+  llvm::StringRef closing = this->closing(tag);
+  myfile << '<' << closing.substr(2, closing.size() - 3);
+  if (!tag.attributes.empty())
+    myfile << ' ' << tag.attributes;
+
+  if (tag.len) {
+    myfile << '>';
   } else {
     // Unfortunately, html5 won't allow <a /> or <span /> tags, they need to be
     // explicitly closed
     //    myfile << "/>";
-    myfile << "></" << name << ">";
+    myfile << '>' << closing;
   }
 }
 
-void Generator::Tag::close(llvm::raw_ostream &myfile) const {
-  myfile << "</" << name << ">";
+void Generator::TagList::close(llvm::raw_ostream &myfile,
+                               const Tag &tag) const {
+  myfile << closing(tag);
 }
 
-void Generator::getCommonLines(std::vector<int> &commonLines,
-                               std::string filename) {
-  std::ifstream file(filename);
-  int a;
-  while (file >> a)
-    commonLines.emplace_back(a);
+// Returns the first of '\n', '&', '<' or '>' in [p, end), or end
+static const char *findSpecialChar(const char *p, const char *end) {
+  // Check 8 bytes at once: x has a zero byte iff (x - ones) & ~x & highs
+  const uint64_t ones = 0x0101010101010101ULL;
+  const uint64_t highs = 0x8080808080808080ULL;
+  while (end - p >= 8) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    uint64_t nl = v ^ (ones * '\n');
+    uint64_t amp = v ^ (ones * '&');
+    uint64_t lt = v ^ (ones * '<');
+    uint64_t gt = v ^ (ones * '>');
+    uint64_t found = ((nl - ones) & ~nl) | ((amp - ones) & ~amp) |
+                     ((lt - ones) & ~lt) | ((gt - ones) & ~gt);
+    if (found & highs)
+      break;
+    p += 8;
+  }
+  while (p != end && *p != '\n' && *p != '&' && *p != '<' && *p != '>')
+    ++p;
+  return p;
 }
-void Generator::getCoveredLines(std::vector<int> &coveredLines,
-                                std::string filename) {
+
+void Generator::getLines(std::vector<bool> &lines, const std::string &filename,
+                         unsigned lineCount) {
   std::ifstream file(filename);
   int a;
   while (file >> a) {
-    coveredLines.emplace_back(a);
+    if (a < 0 || unsigned(a) > lineCount)
+      continue;
+    if (unsigned(a) >= lines.size())
+      lines.resize(a + 1);
+    lines[a] = true;
+  }
+}
+
+llvm::raw_ostream &Generator::generateCode(
+    llvm::raw_ostream &myfile, const char *begin, const char *end,
+    const std::vector<bool> &commonLines, const std::vector<bool> &coveredLines,
+    const std::function<llvm::raw_ostream &(unsigned)> &nextChunk) {
+  auto hasLine = [](const std::vector<bool> &lines, unsigned int line) {
+    return line < lines.size() && lines[line];
+  };
+  auto commonStyle = [&](unsigned int line) {
+    return hasLine(commonLines, line)
+               ? "style=\"background-color:aquamarine;\""
+               : "style=\"background-color:lightcoral;\"";
+  };
+  auto coveredStyle = [&](unsigned int line) {
+    return hasLine(coveredLines, line) ? "style=\"background-color:gold;\""
+                                       : "";
+  };
+
+  const char *c = begin;
+  unsigned int line = 1;
+
+  tags.sort();
+  auto tags_it = tags.begin();
+  const char *next_start = tags_it != tags.end() ? (begin + tags_it->pos) : end;
+  const char *next_end = end;
+  const char *next = next_start;
+
+  llvm::raw_ostream *out = &myfile;
+  *out << "<tr " << commonStyle(1) << " ><th " << coveredStyle(1)
+       << " id=\"1\">" << 1 << "</th><td>";
+
+  // The tags that are open. Their opening tags need to be written again on
+  // each new line, so they are rendered in 'openings' the first time that
+  // happens (for the 'rendered' first tags of the stack).
+  struct OpenTag {
+    const Tag *tag;
+    size_t openingPos; // position in 'openings'
+  };
+  std::vector<OpenTag> stack;
+  std::string openings;
+  size_t rendered = 0;
+
+  while (true) {
+    if (c == next) {
+      while (!stack.empty() && c >= next_end) {
+        *out << tags.closing(*stack.back().tag);
+        if (rendered == stack.size()) {
+          --rendered;
+          openings.resize(stack.back().openingPos);
+        }
+        stack.pop_back();
+        next_end = end;
+        if (!stack.empty()) {
+          const Tag *top = stack.back().tag;
+          next_end = begin + top->pos + top->len;
+        }
+      }
+      if (c >= end)
+        break;
+      assert(c < end);
+      while (c == next_start && tags_it != tags.end()) {
+        assert(c == begin + tags_it->pos);
+        tags.open(*out, *tags_it);
+        if (tags_it->len) {
+          stack.push_back({&(*tags_it), 0});
+          next_end = c + tags_it->len;
+        }
+
+        tags_it++;
+        next_start = tags_it != tags.end() ? (begin + tags_it->pos) : end;
+      };
+
+      next = std::min(next_end, next_start);
+    }
+
+    // Copy everything up to the next special char or tag at once
+    const char *limit = std::min(next, end);
+    const char *special = findSpecialChar(c, limit);
+    out->write(c, special - c);
+    c = special;
+    if (c == limit) {
+      if (c == end)
+        next = end;
+      continue;
+    }
+
+    switch (*c) {
+    case '\n': {
+      ++line;
+      for (auto it = stack.crbegin(); it != stack.crend(); ++it)
+        *out << tags.closing(*it->tag);
+      for (; rendered < stack.size(); ++rendered) {
+        stack[rendered].openingPos = openings.size();
+        tags.appendOpening(openings, *stack[rendered].tag);
+      }
+      *out << "</td></tr>\n";
+      // The rows are complete, with the tags opened again, so a chunk can
+      // start at any of them
+      if (nextChunk && chunkLines && (line - 1) % chunkLines == 0)
+        out = &nextChunk((line - 1) / chunkLines);
+      *out << "<tr " << commonStyle(line) << " ><th " << coveredStyle(line)
+           << " id=\"" << line << "\">" << line << "</th><td>" << openings;
+      break;
+    }
+    case '&':
+      *out << "&amp;";
+      break;
+    case '<':
+      *out << "&lt;";
+      break;
+    case '>':
+      *out << "&gt;";
+      break;
+    }
+    ++c;
+  }
+  return *out;
+}
+
+void Generator::writeJsonString(llvm::raw_ostream &os, llvm::StringRef str) {
+  os << '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\')
+      os << '\\' << c;
+    else if (c == '\n')
+      os << "\\n";
+    else if (static_cast<unsigned char>(c) < 0x20)
+      os << "\\u" << llvm::format_hex_no_prefix(c, 4);
+    else
+      os << c;
   }
+  os << '"';
+}
+
+std::string Generator::chunkFileName(llvm::StringRef page, unsigned n) {
+  return page % ".chunk" % std::to_string(n) % ".html";
+}
+
+void Generator::removePage(llvm::StringRef page) {
+  OutputFile::removeFile(page + ".html");
+  OutputFile::removeFile(page + ".info.js");
+  removeChunks(page);
+}
+
+void Generator::removeChunks(llvm::StringRef page, unsigned n) {
+  for (;; ++n) {
+    std::string chunkFilename = chunkFileName(page, n);
+    if (!OutputFile::existingFormats(chunkFilename))
+      break;
+    OutputFile::removeFile(chunkFilename);
+  }
+}
+
+std::vector<std::string> Generator::bundledRefs() const {
+  static const llvm::StringRef attribute = "data-ref=\"";
+  std::vector<std::string> refs;
+  std::set<std::string> declared;
+  for (const auto &tag : tags) {
+    llvm::StringRef attributes = tag.attributes;
+    auto pos = attributes.find(attribute);
+    if (pos == llvm::StringRef::npos ||
+        attributes.find(" data-proj=\"") != llvm::StringRef::npos)
+      continue;
+    llvm::StringRef value = attributes.substr(pos + attribute.size());
+    value = value.substr(0, value.find('"'));
+    // Unescape what escapeAttr escaped
+    std::string ref;
+    while (!value.empty()) {
+      if (value.front() != '&') {
+        auto amp = value.find('&');
+        ref += value.substr(0, amp).str();
+        value = value.substr(std::min(amp, value.size()));
+        continue;
+      }
+      auto semicolon = value.find(';');
+      auto entity = value.substr(0, semicolon + 1);
+      char c = llvm::StringSwitch<char>(entity)
+                   .Case("&lt;", '<')
+                   .Case("&gt;", '>')
+                   .Case("&amp;", '&')
+                   .Case("&quot;", '"')
+                   .Case("&apos;", '\'')
+                   .Default('\0');
+      if (!c) {
+        ref += '&';
+        value = value.substr(1);
+        continue;
+      }
+      ref += c;
+      value = value.substr(entity.size());
+    }
+    replace_invalid_filename_chars(ref);
+    if (tags.name(tag) == "dfn")
+      declared.insert(ref);
+    refs.push_back(std::move(ref));
+  }
+  std::sort(refs.begin(), refs.end());
+  refs.erase(std::unique(refs.begin(), refs.end()), refs.end());
+  std::stable_partition(
+      refs.begin(), refs.end(),
+      [&](const std::string &ref) { return declared.count(ref) != 0; });
+  return refs;
 }
 
 void Generator::generate(llvm::StringRef outputPrefix, std::string dataPath,
                          const std::string &filename, const char *begin,
                          const char *end, llvm::StringRef footer,
                          llvm::StringRef warningMessage,
-                         const std::set<std::string> &interestingDefinitions) {
+                         const std::set<std::string> &interestingDefinitions,
+                         llvm::StringRef overlayPath) {
+  Stats::Timer timer(Stats::Generate);
   std::string real_filename = outputPrefix % "/" % filename % ".html";
   // Make sure the parent directory exist:
   create_directories(llvm::StringRef(real_filename).rsplit('/').first);
 
-#if CLANG_VERSION_MAJOR == 3 && CLANG_VERSION_MINOR <= 5
-  std::string error;
-  llvm::raw_fd_ostream myfile(real_filename.c_str(), error,
-                              llvm::sys::fs::F_None);
-  if (!error.empty()) {
-    std::cerr << "Error generating " << real_filename << " ";
-    std::cerr << error << std::endl;
-    return;
-  }
-#else
   std::error_code error_code;
-  llvm::raw_fd_ostream myfile(real_filename, error_code, llvm::sys::fs::F_None);
+  OutputFile myfile(real_filename, error_code);
   if (error_code) {
     std::cerr << "Error generating " << real_filename << " ";
     std::cerr << error_code.message() << std::endl;
     return;
   }
-#endif
 
   int count = std::count(filename.begin(), filename.end(), '/');
   std::string root_path = "..";
@@ -187,6 +516,18 @@ void Generator::generate(llvm::StringRef outputPrefix, std::string dataPath,
   if (dataPath.size() && dataPath[0] == '.')
     dataPath = root_path % "/" % dataPath;
 
+  const std::string page = outputPrefix % "/" % filename;
+  // With the blob store, what changes from one run to another (the footer,
+  // with the date and the revision, and the URLs of the other projects) is
+  // in <page>.info.js, so that the pages of the same file are the same blob
+  const bool separateInfo = !OutputFile::blobStore.empty();
+  const unsigned lineCount = std::count(begin, end, '\n') + 1;
+  const unsigned chunkCount = chunkLines ? (lineCount - 1) / chunkLines + 1 : 1;
+  if (chunkLines) {
+    // The page may have had more chunks before
+    removeChunks(page, chunkCount);
+  }
+
   myfile << "<!doctype html>\n" // Use HTML 5 doctype
             "<html>\n<head>\n";
   myfile << "<meta name=\"viewport\" content=\"width=device-width, "
@@ -199,6 +540,10 @@ void Generator::generate(llvm::StringRef outputPrefix, std::string dataPath,
     myfile << "<meta name=\"woboq:interestingDefinitions\" content=\""
            << interestingDefitionsStr << " \"/>\n";
   }
+  if (chunkCount > 1) {
+    myfile << "<meta name=\"woboq:chunkLines\" content=\"" << chunkLines
+           << "\"/>\n";
+  }
   myfile << "<link rel=\"stylesheet\" href=\"" << dataPath
          << "/qtcreator.css\" title=\"QtCreator\"/>\n";
   myfile << "<link rel=\"alternate stylesheet\" href=\"" << dataPath
@@ -210,7 +555,9 @@ void Generator::generate(llvm::StringRef outputPrefix, std::string dataPath,
   myfile << "<script>var file = '" << filename << "'; var root_path = '"
          << root_path << "'; var data_path = '" << dataPath
          << "'; var ecma_script_api_version = 2;";
-  if (!projects.empty()) {
+  if (hasRefsBundle)
+    myfile << " var refs_bundle = true;";
+  if (!projects.empty() && !separateInfo) {
     myfile << "var projects = {";
     bool first = true;
     for (auto it : projects) {
@@ -222,6 +569,10 @@ void Generator::generate(llvm::StringRef outputPrefix, std::string dataPath,
     myfile << "};";
   }
   myfile << "</script>\n";
+  if (separateInfo) {
+    myfile << "<script src='" << llvm::StringRef(filename).rsplit('/').second
+           << ".info.js'></script>\n";
+  }
   myfile << "<script src='" << dataPath << "/codebrowser.js'></script>\n";
 
   myfile << "</head>\n<body><div id='header'><h1 id='breadcrumb'><span>Browse "
@@ -258,131 +609,65 @@ void Generator::generate(llvm::StringRef outputPrefix, std::string dataPath,
   //** here we put the code
   myfile << "<table class=\"code\">\n";
 
-  const char *c = begin;
-  unsigned int line = 1;
-  const char *bufferStart = c;
-
-  auto tags_it = tags.cbegin();
-  const char *next_start =
-      tags_it != tags.cend() ? (begin + tags_it->pos) : end;
-  const char *next_end = end;
-  const char *next = next_start;
-
-  std::vector<int> commonLines;
-  std::vector<int> coveredLines;
-
-  std::string exactFilename = "";
-  const size_t lastSlashIdx = filename.find_last_of("\\/");
-  if (std::string::npos != lastSlashIdx)
-    exactFilename = filename.substr(lastSlashIdx + 1);
-  else
-    exactFilename = filename;
-
-  getCommonLines(commonLines, exactFilename + std::string(".common"));
-  getCoveredLines(coveredLines, exactFilename + std::string(".coverage"));
-
-  auto flush = [&]() {
-    if (bufferStart != c)
-      myfile.write(bufferStart, c - bufferStart);
-    bufferStart = c;
-  };
-  std::string style = "";
-  std::string style2 = "";
-  if (std::find(commonLines.begin(), commonLines.end(), 1) != commonLines.end())
-    style = "style=\"background-color:aquamarine;\"";
-  else
-    style = "style=\"background-color:lightcoral;\"";
-
-  if (std::find(coveredLines.begin(), coveredLines.end(), 1) !=
-      coveredLines.end())
-    style2 = "style=\"background-color:gold;\"";
-
-  myfile << "<tr " << style << " ><th " << style2 << " id=\"1\">" << 1
-         << "</th><td>";
-
-  std::deque<const Tag *> stack;
-
-  while (true) {
-    if (c == next) {
-      flush();
-      while (!stack.empty() && c >= next_end) {
-        const Tag *top = stack.back();
-        stack.pop_back();
-        top->close(myfile);
-        next_end = end;
-        if (!stack.empty()) {
-          top = stack.back();
-          next_end = begin + top->pos + top->len;
+  // Lines highlighted from the overlay files
+  std::vector<bool> commonLines;
+  std::vector<bool> coveredLines;
+  std::string overlayFilename;
+  if (!overlayPath.empty()) {
+    overlayFilename = overlayPath % "/" % filename;
+  } else {
+    // Legacy: the basename in the current directory
+    const size_t lastSlashIdx = filename.find_last_of("\\/");
+    if (std::string::npos != lastSlashIdx)
+      overlayFilename = filename.substr(lastSlashIdx + 1);
+    else
+      overlayFilename = filename;
+  }
+  getLines(commonLines, overlayFilename + ".common", lineCount);
+  getLines(coveredLines, overlayFilename + ".coverage", lineCount);
+
+  // The chunk files are tables with the rows of their lines. The page has an
+  // empty row for each of them, which the browser replaces by these rows.
+  std::unique_ptr<OutputFile> chunk;
+  llvm::raw_null_ostream failedChunk;
+  std::function<llvm::raw_ostream &(unsigned)> nextChunk;
+  if (chunkCount > 1) {
+    nextChunk = [&](unsigned n) -> llvm::raw_ostream & {
+      if (n == 1) {
+        for (unsigned i = 1; i < chunkCount; ++i) {
+          myfile << "<tr class=\"chunk\" data-chunk=\"" << i
+                 << "\" data-lines=\""
+                 << std::min(chunkLines, lineCount - i * chunkLines)
+                 << "\"><td colspan=\"2\"></td></tr>\n";
         }
+      } else if (chunk) {
+        *chunk << "</table>\n";
       }
-      if (c >= end)
-        break;
-      assert(c < end);
-      while (c == next_start && tags_it != tags.cend()) {
-        assert(c == begin + tags_it->pos);
-        tags_it->open(myfile);
-        if (tags_it->len) {
-          stack.push_back(&(*tags_it));
-          next_end = c + tags_it->len;
-        }
-
-        tags_it++;
-        next_start = tags_it != tags.cend() ? (begin + tags_it->pos) : end;
-      };
+      std::string chunkFilename = chunkFileName(page, n);
+      std::error_code error_code;
+      chunk.reset(new OutputFile(chunkFilename, error_code));
+      if (error_code) {
+        std::cerr << "Error generating " << chunkFilename << " ";
+        std::cerr << error_code.message() << std::endl;
+        chunk.reset();
+        return failedChunk;
+      }
+      *chunk << "<table class=\"code\">\n";
+      return *chunk;
+    };
+  }
 
-      next = std::min(next_end, next_start);
-    }
+  llvm::raw_ostream &last =
+      generateCode(myfile, begin, end, commonLines, coveredLines, nextChunk);
+  Stats::count(Stats::Tags, tags.size());
+  Stats::count(Stats::FilesEmitted);
 
-    switch (*c) {
-    case '\n': {
-      flush();
-      ++bufferStart; // skip the new line
-      ++line;
-      for (auto it = stack.crbegin(); it != stack.crend(); ++it)
-        (*it)->close(myfile);
-      std::string style = "";
-      std::string style2 = "";
-      if (std::find(commonLines.begin(), commonLines.end(), line) !=
-          commonLines.end())
-        style = "style=\"background-color:aquamarine;\"";
-      else
-        style = "style=\"background-color:lightcoral;\"";
-
-      if (std::find(coveredLines.begin(), coveredLines.end(), line) !=
-          coveredLines.end())
-        style2 = "style=\"background-color:gold;\"";
-
-      myfile << "</td></tr>\n"
-                "<tr "
-             << style << " ><th " << style2 << " id=\"" << line << "\">" << line
-             << "</th><td>";
-      for (auto it = stack.cbegin(); it != stack.cend(); ++it)
-        (*it)->open(myfile);
-      break;
-    }
-    case '&':
-      flush();
-      ++bufferStart;
-      myfile << "&amp;";
-      break;
-    case '<':
-      flush();
-      ++bufferStart;
-      myfile << "&lt;";
-      break;
-    case '>':
-      flush();
-      ++bufferStart;
-      myfile << "&gt;";
-      break;
-    default:
-      break;
-    }
-    ++c;
+  last << "</td></tr>\n";
+  if (chunk) {
+    *chunk << "</table>\n";
+    chunk.reset();
   }
-
-  myfile << "</td></tr>\n"
-            "</table>"
+  myfile << "</table>"
             "<hr/>";
 
   if (!warningMessage.empty()) {
@@ -393,7 +678,31 @@ void Generator::generate(llvm::StringRef outputPrefix, std::string dataPath,
 
   myfile << "<p id='footer'>\n";
 
-  myfile.write(footer.begin(), footer.size());
+  if (!separateInfo)
+    myfile.write(footer.begin(), footer.size());
 
   myfile << "</p></div></body></html>\n";
+
+  if (separateInfo) {
+    std::string info;
+    llvm::raw_string_ostream os(info);
+    os << "var projects = {";
+    bool first = true;
+    for (const auto &it : projects) {
+      if (!first)
+        os << ", ";
+      first = false;
+      writeJsonString(os, it.first);
+      os << " : ";
+      writeJsonString(os, it.second);
+    }
+    os << "};\nvar page_footer = ";
+    writeJsonString(os, footer);
+    os << ";\n";
+    std::string infoFilename = page % ".info.js";
+    if (auto error_code = OutputFile::writeFile(infoFilename, os.str())) {
+      std::cerr << "Error generating " << infoFilename << " ";
+      std::cerr << error_code.message() << std::endl;
+    }
+  }
 }
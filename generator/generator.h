@@ -22,6 +22,10 @@
 #pragma once
 
 #include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Allocator.h>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <set>
 #include <string>
@@ -31,51 +35,93 @@
 namespace llvm {
 class raw_ostream;
 }
+template <typename A, typename B> struct string_builder;
 
 /* This class generate the HTML out of a file with the said tags.
  */
 class Generator {
-
+public:
   struct Tag {
-    std::string name;
-    std::string attributes;
+    llvm::StringRef attributes; // in the arena of the TagList
     int pos;
     int len;
-    bool operator<(const Tag &other) const {
-      // This is the order of the opening tag. Order first by position, then by
-      // length
-      // (in the reverse order) with the exception of length of 0 which always
-      // goes first. Ordered first by position, and then by lenth (reverse
-      // order)
-      return (pos != other.pos)
-                 ? pos < other.pos
-                 : len == 0 || (other.len != 0 && len > other.len);
-    }
-    bool operator==(const Tag &other) const {
-      return std::tie(pos, len, name, attributes) ==
-             std::tie(other.pos, other.len, other.name, other.attributes);
+    unsigned order; // order in which the tags were added
+    uint8_t name;   // index in the names of the TagList
+  };
+
+  /* The tags of a file. They are appended to a vector, and sorted once all of
+   * them were added. */
+  class TagList {
+  public:
+    void add(llvm::StringRef name, llvm::StringRef attributes, int pos,
+             int len);
+    /* Sort the tags in the order of the opening tags, and remove the
+     * duplicates. Must be called before iterating. */
+    void sort();
+
+    std::vector<Tag>::const_iterator begin() const { return tags.begin(); }
+    std::vector<Tag>::const_iterator end() const { return tags.end(); }
+    size_t size() const { return tags.size(); }
+    // The memory allocated for the tags
+    size_t memoryUsage() const {
+      return tags.capacity() * sizeof(Tag) + arena.getTotalMemory();
     }
-    void open(llvm::raw_ostream &myfile) const;
-    void close(llvm::raw_ostream &myfile) const;
+
+    llvm::StringRef name(const Tag &tag) const;
+    // The closing tag, "</name>"
+    llvm::StringRef closing(const Tag &tag) const;
+    // Appends to 'out' what open() writes
+    void appendOpening(std::string &out, const Tag &tag) const;
+    void open(llvm::raw_ostream &myfile, const Tag &tag) const;
+    void close(llvm::raw_ostream &myfile, const Tag &tag) const;
+
+  private:
+    std::vector<Tag> tags;
+    bool sorted = true;
+    llvm::BumpPtrAllocator arena;
+    // Closing tags of the names that are not in the predefined list
+    std::vector<llvm::StringRef> otherNames;
   };
 
-  std::multiset<Tag> tags;
+private:
+  TagList tags;
 
   std::map<std::string, std::string> projects;
-  void getCommonLines(std::vector<int> &commonLines, std::string filename);
-  void getCoveredLines(std::vector<int> &coveredLines, std::string filename);
+  // Set lines[n] for each line number n listed in the file, ignoring the
+  // numbers past lineCount (the number of lines of the page)
+  void getLines(std::vector<bool> &lines, const std::string &filename,
+                unsigned lineCount);
 
 public:
-  void addTag(std::string name, std::string attributes, int pos, int len) {
+  void addTag(llvm::StringRef name, llvm::StringRef attributes, int pos,
+              int len) {
     if (len < 0) {
       return;
     }
-    Tag t = {std::move(name), std::move(attributes), pos, len};
-    auto it = tags.find(t);
-    if (it != tags.end() && *it == t)
-      return; // Hapens in macro for example
-    tags.insert(std::move(t));
+    tags.add(name, attributes, pos, len);
   }
+  template <typename A, typename B>
+  void addTag(llvm::StringRef name, const string_builder<A, B> &attributes,
+              int pos, int len) {
+    addTag(name, std::string(attributes), pos, len);
+  }
+  size_t memoryUsage() const { return tags.memoryUsage(); }
+  // The refs/ file names of the data-ref of the tags that are in the refs/ of
+  // this output (not of another project), sorted, with the ones declared in
+  // this page first
+  std::vector<std::string> bundledRefs() const;
+  // Whether the page has a bundle of its refs (see RefsBundles)
+  bool hasRefsBundle = false;
+  // When the file has more lines, the page only has the first chunkLines lines
+  // and the next chunks of lines are in other files, that the browser loads
+  // when they are shown (see --chunk-lines)
+  unsigned chunkLines = 0;
+  // The file of the n-th chunk (n > 0) of the page 'page' (without .html)
+  static std::string chunkFileName(llvm::StringRef page, unsigned n);
+  // Removes the chunks of 'page' from the n-th one
+  static void removeChunks(llvm::StringRef page, unsigned n = 1);
+  // Removes the files of the page 'page' (without .html)
+  static void removePage(llvm::StringRef page);
   void addProject(std::string a, std::string b) {
     projects.insert({std::move(a), std::move(b)});
   }
@@ -83,7 +129,19 @@ public:
   void generate(llvm::StringRef outputPrefix, std::string dataPath,
                 const std::string &filename, const char *begin, const char *end,
                 llvm::StringRef footer, llvm::StringRef warningMessage,
-                const std::set<std::string> &interestingDefitions);
+                const std::set<std::string> &interestingDefitions,
+                llvm::StringRef overlayPath);
+
+  /* Writes the rows of the table with the code between begin and end, and
+   * the tags. commonLines and coveredLines are the lines highlighted by the
+   * overlays (see getLines). When 'nextChunk' is given, the rows of each of
+   * the next chunks of chunkLines lines are written in the stream it returns
+   * for that chunk. Returns the stream of the last row, which is left open. */
+  llvm::raw_ostream &generateCode(
+      llvm::raw_ostream &myfile, const char *begin, const char *end,
+      const std::vector<bool> &commonLines,
+      const std::vector<bool> &coveredLines,
+      const std::function<llvm::raw_ostream &(unsigned)> &nextChunk = {});
 
   static llvm::StringRef escapeAttr(llvm::StringRef,
                                     llvm::SmallVectorImpl<char> &buffer);
@@ -100,6 +158,8 @@ public:
   static llvm::StringRef
   escapeAttrForFilename(llvm::StringRef s, llvm::SmallVectorImpl<char> &buffer);
   static void escapeAttr(llvm::raw_ostream &os, llvm::StringRef s);
+  // Writes 's' as a quoted JSON (and javascript) string
+  static void writeJsonString(llvm::raw_ostream &os, llvm::StringRef s);
 
   struct EscapeAttr {
     llvm::StringRef value;
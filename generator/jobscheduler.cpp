@@ -0,0 +1,106 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+
+#include "jobscheduler.h"
+#include "stringbuilder.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <algorithm>
+#include <numeric>
+
+// The number of files with a cost used to scale the heuristic
+static const std::size_t CalibrationSamples = 64;
+
+JobScheduler::JobScheduler(const std::string &outputPrefix)
+    : costs(outputPrefix % "/.jobCosts") {}
+
+std::vector<std::size_t>
+JobScheduler::order(const std::vector<std::string> &files,
+                    llvm::function_ref<double(std::size_t)> heuristic) {
+  std::vector<double> cost(files.size());
+  std::vector<std::size_t> known, unknown;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::size_t i = 0; i < files.size(); ++i) {
+      uint64_t milliseconds;
+      if (costs.lookup(files[i], milliseconds)) {
+        cost[i] = milliseconds / 1000.;
+        known.push_back(i);
+      } else {
+        unknown.push_back(i);
+      }
+    }
+  }
+
+  // seconds per unit of the heuristic, for some of the files with a cost
+  std::vector<double> rates;
+  if (!unknown.empty()) {
+    std::size_t step =
+        std::max<std::size_t>(1, known.size() / CalibrationSamples);
+    for (std::size_t k = 0; k < known.size(); k += step) {
+      double h = heuristic(known[k]);
+      if (h > 0)
+        rates.push_back(cost[known[k]] / h);
+    }
+  }
+  double rate = 1;
+  if (!rates.empty()) {
+    auto median = rates.begin() + rates.size() / 2;
+    std::nth_element(rates.begin(), median, rates.end());
+    rate = *median;
+  }
+  for (auto i : unknown)
+    cost[i] = heuristic(i) * rate;
+
+  // The files of the same cost stay in their order
+  std::vector<std::size_t> result(files.size());
+  std::iota(result.begin(), result.end(), 0);
+  std::stable_sort(result.begin(), result.end(),
+                   [&](std::size_t a, std::size_t b) {
+                     return cost[a] > cost[b];
+                   });
+  return result;
+}
+
+double JobScheduler::heuristic(llvm::StringRef file,
+                               llvm::ArrayRef<std::string> command) {
+  uint64_t size = 0;
+  llvm::sys::fs::file_size(file, size);
+  // Each include path is accounted as what it typically brings
+  unsigned includePaths = 0;
+  for (const auto &arg : command) {
+    llvm::StringRef A(arg);
+    if (A.startswith("-I") || A == "-isystem" || A == "-iquote" ||
+        A == "-include")
+      ++includePaths;
+  }
+  return double(size) + 64 * 1024. * includePaths;
+}
+
+void JobScheduler::record(llvm::StringRef file, double seconds) {
+  std::lock_guard<std::mutex> lock(mutex);
+  costs.set(file, uint64_t(seconds * 1000));
+}
+
+void JobScheduler::save() {
+  std::lock_guard<std::mutex> lock(mutex);
+  costs.save();
+}
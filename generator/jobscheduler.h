@@ -0,0 +1,70 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+
+#pragma once
+
+#include "mainfilevalues.h"
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringRef.h>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * The order in which the translation units are processed with -j
+ *
+ * The most expensive translation units are started first, so that a long one
+ * does not start last and keep the other threads idle at the end of the run.
+ *
+ * The cost of a translation unit is the time it took in the previous runs in
+ * the same output directory (see record()), kept in <output>/.jobCosts. The
+ * translation units that were never processed are estimated with heuristic(),
+ * scaled to seconds with the ones that were.
+ */
+class JobScheduler {
+public:
+  explicit JobScheduler(const std::string &outputPrefix);
+
+  // Returns the indexes of the 'files' (canonicalized main files), the most
+  // expensive first. 'heuristic(i)' is called for some of the files: it
+  // estimates their cost in any unit, for example with heuristic() below.
+  std::vector<std::size_t>
+  order(const std::vector<std::string> &files,
+        llvm::function_ref<double(std::size_t)> heuristic);
+
+  // A cost, in no particular unit, from the size of the source and the number
+  // of include paths of its command
+  static double heuristic(llvm::StringRef file,
+                          llvm::ArrayRef<std::string> command);
+
+  // Records the time, in seconds, taken by the translation unit of the
+  // (canonicalized) main file, for the next runs. Only the translation units
+  // that were processed successfully are recorded.
+  void record(llvm::StringRef file, double seconds);
+  // Writes the costs if they changed
+  void save();
+
+private:
+  std::mutex mutex;
+  MainFileValues costs; // in milliseconds
+};
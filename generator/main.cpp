@@ -29,17 +29,40 @@
 #include <clang/Frontend/CompilerInstance.h>
 #include <llvm/Support/Path.h>
 #include <llvm/ADT/StringSwitch.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <clang/Basic/Version.h>
+#if CLANG_VERSION_MAJOR >= 8
+#include <llvm/Support/VirtualFileSystem.h>
+namespace vfs = llvm::vfs;
+#else
+#include <clang/Basic/VirtualFileSystem.h>
+namespace vfs = clang::vfs;
+#endif
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <limits>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 #include "annotator.h"
 #include "stringbuilder.h"
 #include "browserastvisitor.h"
 #include "preprocessorcallback.h"
 #include "projectmanager.h"
 #include "filesystem.h"
+#include "manifest.h"
+#include "outputfile.h"
+#include "pchcache.h"
+#include "searchindex.h"
+#include "merger.h"
+#include "compdbcache.h"
+#include "stats.h"
+#include "memorybudget.h"
+#include "jobscheduler.h"
+#include "refsbundles.h"
 #include "compat.h"
 #include <ctime>
 
@@ -83,10 +106,119 @@ cl::opt<std::string> DataPath(
     cl::desc("Data url where all the javascript and css files are found. Can be absolute, or relative to the output directory. Defaults to ../data"),
     cl::Optional);
 
+cl::opt<std::string> OverlayPath(
+    "overlay-dir",
+    cl::value_desc("path"),
+    cl::desc("Directory containing the line overlays: <path>/<project>/<file>.common and <path>/<project>/<file>.coverage list the line numbers to highlight. By default, they are looked up as <basename>.common and <basename>.coverage in the current directory"),
+    cl::Optional);
+
 cl::opt<bool> ProcessAllSources(
     "a",
     cl::desc("Process all files from the compile_commands.json. If this argument is passed, the list of sources does not need to be passed"));
 
+cl::opt<unsigned> Jobs(
+    "j",
+    cl::value_desc("N"),
+    cl::desc("Number of translation units to process in parallel. Defaults to 1"),
+    cl::init(1));
+
+cl::opt<unsigned> PageJobs(
+    "page-jobs",
+    cl::value_desc("N"),
+    cl::desc("Number of threads writing the pages of a translation unit in parallel, once its files are highlighted. It helps the translation units that generate many files. Defaults to 1"),
+    cl::init(1));
+
+cl::opt<unsigned> ChunkLines(
+    "chunk-lines",
+    cl::value_desc("N"),
+    cl::desc("Split the pages of the files that have more than N lines: the page only contains the first N lines, and the next chunks of N lines are in other files that the browser loads when they are scrolled to. It makes the very large files show faster"),
+    cl::init(0));
+
+cl::opt<bool> Incremental(
+    "incremental",
+    cl::desc("Only process again the files whose content, includes or compile command changed since the previous run in the same output directory. What the other files generated is kept. The state is stored in <output>/.manifest, so the output directory must have been generated with this option from the start"));
+
+cl::opt<std::string> Shard(
+    "shard",
+    cl::value_desc("i/N"),
+    cl::desc("Only process the i-th of N stable subsets of the sources (0 <= i < N). Each shard needs its own output directory. Use the 'merge' subcommand to combine them"),
+    cl::Optional);
+
+cl::opt<std::string> Compress(
+    "compress",
+    cl::value_desc("gzip,brotli"),
+    cl::desc("Also write the generated pages and index files compressed, as <file>.gz and/or <file>.br, so a web server can serve them as they are (for example nginx with gzip_static or brotli_static). Comma separated list of formats"),
+    cl::Optional);
+
+cl::opt<bool> CompressedOnly(
+    "compressed-only",
+    cl::desc("With --compress, do not keep the uncompressed files. The web server must then be configured to serve the compressed files for the uncompressed URLs"));
+
+cl::opt<std::string> BlobStore(
+    "blob-store",
+    cl::value_desc("directory"),
+    cl::desc("Write the content of the pages and of the refs/ files in that directory, once per distinct content, and make the files of the output directory hard links to it. The directory can be shared by the outputs of several revisions or projects. The footer and the URLs of the other projects of a page are then in <page>.info.js, so the pages of an unchanged file are the same"),
+    cl::Optional);
+
+cl::opt<std::string> PchCacheDir(
+    "pch-cache",
+    cl::value_desc("directory"),
+    cl::desc("Precompile the includes at the beginning of the sources in that directory, and load them in the translation units that have the same compile flags and start with the same includes. The directory can be kept between runs"),
+    cl::Optional);
+
+cl::opt<bool> LazyMacroExpansions(
+    "lazy-macro-expansions",
+    cl::desc("Do not compute the expansions of the macros shown in the tooltips. The browser shows the definition of the macro instead, from the page it is in"));
+
+cl::opt<std::string> CompdbCache(
+    "compdb-cache",
+    cl::value_desc("file"),
+    cl::desc("Binary cache of the compilation database given with -b. It is used instead of parsing the JSON when it was written from the same content, and written again otherwise. It can be shared by the shards"),
+    cl::Optional);
+
+cl::opt<std::string> MaxMemory(
+    "max-memory",
+    cl::value_desc("size"),
+    cl::desc("Process fewer translation units in parallel than -j when their estimated memory would exceed that size (for example 16G or 512M). The estimates are the memory the translation units used in the previous runs with this option in the same output directory"),
+    cl::Optional);
+
+cl::opt<std::string> StatsPath(
+    "stats",
+    cl::value_desc("file"),
+    cl::desc("Write in that file a JSON line with the time spent in each phase and the counters of every translation unit, and one for the whole run"),
+    cl::Optional);
+
+cl::opt<unsigned> StatsTop(
+    "stats-top",
+    cl::value_desc("N"),
+    cl::desc("With --stats, the number of slowest translation units printed at the end (default 10)"),
+    cl::init(10));
+
+cl::opt<bool> RefsBundlesOption(
+    "refs-bundles",
+    cl::desc("Also write, next to each page, a <page>.refs bundle with the refs/ files of the symbols it uses, which the browser fetches at once instead of one refs/ file per symbol. The bundles copy the refs/ files, so each ref takes space again in every page that uses it. The biggest refs/ files are not bundled, and a bundle is limited to 256 KiB (the refs of the symbols declared in the page first); the browser fetches the others from refs/"));
+
+cl::opt<bool> Serve(
+    "serve",
+    cl::desc("Keep running, and read the sources to process from the standard input, one per line. An empty line (or the end of the input) generates the sources read so far, and the translation units whose inputs changed, into the existing output directory as with --incremental, then writes 'done' on the standard output, or 'failed' if a translation unit could not be processed or the indexes could not be written. The indexes are only built again when pages were generated or removed. The compilation database, the projects and the caches are only loaded once"));
+
+cl::SubCommand MergeCommand(
+    "merge",
+    "Merge the output directories generated with --shard into one");
+
+cl::list<std::string> MergeInputs(
+    cl::Positional,
+    cl::desc("<shard output directories>..."),
+    cl::OneOrMore,
+    cl::sub(MergeCommand));
+
+cl::opt<std::string> MergeOutputPath(
+    "o",
+    cl::value_desc("output path"),
+    cl::desc("Output directory where the shards are merged"),
+    cl::Required,
+    cl::sub(MergeCommand));
+
 cl::extrahelp extra(
 
 R"(
@@ -98,6 +230,11 @@ Simple generation without compile command or project (compile command specified
 
 With a project
   codebrowser_generator -b $PWD/compile_commands.js -a -p codebrowser:$PWD -o ~/public_html/code
+
+Split in two shards, then merge them
+  codebrowser_generator -b $PWD/compile_commands.js -a -p codebrowser:$PWD -o /tmp/shard0 --shard 0/2
+  codebrowser_generator -b $PWD/compile_commands.js -a -p codebrowser:$PWD -o /tmp/shard1 --shard 1/2
+  codebrowser_generator merge -o ~/public_html/code /tmp/shard0 /tmp/shard1
 )");
 
 #if 1
@@ -115,6 +252,13 @@ enum class DatabaseType {
     ProcessFullDirectory
 };
 
+/* The origin of the compile command, recorded for the incremental generation */
+struct CommandInfo {
+    std::string file; // The file for which the command is in the database
+    std::string hash; // See Manifest::hashCommand
+    std::vector<std::string> precompiledInputs; // See PchCache::Use
+};
+
 struct BrowserDiagnosticClient : clang::DiagnosticConsumer {
     Annotator &annotator;
     BrowserDiagnosticClient(Annotator &fm) : annotator(fm) {}
@@ -149,18 +293,25 @@ class BrowserASTConsumer : public clang::ASTConsumer
     clang::CompilerInstance &ci;
     Annotator annotator;
     DatabaseType WasInDatabase;
+    bool *parsed;
+    Stats::Timer parseTimer { Stats::Parse };
 public:
-    BrowserASTConsumer(clang::CompilerInstance &ci, ProjectManager &projectManager, DatabaseType WasInDatabase)
-        : clang::ASTConsumer(), ci(ci), annotator(projectManager), WasInDatabase(WasInDatabase)
+    BrowserASTConsumer(clang::CompilerInstance &ci, ProjectManager &projectManager, DatabaseType WasInDatabase,
+                       const CommandInfo &commandInfo, bool *parsed)
+        : clang::ASTConsumer(), ci(ci), annotator(projectManager), WasInDatabase(WasInDatabase), parsed(parsed)
     {
         //ci.getLangOpts().DelayedTemplateParsing = (true);
         ci.getPreprocessor().enableIncrementalProcessing();
+        annotator.setCommandInfo(commandInfo.file, commandInfo.hash);
+        annotator.setPrecompiledInputs(commandInfo.precompiledInputs);
     }
     virtual ~BrowserASTConsumer() {
 	        ci.getDiagnostics().setClient(new clang::IgnoringDiagConsumer, true);
 	 }
 
     virtual void Initialize(clang::ASTContext& Ctx) override {
+        if (parsed)
+            *parsed = true;
         annotator.setSourceMgr(Ctx.getSourceManager(), Ctx.getLangOpts());
         annotator.setMangleContext(Ctx.createMangleContext());
         ci.getPreprocessor().addPPCallbacks(maybe_unique(new PreprocessorCallback(
@@ -184,12 +335,15 @@ public:
        /* if (PP.getDiagnostics().hasErrorOccurred())
             return;*/
         ci.getPreprocessor().getDiagnostics().getClient();
+        parseTimer.stop();
 
+        {
+            Stats::Timer timer(Stats::Traversal);
+            BrowserASTVisitor v(annotator);
+            v.TraverseDecl(Ctx.getTranslationUnitDecl());
+        }
 
-        BrowserASTVisitor v(annotator);
-        v.TraverseDecl(Ctx.getTranslationUnitDecl());
-
-
+        // Also records the peak memory of the translation unit for --max-memory
         annotator.generate(ci.getSema(), WasInDatabase != DatabaseType::NotInDatabase);
     }
 
@@ -201,8 +355,17 @@ public:
 };
 
 class BrowserAction : public clang::ASTFrontendAction {
+public:
+    struct Status {
+        std::string inFile; // Set once the file is marked as processed
+        bool parsed = false; // Set once the parsing started (after loading the precompiled header)
+    };
+private:
     static std::set<std::string> processed;
+    static std::mutex processedMutex;
     DatabaseType WasInDatabase;
+    CommandInfo commandInfo;
+    Status *status;
 protected:
 #if CLANG_VERSION_MAJOR == 3 && CLANG_VERSION_MINOR <= 5
     virtual clang::ASTConsumer *
@@ -211,29 +374,50 @@ protected:
 #endif
     CreateASTConsumer(clang::CompilerInstance &CI,
                                            llvm::StringRef InFile) override {
-        if (processed.count(InFile.str())) {
-            std::cerr << "Skipping already processed " << InFile.str()<< std::endl;
-            return nullptr;
+        {
+            std::lock_guard<std::mutex> lock(processedMutex);
+            if (!processed.insert(InFile.str()).second) {
+                std::cerr << "Skipping already processed " << InFile.str()<< std::endl;
+                return nullptr;
+            }
         }
-        processed.insert(InFile.str());
+        if (status)
+            status->inFile = InFile.str();
 
         CI.getFrontendOpts().SkipFunctionBodies = true;
 
-        return maybe_unique(new BrowserASTConsumer(CI, *projectManager, WasInDatabase));
+        return maybe_unique(new BrowserASTConsumer(CI, *projectManager, WasInDatabase, commandInfo,
+                                                   status ? &status->parsed : nullptr));
     }
 
 public:
-    BrowserAction(DatabaseType WasInDatabase = DatabaseType::InDatabase) : WasInDatabase(WasInDatabase) {}
+    BrowserAction(DatabaseType WasInDatabase = DatabaseType::InDatabase, CommandInfo commandInfo = {},
+                  Status *status = nullptr)
+        : WasInDatabase(WasInDatabase), commandInfo(std::move(commandInfo)), status(status) {}
     virtual bool hasCodeCompletionSupport() const override { return true; }
     static ProjectManager *projectManager;
+
+    // So the file can be processed again, when it was not parsed
+    static void forget(const std::string &inFile) {
+        std::lock_guard<std::mutex> lock(processedMutex);
+        processed.erase(inFile);
+    }
+
+    // So the files can be processed again in the next generation (with --serve)
+    static void forgetAll() {
+        std::lock_guard<std::mutex> lock(processedMutex);
+        processed.clear();
+    }
 };
 
 
 std::set<std::string> BrowserAction::processed;
+std::mutex BrowserAction::processedMutex;
 ProjectManager *BrowserAction::projectManager = nullptr;
 
 static bool proceedCommand(std::vector<std::string> command, llvm::StringRef Directory,
-                           llvm::StringRef file, clang::FileManager *FM, DatabaseType WasInDatabase) {
+                           llvm::StringRef file, clang::FileManager *FM, DatabaseType WasInDatabase,
+                           CommandInfo commandInfo = {}) {
     // This code change all the paths to be absolute paths
     //  FIXME:  it is a bit fragile.
     bool previousIsDashI = false;
@@ -294,23 +478,106 @@ static bool proceedCommand(std::vector<std::string> command, llvm::StringRef Dir
 
     command.push_back("-Qunused-arguments");
     command.push_back("-Wno-unknown-warning-option");
-    clang::tooling::ToolInvocation Inv(command, new BrowserAction(WasInDatabase), FM);
 
-    if (!hasNoStdInc) {
-      // Map the builtins includes
-      const EmbeddedFile *f = EmbeddedFiles;
-      while (f->filename) {
-          Inv.mapVirtualFile(f->filename, {f->content , f->size } );
-          f++;
-      }
+    // The builtins includes are in the file system of FM (see builtinsFileSystem)
+    auto run = [&](const std::vector<std::string> &args, CommandInfo info, BrowserAction::Status &status) {
+        clang::tooling::ToolInvocation Inv(args, new BrowserAction(WasInDatabase, std::move(info), &status), FM);
+        return Inv.run();
+    };
+
+    Stats::TranslationUnit statsUnit(file);
+    BrowserAction::Status status;
+    bool result = false;
+    bool usedPch = false;
+    PchCache::Use pch;
+    PchCache *pchCache = BrowserAction::projectManager->pchCache;
+    if (pchCache && pchCache->find(command, file, *BrowserAction::projectManager, FM, pch)) {
+        std::vector<std::string> pchCommand = command;
+        for (auto &arg : PchCache::arguments(pch))
+            pchCommand.push_back(std::move(arg));
+        CommandInfo pchCommandInfo = commandInfo;
+        pchCommandInfo.precompiledInputs = pch.files;
+        result = run(pchCommand, std::move(pchCommandInfo), status);
+        usedPch = result || status.parsed || status.inFile.empty();
+        if (!usedPch) {
+            // The precompiled header could not be loaded (one of its headers changed)
+            std::cerr << "Not using the outdated precompiled header for " << file.str() << std::endl;
+            pchCache->discard(pch);
+            BrowserAction::forget(status.inFile);
+            status = BrowserAction::Status();
+        }
     }
-    bool result = Inv.run();
+    if (!usedPch)
+        result = run(command, std::move(commandInfo), status);
     if (!result) {
         std::cerr << "Error: The file was not recognized as source code: " << file.str() <<  std::endl;
     }
     return result;
 }
 
+// The index files to which the translation units append (see OutputFile::prepareAppend)
+static std::vector<std::string> appendedIndexFiles(const std::string &outputPrefix) {
+    std::vector<std::string> files = { outputPrefix + "/fileIndex", outputPrefix + "/otherIndex" };
+    std::set<std::string> fnSearch;
+    std::error_code EC;
+    for (llvm::sys::fs::directory_iterator it(outputPrefix + "/fnSearch", EC), DirEnd;
+         it != DirEnd && !EC; it.increment(EC)) {
+        fnSearch.insert(OutputFile::stripFormatSuffix(it->path()).str());
+    }
+    files.insert(files.end(), fnSearch.begin(), fnSearch.end());
+    return files;
+}
+
+/**
+ * The builtins includes, in /builtins. Built once from the embedded data, which
+ * the buffers reference without copying it, and shared by all the FileManagers.
+ * It is not modified after that, so the threads can read it concurrently.
+ */
+static llvm::IntrusiveRefCntPtr<vfs::InMemoryFileSystem> builtinsFileSystem() {
+    static llvm::IntrusiveRefCntPtr<vfs::InMemoryFileSystem> fs = [] {
+        llvm::IntrusiveRefCntPtr<vfs::InMemoryFileSystem> fs(new vfs::InMemoryFileSystem);
+        for (const EmbeddedFile *f = EmbeddedFiles; f->filename; f++) {
+            fs->addFile(f->filename, 0,
+                        llvm::MemoryBuffer::getMemBuffer(llvm::StringRef(f->content, f->size), f->filename));
+        }
+        return fs;
+    }();
+    return fs;
+}
+
+/**
+ * Calls job(index, FM) for every index in [0, count), using up to 'jobCount'
+ * threads. Each thread has its own FileManager, as it is not thread safe.
+ * The FileManagers see the real file system with the builtins on top of it.
+ * With a single job, everything is run in the calling thread.
+ * The indexes are started in the given 'order' if it is not empty.
+ */
+template <typename Job>
+static void runJobs(std::size_t count, unsigned jobCount, Job job,
+                    const std::vector<std::size_t> &order = {}) {
+    auto worker = [&](std::atomic<std::size_t> &next) {
+        llvm::IntrusiveRefCntPtr<vfs::OverlayFileSystem> fs(
+            new vfs::OverlayFileSystem(vfs::getRealFileSystem()));
+        fs->pushOverlay(builtinsFileSystem());
+        clang::FileManager FM({"."}, fs);
+        FM.Retain();
+        for (std::size_t i = next++; i < count; i = next++)
+            job(order.empty() ? i : order[i], FM);
+    };
+
+    std::atomic<std::size_t> next(0);
+    if (jobCount <= 1 || count <= 1) {
+        worker(next);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < jobCount && i < count; ++i)
+        threads.emplace_back(worker, std::ref(next));
+    for (auto &t : threads)
+        t.join();
+}
+
 int main(int argc, const char **argv) {
     std::string ErrorMessage;
     std::unique_ptr<clang::tooling::CompilationDatabase> Compilations(
@@ -326,11 +593,44 @@ int main(int argc, const char **argv) {
 
     llvm::cl::ParseCommandLineOptions(argc, argv);
 
+    if (MergeCommand) {
+        std::string output = MergeOutputPath;
+#ifdef _WIN32
+        make_forward_slashes(output);
+#endif
+        return mergeOutputs(MergeInputs, output) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
 #ifdef _WIN32
     make_forward_slashes(OutputPath._Get_data()._Myptr());
 #endif
 
+    if (!Compress.empty()) {
+        unsigned formats = 0;
+        if (!OutputFile::parseFormats(Compress, formats))
+            return EXIT_FAILURE;
+        OutputFile::defaultFormats = CompressedOnly ? formats : (formats | OutputFile::Plain);
+    } else if (CompressedOnly) {
+        std::cerr << "--compressed-only requires --compress" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!BlobStore.empty()) {
+        OutputFile::blobStore = clang::tooling::getAbsolutePath(BlobStore);
+        if (auto EC = create_directories(OutputFile::blobStore)) {
+            std::cerr << "Error: could not create " << OutputFile::blobStore << ": " << EC.message() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!StatsPath.empty() && !Stats::enable(StatsPath))
+        return EXIT_FAILURE;
+
     ProjectManager projectManager(OutputPath, DataPath);
+    projectManager.overlayPath = OverlayPath;
+    projectManager.lazyMacroExpansions = LazyMacroExpansions;
+    projectManager.pageJobs = PageJobs;
+    projectManager.chunkLines = ChunkLines;
     for(std::string &s : ProjectPaths) {
         auto colonPos = s.find(':');
         if (colonPos >= s.size()) {
@@ -360,9 +660,59 @@ int main(int argc, const char **argv) {
     }
     BrowserAction::projectManager = &projectManager;
 
+    std::unique_ptr<PchCache> pchCache;
+    if (!PchCacheDir.empty()) {
+        std::string directory = clang::tooling::getAbsolutePath(PchCacheDir);
+        if (auto EC = create_directories(directory)) {
+            std::cerr << "Error: could not create " << directory << ": " << EC.message() << std::endl;
+            return EXIT_FAILURE;
+        }
+        pchCache.reset(new PchCache(std::move(directory)));
+        projectManager.pchCache = pchCache.get();
+    }
+
+    JobScheduler scheduler(projectManager.outputPrefix);
+    auto elapsedSince = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    std::unique_ptr<RefsBundles> refsBundles;
+    if (RefsBundlesOption) {
+        refsBundles.reset(new RefsBundles(projectManager.outputPrefix));
+        projectManager.refsBundles = refsBundles.get();
+        projectManager.refsDatabase.bundles = refsBundles.get();
+    }
+    // The refs/ files of the invalidated records change, also in the bundles of the other pages
+    auto touchRefs = [&](const std::vector<Manifest::Record> &records) {
+        if (!refsBundles)
+            return;
+        for (const auto &record : records) {
+            for (std::string ref : record.refs) {
+                replace_invalid_filename_chars(ref);
+                refsBundles->touch(ref);
+            }
+        }
+    };
+
+    std::unique_ptr<MemoryBudget> memoryBudget;
+    if (!MaxMemory.empty()) {
+        uint64_t budget;
+        if (!MemoryBudget::parseSize(MaxMemory, budget)) {
+            std::cerr << "Invalid --max-memory option: " << MaxMemory << " (expected a size such as 16G or 512M)" << std::endl;
+            return EXIT_FAILURE;
+        }
+        memoryBudget.reset(new MemoryBudget(projectManager.outputPrefix, budget, Jobs));
+        projectManager.memoryBudget = memoryBudget.get();
+    }
+
 
     if (!Compilations && llvm::sys::fs::exists(BuildPath)) {
-        if (llvm::sys::fs::is_directory(BuildPath)) {
+        std::string JsonPath = BuildPath;
+        if (llvm::sys::fs::is_directory(BuildPath))
+            JsonPath += "/compile_commands.json";
+        if (!CompdbCache.empty() && llvm::sys::fs::exists(JsonPath)) {
+            Compilations = loadCompilationDatabaseCache(JsonPath, CompdbCache, ErrorMessage);
+        } else if (llvm::sys::fs::is_directory(BuildPath)) {
             Compilations = std::unique_ptr<clang::tooling::CompilationDatabase>(
                 clang::tooling::CompilationDatabase::loadFromDirectory(BuildPath, ErrorMessage));
         } else {
@@ -429,148 +779,382 @@ int main(int argc, const char **argv) {
 #endif
     }
 
-    if (Sources.empty()) {
+    if (Sources.empty() && !Serve) {
         std::cerr << "No source files.  Please pass source files as argument, or use '-a'" << std::endl;
         return EXIT_FAILURE;
     }
+
+    std::vector<std::string> ShardSources;
+    if (!Shard.empty()) {
+        llvm::StringRef ShardIndex, ShardCount;
+        std::tie(ShardIndex, ShardCount) = llvm::StringRef(Shard).split('/');
+        unsigned Index, Count;
+        if (ShardIndex.getAsInteger(10, Index) || ShardCount.getAsInteger(10, Count)
+                || Count == 0 || Index >= Count) {
+            std::cerr << "Invalid --shard option: " << Shard << " (expected i/N with 0 <= i < N)" << std::endl;
+            return EXIT_FAILURE;
+        }
+        for (const auto &it : Sources) {
+            if (fnv1a(it) % Count == Index)
+                ShardSources.push_back(it);
+        }
+        Sources = ShardSources;
+        std::cerr << "Shard " << Index << "/" << Count << ": " << Sources.size() << " sources" << std::endl;
+    }
     if (ProjectPaths.empty() && !IsProcessingAllDirectory) {
         std::cerr << "You must specify a project name and directory with '-p name:directory'" << std::endl;
         return EXIT_FAILURE;
     }
 
-    clang::FileManager FM({"."});
-    FM.Retain();
-    int Progress = 0;
+    std::unique_ptr<Manifest> manifest;
+    std::vector<Manifest::Record> outdated;
+    // The translation units of the current generation that could not be processed
+    std::atomic<unsigned> failedCommands(0);
+
+    auto processSources = [&](llvm::ArrayRef<std::string> Sources) {
+        std::atomic<int> Progress(0);
+
+        // Files that are not in the compilation database are processed after all
+        // the others, using the command of a similar file.
+        std::vector<char> Delayed(Sources.size(), false);
+
+        // The most expensive translation units first, so that they run in parallel with the
+        // others rather than at the end
+        std::vector<std::size_t> Order;
+        if (Jobs > 1) {
+            std::vector<std::string> MainFiles;
+            for (const auto &it : Sources) {
+                llvm::SmallString<256> filename;
+                canonicalize(clang::tooling::getAbsolutePath(it), filename);
+                MainFiles.push_back(filename.str());
+            }
+            Order = scheduler.order(MainFiles, [&](std::size_t index) {
+                auto commands = Compilations->getCompileCommands(MainFiles[index]);
+                if (commands.empty())
+                    return 0.; // delayed
+                return JobScheduler::heuristic(MainFiles[index], commands.front().CommandLine);
+            });
+        }
 
-    std::vector<std::string> NotInDB;
+        runJobs(Sources.size(), Jobs, [&](std::size_t index, clang::FileManager &FM) {
+            const std::string &it = Sources[index];
+            std::string file = clang::tooling::getAbsolutePath(it);
+            int CurrentProgress = ++Progress;
 
-    for (const auto &it : Sources) {
-        std::string file = clang::tooling::getAbsolutePath(it);
-        Progress++;
+            if (it.empty() || it == "-")
+                return;
 
-        if (it.empty() || it == "-")
-            continue;
+            llvm::SmallString<256> filename;
+            canonicalize(file, filename);
 
-        llvm::SmallString<256> filename;
-        canonicalize(file, filename);
+            if (auto project = projectManager.projectForFile(filename)) {
+                if (!projectManager.shouldProcess(filename, project)) {
+                    std::cerr << "Sources: Skipping already processed " << filename.c_str() << std::endl;
+                    return;
+                }
+            } else {
+                std::cerr << "Sources: Skipping file not included by any project " << filename.c_str() << std::endl;
+                return;
+            }
 
-        if (auto project = projectManager.projectForFile(filename)) {
-            if (!projectManager.shouldProcess(filename, project)) {
-                std::cerr << "Sources: Skipping already processed " << filename.c_str() << std::endl;
-                continue;
+            bool isHeader = llvm::StringSwitch<bool>(llvm::sys::path::extension(filename))
+                .Cases(".h", ".H", ".hh", ".hpp", true)
+                .Default(false);
+
+            auto compileCommandsForFile = Compilations->getCompileCommands(file);
+            if (!compileCommandsForFile.empty() && !isHeader) {
+                MemoryBudget::Reservation reservation(memoryBudget.get(), filename);
+                std::cerr << '[' << (100 * CurrentProgress / Sources.size()) << "%] Processing " << file << "\n";
+                const auto &command = compileCommandsForFile.front();
+                auto start = std::chrono::steady_clock::now();
+                // A translation unit that failed early would be scheduled last from then on
+                if (proceedCommand(command.CommandLine, command.Directory, file, &FM,
+                                   IsProcessingAllDirectory ? DatabaseType::ProcessFullDirectory : DatabaseType::InDatabase,
+                                   { file, Manifest::hashCommand(command.Directory, command.CommandLine) }))
+                    scheduler.record(filename, elapsedSince(start));
+                else
+                    ++failedCommands;
+            } else {
+                // TODO: Try to find a command line for a file in the same path
+                std::cerr << "Delayed " << file << "\n";
+                Progress--;
+                Delayed[index] = true;
+            }
+        }, Order);
+
+        std::vector<std::string> NotInDB;
+        for (std::size_t i = 0; i < Sources.size(); ++i) {
+            if (Delayed[i]) {
+                llvm::SmallString<256> filename;
+                canonicalize(clang::tooling::getAbsolutePath(Sources[i]), filename);
+                NotInDB.push_back(filename.str());
             }
-        } else {
-            std::cerr << "Sources: Skipping file not included by any project " << filename.c_str() << std::endl;
-            continue;
         }
 
-        bool isHeader = llvm::StringSwitch<bool>(llvm::sys::path::extension(filename))
-            .Cases(".h", ".H", ".hh", ".hpp", true)
-            .Default(false);
-
-        auto compileCommandsForFile = Compilations->getCompileCommands(file);
-        if (!compileCommandsForFile.empty() && !isHeader) {
-            std::cerr << '[' << (100 * Progress / Sources.size()) << "%] Processing " << file << "\n";
-            proceedCommand(compileCommandsForFile.front().CommandLine,
-                           compileCommandsForFile.front().Directory, file, &FM,
-                           IsProcessingAllDirectory ? DatabaseType::ProcessFullDirectory : DatabaseType::InDatabase);
-        } else {
-            // TODO: Try to find a command line for a file in the same path
-            std::cerr << "Delayed " << file << "\n";
-            Progress--;
-            NotInDB.push_back(filename.str());
-            continue;
+        std::vector<std::size_t> NotInDBOrder;
+        if (Jobs > 1) {
+            NotInDBOrder = scheduler.order(NotInDB, [&](std::size_t index) {
+                return JobScheduler::heuristic(NotInDB[index], {});
+            });
         }
 
-    }
-
-    for (const auto &it : NotInDB) {
-        std::string file = clang::tooling::getAbsolutePath(it);
-        Progress++;
-
-        if (auto project = projectManager.projectForFile(file)) {
-            if (!projectManager.shouldProcess(file, project)) {
-                std::cerr << "NotInDB: Skipping already processed " << file.c_str() << std::endl;
-                continue;
+        runJobs(NotInDB.size(), Jobs, [&](std::size_t index, clang::FileManager &FM) {
+            const std::string &it = NotInDB[index];
+            std::string file = clang::tooling::getAbsolutePath(it);
+            int CurrentProgress = ++Progress;
+
+            if (auto project = projectManager.projectForFile(file)) {
+                if (!projectManager.shouldProcess(file, project)) {
+                    std::cerr << "NotInDB: Skipping already processed " << file.c_str() << std::endl;
+                    return;
+                }
+            } else {
+                std::cerr << "NotInDB: Skipping file not included by any project " << file.c_str() << std::endl;
+                return;
             }
-        } else {
-            std::cerr << "NotInDB: Skipping file not included by any project " << file.c_str() << std::endl;
-            continue;
-        }
 
-        llvm::StringRef similar;
-
-        auto compileCommandsForFile = Compilations->getCompileCommands(file);
-        std::string fileForCommands = file;
-        if (compileCommandsForFile.empty()) {
-            // Find the element with the bigger prefix
-            auto lower = std::lower_bound(AllFiles.cbegin(), AllFiles.cend(), file);
-            if (lower == AllFiles.cend())
-                lower = AllFiles.cbegin();
-            compileCommandsForFile = Compilations->getCompileCommands(*lower);
-            fileForCommands = *lower;
-        }
-
-        bool success = false;
-        if (!compileCommandsForFile.empty()) {
-            std::cerr << '[' << (100 * Progress / Sources.size()) << "%] Processing " << file << "\n";
-            auto command = compileCommandsForFile.front().CommandLine;
-            std::replace(command.begin(), command.end(), fileForCommands, it);
-            if (llvm::StringRef(file).endswith(".qdoc")) {
-                command.insert(command.begin() + 1, "-xc++");
-                // include the header for this .qdoc file
-                command.push_back("-include");
-                command.push_back(llvm::StringRef(file).substr(0, file.size() - 5) % ".h");
+            llvm::StringRef similar;
+
+            auto compileCommandsForFile = Compilations->getCompileCommands(file);
+            std::string fileForCommands = file;
+            if (compileCommandsForFile.empty()) {
+                // Find the element with the bigger prefix
+                auto lower = std::lower_bound(AllFiles.cbegin(), AllFiles.cend(), file);
+                if (lower == AllFiles.cend())
+                    lower = AllFiles.cbegin();
+                compileCommandsForFile = Compilations->getCompileCommands(*lower);
+                fileForCommands = *lower;
             }
-            success = proceedCommand(std::move(command), compileCommandsForFile.front().Directory,
-                                     file, &FM,
-                                     IsProcessingAllDirectory ? DatabaseType::ProcessFullDirectory : DatabaseType::NotInDatabase);
-        } else {
-            std::cerr << "Could not find commands for " << file << "\n";
-        }
-
-        if (!success && !IsProcessingAllDirectory) {
-            ProjectInfo *projectinfo = projectManager.projectForFile(file);
-            if (!projectinfo)
-                continue;
-            if (!projectManager.shouldProcess(file, projectinfo))
-                continue;
 
-            auto now = std::time(0);
-            auto tm = localtime(&now);
-            char buf[80];
-            std::strftime(buf, sizeof(buf), "%Y-%b-%d", tm);
+            bool success = false;
+            if (!compileCommandsForFile.empty()) {
+                std::cerr << '[' << (100 * CurrentProgress / Sources.size()) << "%] Processing " << file << "\n";
+                auto command = compileCommandsForFile.front().CommandLine;
+                std::replace(command.begin(), command.end(), fileForCommands, it);
+                if (llvm::StringRef(file).endswith(".qdoc")) {
+                    command.insert(command.begin() + 1, "-xc++");
+                    // include the header for this .qdoc file
+                    command.push_back("-include");
+                    command.push_back(llvm::StringRef(file).substr(0, file.size() - 5) % ".h");
+                }
+                const auto &original = compileCommandsForFile.front();
+                CommandInfo commandInfo { fileForCommands, Manifest::hashCommand(original.Directory, original.CommandLine) };
+                MemoryBudget::Reservation reservation(memoryBudget.get(), file);
+                auto start = std::chrono::steady_clock::now();
+                success = proceedCommand(std::move(command), original.Directory,
+                                         file, &FM,
+                                         IsProcessingAllDirectory ? DatabaseType::ProcessFullDirectory : DatabaseType::NotInDatabase,
+                                         std::move(commandInfo));
+                if (success)
+                    scheduler.record(file, elapsedSince(start));
+                else
+                    ++failedCommands;
+            } else {
+                std::cerr << "Could not find commands for " << file << "\n";
+            }
 
-            std::string footer = "Generated on <em>" % std::string(buf) % "</em>"
-                                % " from project " % projectinfo->name % "</a>";
-            if (!projectinfo->revision.empty())
-                footer %= " revision <em>" % projectinfo->revision % "</em>";
+            if (!success && !IsProcessingAllDirectory) {
+                ProjectInfo *projectinfo = projectManager.projectForFile(file);
+                if (!projectinfo)
+                    return;
+                // Claim the file so no other thread generates it meanwhile
+                const void *owner = &file;
+                if (!projectManager.shouldProcess(file, projectinfo, owner))
+                    return;
+                struct ClaimReleaser {
+                    ProjectManager &pm;
+                    const void *owner;
+                    ~ClaimReleaser() { pm.releaseClaims(owner); }
+                } releaser { projectManager, owner };
+
+                char buf[80];
+                {
+                    std::lock_guard<std::mutex> lock(projectManager.outputMutex);
+                    auto now = std::time(0);
+                    auto tm = localtime(&now);
+                    std::strftime(buf, sizeof(buf), "%Y-%b-%d", tm);
+                }
+
+                std::string footer = "Generated on <em>" % std::string(buf) % "</em>"
+                                    % " from project " % projectinfo->name % "</a>";
+                if (!projectinfo->revision.empty())
+                    footer %= " revision <em>" % projectinfo->revision % "</em>";
 
 #if CLANG_VERSION_MAJOR == 3 && CLANG_VERSION_MINOR <= 4
-            llvm::OwningPtr<llvm::MemoryBuffer> Buf;
-            if (!llvm::MemoryBuffer::getFile(file, Buf))
-                continue;
+                llvm::OwningPtr<llvm::MemoryBuffer> Buf;
+                if (!llvm::MemoryBuffer::getFile(file, Buf))
+                    return;
 #else
-            auto B = llvm::MemoryBuffer::getFile(file);
-            if (!B)
-                continue;
-            std::unique_ptr<llvm::MemoryBuffer> Buf = std::move(B.get());
+                auto B = llvm::MemoryBuffer::getFile(file);
+                if (!B)
+                    return;
+                std::unique_ptr<llvm::MemoryBuffer> Buf = std::move(B.get());
 #endif
 
-            std::string fn = projectinfo->name % "/" % llvm::StringRef(file).substr(projectinfo->source_path.size());
+                std::string fn = projectinfo->name % "/" % llvm::StringRef(file).substr(projectinfo->source_path.size());
+
+                Stats::TranslationUnit statsUnit(file);
+                Generator g;
+                g.chunkLines = projectManager.chunkLines;
+                g.generate(projectManager.outputPrefix, projectManager.dataPath, fn,
+                           Buf->getBufferStart(), Buf->getBufferEnd(), footer,
+                           "Warning: This file is not a C or C++ file. It does not have highlighting.",
+                           std::set<std::string>(), projectManager.overlayPath);
+                ++projectManager.generatedPages;
+
+                if (projectManager.manifest) {
+                    Manifest::Record record;
+                    record.mainFile = file;
+                    record.generated.push_back({fn, file});
+                    record.otherIndex.push_back(fn);
+                    Manifest::Input input;
+                    if (Manifest::makeInput(file, Buf->getBuffer(), input))
+                        record.inputs.push_back(std::move(input));
+                    projectManager.manifest->add(std::move(record));
+                }
+
+                std::lock_guard<std::mutex> lock(projectManager.outputMutex);
+                std::ofstream fileIndex;
+                fileIndex.open(projectManager.outputPrefix + "/otherIndex", std::ios::app);
+                if (!fileIndex)
+                    return;
+                fileIndex << fn << '\n';
+            }
+        }, NotInDBOrder);
+    };
+
+    // Generates the sources, and updates the index files. With --serve, this is
+    // done for each batch of sources read from the input.
+    bool indexesWritten = false;
+    auto generate = [&](llvm::ArrayRef<std::string> Sources) -> bool {
+        BrowserAction::forgetAll();
+        failedCommands = 0;
+        const unsigned pagesBefore = projectManager.generatedPages;
+        // Set if the lines of the outdated translation units were removed from the index files
+        bool invalidated = false;
+
+        // The refs of a run that was interrupted are still in the spill files
+        projectManager.refsDatabase.consolidate(Jobs);
+        for (const auto &file : appendedIndexFiles(projectManager.outputPrefix))
+            OutputFile::prepareAppend(file);
+
+        std::vector<std::string> ServeSources;
+        if (Incremental || Serve) {
+            // Loaded again each time, as the previous generation added records
+            manifest.reset(new Manifest(projectManager.outputPrefix));
+            manifest->load();
+            outdated = manifest->invalidateOutdated([&](llvm::StringRef commandFile) -> std::string {
+                auto commands = Compilations->getCompileCommands(commandFile);
+                if (commands.empty())
+                    return std::string();
+                return Manifest::hashCommand(commands.front().Directory, commands.front().CommandLine);
+            });
+            std::cerr << "Incremental: " << outdated.size() << " outdated translation units" << std::endl;
+            invalidated = !outdated.empty();
+            touchRefs(outdated);
+            projectManager.manifest = manifest.get();
+            if (Serve) {
+                // Their pages were removed, so they must be generated again even if they were not
+                // asked for
+                ServeSources = Sources;
+                for (const auto &record : outdated)
+                    ServeSources.push_back(record.mainFile);
+                Sources = ServeSources;
+            }
+        }
 
-            Generator g;
-            g.generate(projectManager.outputPrefix, projectManager.dataPath, fn,
-                       Buf->getBufferStart(), Buf->getBufferEnd(), footer,
-                       "Warning: This file is not a C or C++ file. It does not have highlighting.",
-                       std::set<std::string>());
+        processSources(Sources);
+
+        if (manifest) {
+            // The pages of the outdated translation units were removed. If some of them were not
+            // generated again (because the translation unit that used to generate them does not
+            // include them anymore), process again the translation units that read them.
+            std::vector<std::string> missing;
+            auto findMissing = [&](const std::vector<Manifest::Record> &records) {
+                missing.clear();
+                for (const auto &record : records) {
+                    for (const auto &generated : record.generated) {
+                        std::string page = projectManager.outputPrefix % "/" % generated.first % ".html";
+                        if (llvm::sys::fs::exists(generated.second) && !OutputFile::fileExists(page))
+                            missing.push_back(generated.second);
+                    }
+                }
+            };
+            findMissing(outdated);
+            while (!missing.empty()) {
+                // invalidateReaders edits the refs/ files
+                projectManager.refsDatabase.consolidate(Jobs);
+                auto readers = manifest->invalidateReaders(missing);
+                if (readers.empty())
+                    break;
+                invalidated = true;
+                touchRefs(readers);
+                std::vector<std::string> mainFiles;
+                for (const auto &record : readers)
+                    mainFiles.push_back(record.mainFile);
+                processSources(mainFiles);
+                findMissing(readers);
+            }
+        }
 
-            std::ofstream fileIndex;
-            fileIndex.open(projectManager.outputPrefix + "/otherIndex", std::ios::app);
-            if (!fileIndex)
+        {
+            Stats::Timer timer(Stats::Consolidate);
+            projectManager.refsDatabase.consolidate(Jobs);
+            if (refsBundles)
+                refsBundles->write(Jobs);
+        }
+        for (const auto &file : appendedIndexFiles(projectManager.outputPrefix))
+            OutputFile::finishAppend(file);
+
+        // The indexes are built again from all of fnSearch/ and fileIndex, which did not change
+        // if no page was generated or removed (as with the batches of --serve that are up to date)
+        bool indexed = true;
+        if (!indexesWritten || invalidated || projectManager.generatedPages != pagesBefore) {
+            Stats::Timer timer(Stats::Indexes);
+            indexed = writeSearchIndex(projectManager.outputPrefix)
+                && writeFileIndex(projectManager.outputPrefix);
+            indexesWritten = indexed;
+        }
+        if (memoryBudget)
+            memoryBudget->save();
+        scheduler.save();
+        return indexed;
+    };
+
+    if (Serve) {
+        // The FileManagers are not kept from one generation to the next: their stat cache would
+        // be outdated for the files that changed meanwhile.
+        std::vector<std::string> Batch(Sources.begin(), Sources.end());
+        auto generateBatch = [&](llvm::ArrayRef<std::string> Sources) {
+            bool ok = generate(Sources);
+            if (failedCommands) {
+                std::cerr << "Serve: " << failedCommands << " translation units could not be processed" << std::endl;
+                ok = false;
+            }
+            std::cout << (ok ? "done" : "failed") << std::endl;
+            return ok;
+        };
+        bool failed = false;
+        for (std::string line; std::getline(std::cin, line);) {
+            if (!line.empty()) {
+                Batch.push_back(std::move(line));
                 continue;
-            fileIndex << fn << '\n';
+            }
+            bool ok = generateBatch(Batch);
+            failed = failed || !ok;
+            Batch.clear();
         }
+        if (!Batch.empty()) {
+            bool ok = generateBatch(Batch);
+            failed = failed || !ok;
+        }
+        Stats::finish(StatsTop);
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
     }
+
+    bool indexed = generate(Sources);
+    Stats::finish(StatsTop);
+    if (!indexed)
+        return EXIT_FAILURE;
 }
 
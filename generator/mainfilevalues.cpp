@@ -0,0 +1,81 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#include "mainfilevalues.h"
+#include "filesystem.h"
+#include "stringbuilder.h"
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+MainFileValues::MainFileValues(std::string _filename)
+    : filename(std::move(_filename)) {
+  auto B = llvm::MemoryBuffer::getFile(filename);
+  if (!B)
+    return;
+  llvm::SmallVector<llvm::StringRef, 256> lines;
+  B.get()->getBuffer().split(lines, '\n', -1, false);
+  for (auto line : lines) {
+    llvm::StringRef number, file;
+    std::tie(number, file) = line.split('\t');
+    uint64_t value;
+    if (!file.empty() && !number.getAsInteger(10, value))
+      values[file] = value;
+  }
+}
+
+bool MainFileValues::lookup(llvm::StringRef file, uint64_t &value) const {
+  auto it = values.find(file);
+  if (it == values.end())
+    return false;
+  value = it->second;
+  return true;
+}
+
+void MainFileValues::set(llvm::StringRef file, uint64_t value) {
+  auto inserted = values.insert({file, value});
+  if (inserted.second || inserted.first->second != value) {
+    inserted.first->second = value;
+    changed = true;
+  }
+}
+
+void MainFileValues::save() {
+  if (!changed)
+    return;
+  std::vector<std::pair<llvm::StringRef, uint64_t>> sorted;
+  for (const auto &it : values)
+    sorted.push_back({it.getKey(), it.getValue()});
+  std::sort(sorted.begin(), sorted.end());
+  std::string content;
+  for (const auto &it : sorted)
+    content %= llvm::Twine(it.second).str() % "\t" % it.first % "\n";
+  if (auto error_code = write_file_atomically(filename, content)) {
+    std::cerr << "Error writing " << filename << ": " << error_code.message()
+              << std::endl;
+    return;
+  }
+  changed = false;
+}
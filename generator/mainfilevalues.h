@@ -0,0 +1,50 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#pragma once
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <cstdint>
+#include <string>
+
+/**
+ * A number per main file, measured in a run and kept for the next ones in a
+ * file of the output directory, with one line per main file:
+ * "<value>\t<main file>". (Used for .jobCosts and .memoryEstimates)
+ *
+ * It is not thread safe: the users lock it.
+ */
+class MainFileValues {
+public:
+  // Reads the file, if it exists
+  explicit MainFileValues(std::string filename);
+
+  // Returns false if there is no value for the file
+  bool lookup(llvm::StringRef file, uint64_t &value) const;
+  void set(llvm::StringRef file, uint64_t value);
+  // Writes the file if a value changed
+  void save();
+
+private:
+  std::string filename;
+  llvm::StringMap<uint64_t> values;
+  bool changed = false;
+};
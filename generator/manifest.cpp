@@ -0,0 +1,344 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#include "manifest.h"
+#include "filesystem.h"
+#include "generator.h"
+#include "merger.h"
+#include "outputfile.h"
+#include "stringbuilder.h"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <iostream>
+
+namespace {
+
+/**
+ * Rewrites the file removing the entries for which 'remove' returns true.
+ * The file is removed if there is no entry left.
+ */
+template <typename Filter>
+void filterFile(const std::string &path, bool isRefFile, unsigned formats,
+                Filter remove) {
+  std::string original;
+  if (OutputFile::readFile(path, original))
+    return;
+  llvm::SmallVector<llvm::StringRef, 64> entries;
+  if (isRefFile)
+    splitRefEntries(original, entries);
+  else
+    llvm::StringRef(original).split(entries, '\n', -1, false);
+
+  std::string content;
+  for (auto entry : entries) {
+    if (!remove(entry))
+      content %= entry % "\n";
+  }
+  if (content.empty()) {
+    OutputFile::removeFile(path);
+    return;
+  }
+  if (auto error_code = OutputFile::writeFile(path, content, formats)) {
+    std::cerr << "Error writing " << path << ": " << error_code.message()
+              << std::endl;
+  }
+}
+
+// Removes one of the occurrences in 'count', returns false if there is none
+bool takeOne(llvm::StringMap<unsigned> &count, llvm::StringRef entry) {
+  auto it = count.find(entry);
+  if (it == count.end() || it->second == 0)
+    return false;
+  it->second--;
+  return true;
+}
+
+// Returns the value of the f='...' attribute of a refs/ entry
+llvm::StringRef fileAttribute(llvm::StringRef entry) {
+  auto pos = entry.substr(0, entry.find('>')).find(" f='");
+  if (pos == llvm::StringRef::npos)
+    return {};
+  entry = entry.substr(pos + 4);
+  return entry.substr(0, entry.find('\''));
+}
+
+void writeRecord(llvm::raw_ostream &os, const Manifest::Record &r) {
+  os << "tu\t" << r.mainFile << '\t' << r.commandFile << '\t' << r.commandHash
+     << '\n';
+  for (const auto &g : r.generated)
+    os << "gen\t" << g.first << '\t' << g.second << '\n';
+  for (const auto &f : r.fileIndex)
+    os << "idx\t" << f << '\n';
+  for (const auto &f : r.otherIndex)
+    os << "other\t" << f << '\n';
+  for (const auto &in : r.inputs)
+    os << "in\t" << in.size << '\t' << in.mtime << '\t' << in.md5 << '\t'
+       << in.path << '\n';
+  for (const auto &ref : r.refs)
+    os << "ref\t" << ref << '\n';
+  for (const auto &e : r.refEntries)
+    os << "entry\t" << e.first << '\t' << e.second << '\n';
+  for (const auto &fn : r.fnSearch)
+    os << "fn\t" << fn.first << '\t' << fn.second << '\n';
+}
+
+} // namespace
+
+Manifest::Manifest(std::string outputPrefix)
+    : outputPrefix(std::move(outputPrefix)) {
+  manifestFile = this->outputPrefix % "/.manifest";
+}
+
+bool Manifest::load() {
+  auto B = llvm::MemoryBuffer::getFile(manifestFile);
+  if (!B)
+    return false;
+
+  llvm::SmallVector<llvm::StringRef, 32> lines;
+  B.get()->getBuffer().split(lines, '\n', -1, false);
+  Record *current = nullptr;
+  for (auto line : lines) {
+    llvm::SmallVector<llvm::StringRef, 5> f;
+    llvm::StringRef kind = line.substr(0, line.find('\t'));
+    if (kind == "tu") {
+      line.split(f, '\t', 3);
+      if (f.size() != 4)
+        continue;
+      records.emplace_back();
+      current = &records.back();
+      current->mainFile = f[1].str();
+      current->commandFile = f[2].str();
+      current->commandHash = f[3].str();
+      continue;
+    }
+    if (!current)
+      continue;
+    if (kind == "gen") {
+      line.split(f, '\t', 2);
+      if (f.size() == 3)
+        current->generated.emplace_back(f[1], f[2]);
+    } else if (kind == "idx") {
+      current->fileIndex.push_back(line.substr(4).str());
+    } else if (kind == "other") {
+      current->otherIndex.push_back(line.substr(6).str());
+    } else if (kind == "in") {
+      line.split(f, '\t', 4);
+      Input in;
+      if (f.size() != 5 || f[1].getAsInteger(10, in.size) ||
+          f[2].getAsInteger(10, in.mtime))
+        continue;
+      in.md5 = f[3].str();
+      in.path = f[4].str();
+      current->inputs.push_back(std::move(in));
+    } else if (kind == "ref") {
+      current->refs.push_back(line.substr(4).str());
+    } else if (kind == "entry") {
+      line.split(f, '\t', 2);
+      if (f.size() == 3)
+        current->refEntries.emplace_back(f[1], f[2]);
+    } else if (kind == "fn") {
+      line.split(f, '\t', 2);
+      if (f.size() == 3)
+        current->fnSearch.emplace_back(f[1], f[2]);
+    }
+  }
+  return true;
+}
+
+bool Manifest::save() {
+  std::string content;
+  llvm::raw_string_ostream os(content);
+  for (const auto &r : records)
+    writeRecord(os, r);
+  for (const auto &r : newRecords)
+    writeRecord(os, r);
+  os.flush();
+  create_directories(outputPrefix);
+  if (auto error_code = write_file_atomically(manifestFile, content)) {
+    std::cerr << "Error writing " << manifestFile << ": "
+              << error_code.message() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void Manifest::add(Record record) {
+  std::lock_guard<std::mutex> lock(mutex);
+  // Append right away, so the record is not lost if the generator is killed
+  std::error_code error_code;
+  llvm::raw_fd_ostream os(manifestFile, error_code, llvm::sys::fs::F_Append);
+  if (error_code) {
+    std::cerr << "Error writing " << manifestFile << ": "
+              << error_code.message() << std::endl;
+  } else {
+    writeRecord(os, record);
+  }
+  newRecords.push_back(std::move(record));
+}
+
+std::vector<Manifest::Record> Manifest::invalidateOutdated(
+    llvm::function_ref<std::string(llvm::StringRef)> currentCommandHash) {
+  struct FileState {
+    bool exists = false;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    std::string md5; // computed lazily
+  };
+  llvm::StringMap<FileState> states;
+  auto isUpToDate = [&](const Input &in) -> bool {
+    auto it = states.find(in.path);
+    if (it == states.end()) {
+      FileState state;
+      llvm::sys::fs::file_status status;
+      if (!llvm::sys::fs::status(in.path, status)) {
+        state.exists = true;
+        state.size = status.getSize();
+        state.mtime = status.getLastModificationTime().time_since_epoch().count();
+      }
+      it = states.insert({in.path, std::move(state)}).first;
+    }
+    FileState &state = it->second;
+    if (!state.exists)
+      return false;
+    if (state.size == in.size && state.mtime == in.mtime)
+      return true;
+    if (state.md5.empty()) {
+      // The file was touched, check if the content really changed
+      auto B = llvm::MemoryBuffer::getFile(in.path);
+      if (!B)
+        return false;
+      state.md5 = md5Hex(B.get()->getBuffer());
+    }
+    return state.md5 == in.md5;
+  };
+
+  std::vector<Record> upToDate;
+  std::vector<Record> outdated;
+  for (auto &r : records) {
+    bool ok = llvm::sys::fs::exists(r.mainFile) &&
+              (r.commandFile.empty() ||
+               currentCommandHash(r.commandFile) == r.commandHash) &&
+              std::all_of(r.inputs.begin(), r.inputs.end(), isUpToDate);
+    (ok ? upToDate : outdated).push_back(std::move(r));
+  }
+  records = std::move(upToDate);
+  invalidate(outdated);
+  return outdated;
+}
+
+std::vector<Manifest::Record>
+Manifest::invalidateReaders(llvm::ArrayRef<std::string> sourceFiles) {
+  llvm::StringSet<> files;
+  for (const auto &f : sourceFiles)
+    files.insert(f);
+
+  std::vector<Record> kept;
+  std::vector<Record> readers;
+  for (auto &r : records) {
+    bool reads = std::any_of(r.inputs.begin(), r.inputs.end(),
+                             [&](const Input &in) { return files.count(in.path); });
+    (reads ? readers : kept).push_back(std::move(r));
+  }
+  records = std::move(kept);
+  invalidate(readers);
+  return readers;
+}
+
+void Manifest::invalidate(const std::vector<Record> &outdated) {
+  if (outdated.empty())
+    return;
+
+  llvm::StringSet<> generated; // escaped, as in the f='' attributes
+  llvm::StringSet<> refs;
+  llvm::StringMap<llvm::StringMap<unsigned>> refEntries;
+  llvm::StringMap<llvm::StringMap<unsigned>> fnSearch;
+  llvm::StringMap<unsigned> fileIndex;
+  llvm::StringMap<unsigned> otherIndex;
+  for (const auto &r : outdated) {
+    for (const auto &g : r.generated) {
+      llvm::SmallString<256> buffer;
+      generated.insert(Generator::escapeAttr(g.first, buffer));
+      Generator::removePage(std::string(outputPrefix % "/" % g.first));
+    }
+    for (const auto &ref : r.refs)
+      refs.insert(ref);
+    for (const auto &e : r.refEntries)
+      refEntries[e.first][e.second]++;
+    for (const auto &fn : r.fnSearch)
+      fnSearch[fn.first][fn.second]++;
+    for (const auto &f : r.fileIndex)
+      fileIndex[f]++;
+    for (const auto &f : r.otherIndex)
+      otherIndex[f]++;
+  }
+
+  for (const auto &ref : refs) {
+    std::string refFilename = ref.getKey().str();
+    replace_invalid_filename_chars(refFilename);
+    auto &entries = refEntries[ref.getKey()];
+    filterFile(outputPrefix % "/refs/" % refFilename, true,
+               OutputFile::defaultFormats,
+               [&](llvm::StringRef entry) -> bool {
+                 llvm::StringRef f = fileAttribute(entry);
+                 if (!f.empty())
+                   return generated.count(f) != 0;
+                 return takeOne(entries, entry);
+               });
+  }
+  for (auto &fn : fnSearch) {
+    // The index files are uncompressed during the run (see
+    // OutputFile::prepareAppend)
+    filterFile(outputPrefix % "/fnSearch/" % fn.getKey(), false,
+               OutputFile::Plain,
+               [&](llvm::StringRef line) { return takeOne(fn.second, line); });
+  }
+  filterFile(outputPrefix % "/fileIndex", false, OutputFile::Plain,
+             [&](llvm::StringRef line) { return takeOne(fileIndex, line); });
+  filterFile(outputPrefix % "/otherIndex", false, OutputFile::Plain,
+             [&](llvm::StringRef line) { return takeOne(otherIndex, line); });
+
+  save();
+}
+
+bool Manifest::makeInput(llvm::StringRef path, llvm::StringRef content,
+                         Input &input) {
+  llvm::sys::fs::file_status status;
+  if (llvm::sys::fs::status(path, status))
+    return false;
+  input.path = path.str();
+  input.size = status.getSize();
+  input.mtime = status.getLastModificationTime().time_since_epoch().count();
+  input.md5 = md5Hex(content);
+  return true;
+}
+
+std::string Manifest::hashCommand(llvm::StringRef directory,
+                                  llvm::ArrayRef<std::string> commandLine) {
+  std::string str = directory.str();
+  for (const auto &arg : commandLine)
+    str %= llvm::StringRef("\0", 1) % arg;
+  return md5Hex(str);
+}
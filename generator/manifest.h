@@ -0,0 +1,114 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#pragma once
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringRef.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * The manifest used for the incremental generation (--incremental)
+ *
+ * It is stored in <output>/.manifest and records, for each translation unit
+ * that was processed, the hash of its compile command and of all the files it
+ * read, the pages it generated and what it added to the shared index files
+ * (refs/, fnSearch/, fileIndex and otherIndex).
+ *
+ * Before a new run, the records of the translation units whose inputs changed
+ * are invalidated: their pages are removed (so ProjectManager::shouldProcess
+ * will let them be generated again) and their contributions are removed from
+ * the index files.
+ */
+class Manifest {
+public:
+  struct Input {
+    std::string path;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    std::string md5;
+  };
+
+  struct Record {
+    std::string mainFile;
+    // The file for which the compile command was taken from the database
+    // (not the same as the mainFile for the files not in the database)
+    std::string commandFile;
+    std::string commandHash;
+    // The generated pages, as {html name (project/path), source file}
+    std::vector<std::pair<std::string, std::string>> generated;
+    std::vector<std::string> fileIndex;
+    std::vector<std::string> otherIndex;
+    std::vector<Input> inputs;
+    // The refs/ files that were written to
+    std::vector<std::string> refs;
+    // Entries written to refs/ that do not have a 'f' attribute: {ref, entry}
+    std::vector<std::pair<std::string, std::string>> refEntries;
+    // Lines written to fnSearch/: {file name, line}
+    std::vector<std::pair<std::string, std::string>> fnSearch;
+  };
+
+  explicit Manifest(std::string outputPrefix);
+
+  // Load the records from the manifest of a previous run
+  bool load();
+
+  /**
+   * Invalidates the records that are out of date and returns them.
+   * 'currentCommandHash' returns the hash of the current compile command of
+   * 'commandFile', or an empty string if there is none.
+   */
+  std::vector<Record> invalidateOutdated(
+      llvm::function_ref<std::string(llvm::StringRef commandFile)>
+          currentCommandHash);
+
+  /**
+   * Invalidates the records of the (not yet invalidated) translation units
+   * that read one of the 'sourceFiles' and returns them.
+   * This is used to find a translation unit able to regenerate a file whose
+   * page was removed, but which is not generated anymore by the translation
+   * unit which used to generate it.
+   */
+  std::vector<Record> invalidateReaders(llvm::ArrayRef<std::string> sourceFiles);
+
+  // Adds the record of a translation unit that was just processed
+  void add(Record record);
+
+  // Fills an Input from the file on the disk, and its content
+  static bool makeInput(llvm::StringRef path, llvm::StringRef content,
+                        Input &input);
+  static std::string hashCommand(llvm::StringRef directory,
+                                 llvm::ArrayRef<std::string> commandLine);
+
+private:
+  std::string outputPrefix;
+  std::string manifestFile;
+  std::vector<Record> records;    // loaded from the previous runs
+  std::vector<Record> newRecords; // from this run
+  std::mutex mutex;
+
+  void invalidate(const std::vector<Record> &outdated);
+  bool save();
+};
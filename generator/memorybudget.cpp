@@ -0,0 +1,95 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#include "memorybudget.h"
+#include "stringbuilder.h"
+
+#include <algorithm>
+
+MemoryBudget::MemoryBudget(const std::string &outputPrefix, uint64_t budget,
+                           unsigned jobCount)
+    : budget(budget), defaultEstimate(budget / std::max(jobCount, 1u)),
+      estimates(outputPrefix % "/.memoryEstimates") {}
+
+bool MemoryBudget::parseSize(llvm::StringRef str, uint64_t &bytes) {
+  uint64_t unit = 1;
+  switch (str.empty() ? '\0' : str.back()) {
+  case 'k':
+  case 'K':
+    unit = uint64_t(1) << 10;
+    break;
+  case 'm':
+  case 'M':
+    unit = uint64_t(1) << 20;
+    break;
+  case 'g':
+  case 'G':
+    unit = uint64_t(1) << 30;
+    break;
+  }
+  if (unit != 1)
+    str = str.drop_back();
+  if (str.getAsInteger(10, bytes) || bytes == 0)
+    return false;
+  bytes *= unit;
+  return true;
+}
+
+uint64_t MemoryBudget::estimate(llvm::StringRef file) {
+  std::lock_guard<std::mutex> lock(mutex);
+  uint64_t bytes;
+  return estimates.lookup(file, bytes) ? bytes : defaultEstimate;
+}
+
+void MemoryBudget::record(llvm::StringRef file, uint64_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex);
+  estimates.set(file, bytes);
+}
+
+void MemoryBudget::save() {
+  std::lock_guard<std::mutex> lock(mutex);
+  estimates.save();
+}
+
+MemoryBudget::Reservation::Reservation(MemoryBudget *budget,
+                                       llvm::StringRef file)
+    : budget(budget) {
+  if (!budget)
+    return;
+  bytes = budget->estimate(file);
+  std::unique_lock<std::mutex> lock(budget->mutex);
+  budget->released.wait(lock, [&] {
+    return budget->running == 0 ||
+           budget->reserved + bytes <= budget->budget;
+  });
+  budget->reserved += bytes;
+  budget->running++;
+}
+
+MemoryBudget::Reservation::~Reservation() {
+  if (!budget)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(budget->mutex);
+    budget->reserved -= bytes;
+    budget->running--;
+  }
+  budget->released.notify_all();
+}
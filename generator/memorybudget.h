@@ -0,0 +1,82 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#pragma once
+
+#include "mainfilevalues.h"
+#include <llvm/ADT/StringRef.h>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+ * The memory budget of the translation units processed in parallel, used with
+ * --max-memory
+ *
+ * The estimated memory of a translation unit is reserved while it is
+ * processed, and the other jobs wait while their reservation would exceed the
+ * budget. One translation unit can always run, even if its estimate alone is
+ * bigger than the budget.
+ *
+ * The estimates are the memory that the translation units used in the previous
+ * runs (see record()), kept in <output>/.memoryEstimates. A translation unit
+ * without estimate is assumed to use an equal share of the budget between the
+ * jobs, which does not throttle more than -j.
+ */
+class MemoryBudget {
+public:
+  MemoryBudget(const std::string &outputPrefix, uint64_t budget,
+               unsigned jobCount);
+
+  // Parses a size such as "16G", "512M", "100k" or a number of bytes
+  static bool parseSize(llvm::StringRef str, uint64_t &bytes);
+
+  uint64_t estimate(llvm::StringRef file);
+  // Records the memory used by the translation unit of the (canonicalized)
+  // main file, for the next runs
+  void record(llvm::StringRef file, uint64_t bytes);
+  // Writes the estimates if they changed
+  void save();
+
+  // Reserves the estimate of the file while it lives. Does nothing if budget
+  // is null.
+  class Reservation {
+  public:
+    Reservation(MemoryBudget *budget, llvm::StringRef file);
+    ~Reservation();
+    Reservation(const Reservation &) = delete;
+    Reservation &operator=(const Reservation &) = delete;
+
+  private:
+    MemoryBudget *budget;
+    uint64_t bytes = 0;
+  };
+
+private:
+  uint64_t budget;
+  uint64_t defaultEstimate;
+
+  std::mutex mutex;
+  std::condition_variable released;
+  uint64_t reserved = 0;
+  unsigned running = 0;
+  MainFileValues estimates;
+};
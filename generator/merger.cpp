@@ -0,0 +1,232 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#include "merger.h"
+#include "outputfile.h"
+#include "refsbundles.h"
+#include "searchindex.h"
+#include "filesystem.h"
+#include "stringbuilder.h"
+
+#include <clang/Basic/Version.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <iostream>
+
+void splitRefEntries(llvm::StringRef content,
+                     llvm::SmallVectorImpl<llvm::StringRef> &entries) {
+  std::size_t begin = 0;
+  std::size_t pos = 0;
+  while ((pos = content.find('\n', pos)) != llvm::StringRef::npos) {
+    ++pos;
+    // The content of the <doc> is escaped, so a continuation line never
+    // starts with a '<'
+    if (pos == content.size() || content[pos] == '<') {
+      if (pos - 1 > begin)
+        entries.push_back(content.slice(begin, pos - 1));
+      begin = pos;
+    }
+  }
+  if (begin < content.size())
+    entries.push_back(content.substr(begin));
+}
+
+namespace {
+
+enum class MergeKind {
+  Copy,       // The first file wins
+  RefEntries, // Entries from refs/
+  Lines,      // One entry per line
+  Skip        // Written again after the merge
+};
+
+MergeKind mergeKindFor(llvm::StringRef relativePath) {
+  if (relativePath.startswith("fnIndex/") ||
+      relativePath.startswith("fileTree/"))
+    return MergeKind::Skip;
+  if (relativePath.startswith("refs/"))
+    return MergeKind::RefEntries;
+  // The refs bundles of the pages (see RefsBundles)
+  if (relativePath.endswith(".refs"))
+    return MergeKind::Skip;
+  if (relativePath.startswith("fnSearch/") || relativePath == "fileIndex" ||
+      relativePath == "otherIndex")
+    return MergeKind::Lines;
+  return MergeKind::Copy;
+}
+
+void splitEntries(llvm::StringRef content, MergeKind kind,
+                  llvm::SmallVectorImpl<llvm::StringRef> &entries) {
+  if (kind == MergeKind::RefEntries)
+    splitRefEntries(content, entries);
+  else
+    content.split(entries, '\n', -1, false);
+}
+
+// Append to 'output' the entries of 'input' that are not yet in there.
+// Both are the names of the uncompressed files, which may exist in any of the
+// formats of OutputFile.
+bool mergeEntries(const std::string &input, const std::string &output,
+                  MergeKind kind) {
+  std::string inputContent;
+  if (auto error_code = OutputFile::readFile(input, inputContent)) {
+    std::cerr << "Error reading " << input << ": " << error_code.message()
+              << std::endl;
+    return false;
+  }
+
+  // Keep the formats in which the file was generated
+  unsigned formats =
+      OutputFile::existingFormats(input) | OutputFile::existingFormats(output);
+
+  llvm::StringMap<unsigned> outputCount;
+  std::string outputContent;
+  if (OutputFile::fileExists(output)) {
+    if (auto error_code = OutputFile::readFile(output, outputContent)) {
+      std::cerr << "Error reading " << output << ": " << error_code.message()
+                << std::endl;
+      return false;
+    }
+    llvm::SmallVector<llvm::StringRef, 64> entries;
+    splitEntries(outputContent, kind, entries);
+    for (auto entry : entries)
+      outputCount[entry]++;
+  } else {
+    create_directories(llvm::sys::path::parent_path(output));
+  }
+
+  llvm::SmallVector<llvm::StringRef, 64> entries;
+  splitEntries(inputContent, kind, entries);
+
+  std::string appended;
+  llvm::StringMap<unsigned> inputCount;
+  for (auto entry : entries) {
+    // Only keep the extra occurrences
+    if (++inputCount[entry] > outputCount.lookup(entry))
+      appended %= entry % "\n";
+  }
+  if (appended.empty())
+    return true;
+
+  std::error_code error_code;
+  if (formats == OutputFile::Plain) {
+    llvm::raw_fd_ostream os(output, error_code, llvm::sys::fs::F_Append);
+    if (!error_code)
+      os << appended;
+  } else {
+    error_code = OutputFile::writeFile(output, outputContent + appended, formats);
+  }
+  if (error_code) {
+    std::cerr << "Error writing " << output << ": " << error_code.message()
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool copyIfMissing(const std::string &input, const std::string &output) {
+  if (llvm::sys::fs::exists(output))
+    return true;
+  create_directories(llvm::sys::path::parent_path(output));
+  if (auto error_code = llvm::sys::fs::copy_file(input, output)) {
+    std::cerr << "Error copying " << input << " to " << output << ": "
+              << error_code.message() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+bool mergeOutputs(llvm::ArrayRef<std::string> inputs, llvm::StringRef output) {
+  bool success = true;
+  create_directories(output);
+  for (const auto &input : inputs) {
+    llvm::SmallString<256> inputDir;
+    canonicalize(input, inputDir);
+    while (inputDir.endswith("/"))
+      inputDir.pop_back();
+    if (!llvm::sys::fs::is_directory(inputDir)) {
+      std::cerr << "Merge: " << input << " is not a directory" << std::endl;
+      success = false;
+      continue;
+    }
+    std::cerr << "Merging " << inputDir.c_str() << std::endl;
+
+    std::error_code EC;
+    for (llvm::sys::fs::recursive_directory_iterator it(inputDir.str(), EC),
+         DirEnd;
+         it != DirEnd && !EC; it.increment(EC)) {
+      const std::string &path = it->path();
+      llvm::StringRef relativePath =
+          llvm::StringRef(path).substr(inputDir.size() + 1);
+      // The lists of the refs of the pages are needed to write their bundles
+      bool refsBundles = relativePath.startswith(".refsBundles");
+      if (llvm::sys::path::filename(path).startswith(".") && !refsBundles) {
+        it.no_push();
+        continue;
+      }
+      if (llvm::sys::fs::is_directory(path))
+        continue;
+      if (refsBundles) {
+        success &= copyIfMissing(path, output % "/" % relativePath);
+        continue;
+      }
+
+      llvm::StringRef logicalPath = OutputFile::stripFormatSuffix(relativePath);
+      auto kind = mergeKindFor(logicalPath);
+      if (kind == MergeKind::Skip)
+        continue;
+      if (kind == MergeKind::Copy) {
+        success &= copyIfMissing(path, output % "/" % relativePath);
+        continue;
+      }
+      // The formats of a file are merged together, when reaching the first
+      // one that exists
+      std::string inputFile = inputDir.str() % "/" % logicalPath;
+      llvm::StringRef suffix = relativePath.substr(logicalPath.size());
+      bool first = true;
+      for (const char *s : {"", ".gz", ".br"}) {
+        if (suffix == s)
+          break;
+        if (llvm::sys::fs::exists(inputFile + s))
+          first = false;
+      }
+      if (first)
+        success &= mergeEntries(inputFile, output % "/" % logicalPath, kind);
+    }
+    if (EC) {
+      std::cerr << "Error reading the directory " << inputDir.c_str() << ": "
+                << EC.message() << std::endl;
+      success = false;
+    }
+  }
+  // From the merged fnSearch/ and fileIndex
+  success &= writeSearchIndex(output);
+  success &= writeFileIndex(output);
+  // From the merged refs/
+  if (llvm::sys::fs::is_directory(std::string(output % "/.refsBundles")))
+    success &= RefsBundles(output.str()).write(1, true);
+  return success;
+}
@@ -0,0 +1,51 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#pragma once
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <string>
+
+/**
+ * Splits the content of a file from the refs/ directory in its entries.
+ * Each entry starts on a new line with a '<', but the content of a <doc> entry
+ * may span several lines. The entries do not include the final '\n'.
+ */
+void splitRefEntries(llvm::StringRef content,
+                     llvm::SmallVectorImpl<llvm::StringRef> &entries);
+
+/**
+ * Merges the output directories generated by several shards (see --shard)
+ * into 'output'.
+ *
+ * The index files (refs/, fnSearch/, fileIndex and otherIndex) are merged
+ * entry by entry: an entry which is present several times in one input is kept
+ * as many times, but the entries already found in the output (because an other
+ * shard generated the same file) are not duplicated.
+ * For all the other files (the generated pages), the first input that contains
+ * the file wins, like ProjectManager::shouldProcess does within one run.
+ * fnIndex/ and fileTree/ are then written again from the merged fnSearch/
+ * and fileIndex.
+ *
+ * Returns false if some of the files could not be merged.
+ */
+bool mergeOutputs(llvm::ArrayRef<std::string> inputs, llvm::StringRef output);
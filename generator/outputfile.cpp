@@ -0,0 +1,470 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#include "outputfile.h"
+#include "filesystem.h"
+#include "stats.h"
+#include "stringbuilder.h"
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+
+#include <cstring>
+#include <iostream>
+
+#ifdef CODEBROWSER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CODEBROWSER_HAVE_BROTLI
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+#endif
+
+unsigned OutputFile::defaultFormats = OutputFile::Plain;
+std::string OutputFile::blobStore;
+
+namespace {
+
+struct FormatInfo {
+  OutputFile::Format format;
+  const char *suffix;
+};
+const FormatInfo compressedFormats[] = {{OutputFile::Gzip, ".gz"},
+                                        {OutputFile::Brotli, ".br"}};
+
+// Order in which the formats are looked up when reading
+const FormatInfo allFormats[] = {
+    {OutputFile::Plain, ""}, {OutputFile::Gzip, ".gz"}, {OutputFile::Brotli, ".br"}};
+
+} // namespace
+
+/* Compresses what is written to it into the sink */
+class OutputFile::Compressor {
+public:
+  explicit Compressor(llvm::raw_ostream &sink) : sink(sink) {}
+  virtual ~Compressor() = default;
+  virtual void write(const char *data, size_t size) = 0;
+  virtual void finish() = 0;
+
+  static std::unique_ptr<Compressor> create(Format format,
+                                             llvm::raw_ostream &sink);
+
+protected:
+  llvm::raw_ostream &sink;
+  char buffer[64 * 1024];
+};
+
+namespace {
+
+#ifdef CODEBROWSER_HAVE_ZLIB
+class GzipCompressor : public OutputFile::Compressor {
+  z_stream stream;
+
+  void deflate(int flush) {
+    do {
+      stream.next_out = reinterpret_cast<Bytef *>(buffer);
+      stream.avail_out = sizeof(buffer);
+      ::deflate(&stream, flush);
+      sink.write(buffer, sizeof(buffer) - stream.avail_out);
+    } while (stream.avail_out == 0);
+  }
+
+public:
+  explicit GzipCompressor(llvm::raw_ostream &sink) : Compressor(sink) {
+    stream = z_stream();
+    // 15 + 16: gzip header, without timestamp so the output is reproducible
+    deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                 Z_DEFAULT_STRATEGY);
+  }
+  ~GzipCompressor() override { deflateEnd(&stream); }
+  void write(const char *data, size_t size) override {
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = size;
+    deflate(Z_NO_FLUSH);
+  }
+  void finish() override { deflate(Z_FINISH); }
+};
+#endif
+
+#ifdef CODEBROWSER_HAVE_BROTLI
+class BrotliCompressor : public OutputFile::Compressor {
+  BrotliEncoderState *state;
+
+  void compress(BrotliEncoderOperation op, const char *data, size_t size) {
+    auto next_in = reinterpret_cast<const uint8_t *>(data);
+    do {
+      auto next_out = reinterpret_cast<uint8_t *>(buffer);
+      size_t avail_out = sizeof(buffer);
+      BrotliEncoderCompressStream(state, op, &size, &next_in, &avail_out,
+                                  &next_out, nullptr);
+      sink.write(buffer, sizeof(buffer) - avail_out);
+    } while (size || BrotliEncoderHasMoreOutput(state) ||
+             (op == BROTLI_OPERATION_FINISH && !BrotliEncoderIsFinished(state)));
+  }
+
+public:
+  explicit BrotliCompressor(llvm::raw_ostream &sink) : Compressor(sink) {
+    state = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+    // The quality 11 (the default) is too slow for that many files
+    BrotliEncoderSetParameter(state, BROTLI_PARAM_QUALITY, 7);
+    BrotliEncoderSetParameter(state, BROTLI_PARAM_MODE, BROTLI_MODE_TEXT);
+  }
+  ~BrotliCompressor() override { BrotliEncoderDestroyInstance(state); }
+  void write(const char *data, size_t size) override {
+    compress(BROTLI_OPERATION_PROCESS, data, size);
+  }
+  void finish() override { compress(BROTLI_OPERATION_FINISH, nullptr, 0); }
+};
+#endif
+
+bool decompress(OutputFile::Format format, llvm::StringRef data,
+                std::string &content) {
+  content.clear();
+  switch (format) {
+  case OutputFile::Plain:
+    content = data.str();
+    return true;
+  case OutputFile::Gzip: {
+#ifdef CODEBROWSER_HAVE_ZLIB
+    char buffer[64 * 1024];
+    z_stream stream = z_stream();
+    if (inflateInit2(&stream, 15 + 16) != Z_OK)
+      return false;
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    stream.avail_in = data.size();
+    int result;
+    do {
+      stream.next_out = reinterpret_cast<Bytef *>(buffer);
+      stream.avail_out = sizeof(buffer);
+      result = inflate(&stream, Z_NO_FLUSH);
+      content.append(buffer, sizeof(buffer) - stream.avail_out);
+    } while (result == Z_OK);
+    inflateEnd(&stream);
+    return result == Z_STREAM_END;
+#else
+    return false;
+#endif
+  }
+  case OutputFile::Brotli: {
+#ifdef CODEBROWSER_HAVE_BROTLI
+    char buffer[64 * 1024];
+    BrotliDecoderState *state =
+        BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+    auto next_in = reinterpret_cast<const uint8_t *>(data.data());
+    size_t avail_in = data.size();
+    BrotliDecoderResult result;
+    do {
+      auto next_out = reinterpret_cast<uint8_t *>(buffer);
+      size_t avail_out = sizeof(buffer);
+      result = BrotliDecoderDecompressStream(state, &avail_in, &next_in,
+                                             &avail_out, &next_out, nullptr);
+      content.append(buffer, sizeof(buffer) - avail_out);
+    } while (result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT);
+    BrotliDecoderDestroyInstance(state);
+    return result == BROTLI_DECODER_RESULT_SUCCESS;
+#else
+    return false;
+#endif
+  }
+  }
+  return false;
+}
+
+} // namespace
+
+std::unique_ptr<OutputFile::Compressor>
+OutputFile::Compressor::create(Format format, llvm::raw_ostream &sink) {
+  switch (format) {
+#ifdef CODEBROWSER_HAVE_ZLIB
+  case Gzip:
+    return std::unique_ptr<Compressor>(new GzipCompressor(sink));
+#endif
+#ifdef CODEBROWSER_HAVE_BROTLI
+  case Brotli:
+    return std::unique_ptr<Compressor>(new BrotliCompressor(sink));
+#endif
+  default:
+    return nullptr;
+  }
+}
+
+bool OutputFile::parseFormats(llvm::StringRef list, unsigned &formats) {
+  llvm::SmallVector<llvm::StringRef, 2> names;
+  list.split(names, ',', -1, false);
+  for (auto name : names) {
+    if (name == "gzip") {
+#ifndef CODEBROWSER_HAVE_ZLIB
+      std::cerr << "Error: gzip compression is not supported by this build"
+                << std::endl;
+      return false;
+#endif
+      formats |= Gzip;
+    } else if (name == "brotli") {
+#ifndef CODEBROWSER_HAVE_BROTLI
+      std::cerr << "Error: brotli compression is not supported by this build"
+                << std::endl;
+      return false;
+#endif
+      formats |= Brotli;
+    } else {
+      std::cerr << "Error: unknown compression format '" << name.str()
+                << "', expected 'gzip' or 'brotli'" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+OutputFile::OutputFile(const std::string &filename,
+                       std::error_code &error_code, unsigned formats)
+    : filename(filename) {
+  SetBufferSize(256 * 1024);
+  if (!blobStore.empty())
+    hash.reset(new llvm::MD5);
+  for (const auto &f : allFormats) {
+    std::string name = filename + f.suffix;
+    if (!(formats & f.format)) {
+      llvm::sys::fs::remove(name);
+      continue;
+    }
+    std::unique_ptr<llvm::raw_fd_ostream> file;
+    if (hash) {
+      // Not written in place, as the file may be a link to a blob
+      int fd;
+      llvm::SmallString<256> temporary;
+      error_code = llvm::sys::fs::createUniqueFile(name + ".tmp-%%%%%%", fd,
+                                                   temporary);
+      if (error_code)
+        return;
+      file.reset(new llvm::raw_fd_ostream(fd, /*shouldClose=*/true));
+      temporaries.emplace_back(temporary.str(), f.suffix);
+    } else {
+      file.reset(
+          new llvm::raw_fd_ostream(name, error_code, llvm::sys::fs::F_None));
+      if (error_code)
+        return;
+    }
+    if (f.format == Plain) {
+      plain = std::move(file);
+    } else {
+      compressors.push_back(Compressor::create(f.format, *file));
+      files.push_back(std::move(file));
+    }
+  }
+}
+
+OutputFile::~OutputFile() {
+  auto error_code = close();
+  if (error_code)
+    std::cerr << "Error writing " << filename << ": " << error_code.message()
+              << std::endl;
+}
+
+void OutputFile::write_impl(const char *ptr, size_t size) {
+  pos += size;
+  if (hash)
+    hash->update(llvm::StringRef(ptr, size));
+  if (plain)
+    plain->write(ptr, size);
+  for (auto &c : compressors) {
+    if (c)
+      c->write(ptr, size);
+  }
+}
+
+std::error_code OutputFile::close() {
+  if (closed)
+    return error;
+  flush();
+  closed = true;
+  for (auto &c : compressors) {
+    if (c)
+      c->finish();
+  }
+  compressors.clear();
+  if (plain)
+    files.push_back(std::move(plain));
+  for (auto &file : files) {
+    Stats::count(Stats::BytesWritten, file->tell());
+    file->close();
+    if (file->has_error()) {
+      if (!error)
+        error = file->error();
+      file->clear_error();
+    }
+  }
+  files.clear();
+  if (hash) {
+    if (!error)
+      error = storeBlobs();
+    for (const auto &temporary : temporaries)
+      llvm::sys::fs::remove(temporary.first);
+    temporaries.clear();
+  }
+  return error;
+}
+
+std::error_code OutputFile::storeBlobs() {
+  std::string hex = md5Hex(*hash);
+  std::string directory = blobStore % "/" % hex.substr(0, 2);
+  create_directories(directory);
+  for (const auto &temporary : temporaries) {
+    std::string blob = directory % "/" % hex.substr(2) % temporary.second;
+    // Another file may have the same content
+    if (!llvm::sys::fs::exists(blob) &&
+        llvm::sys::fs::rename(temporary.first, blob)) {
+      // The store is on another file system
+      if (auto error_code = llvm::sys::fs::copy_file(temporary.first, blob))
+        return error_code;
+    }
+    std::string name = filename + temporary.second;
+    llvm::sys::fs::remove(name);
+    if (llvm::sys::fs::create_hard_link(blob, name)) {
+      if (auto error_code = llvm::sys::fs::copy_file(blob, name))
+        return error_code;
+    }
+  }
+  return {};
+}
+
+unsigned OutputFile::existingFormats(const llvm::Twine &filename) {
+  std::string name = filename.str();
+  unsigned formats = 0;
+  for (const auto &f : allFormats) {
+    if (llvm::sys::fs::exists(name + f.suffix))
+      formats |= f.format;
+  }
+  return formats;
+}
+
+bool OutputFile::fileExists(const llvm::Twine &filename) {
+  std::string name = filename.str();
+  // Look first for the formats which are generated
+  for (int pass = 0; pass < 2; ++pass) {
+    for (const auto &f : allFormats) {
+      if (bool(defaultFormats & f.format) == (pass == 0) &&
+          llvm::sys::fs::exists(name + f.suffix))
+        return true;
+    }
+  }
+  return false;
+}
+
+std::error_code OutputFile::readFile(const llvm::Twine &filename,
+                                     std::string &content) {
+  std::string name = filename.str();
+  std::error_code error_code;
+  for (const auto &f : allFormats) {
+    auto buffer = llvm::MemoryBuffer::getFile(name + f.suffix);
+    if (!buffer) {
+      error_code = buffer.getError();
+      continue;
+    }
+    if (!decompress(f.format, (*buffer)->getBuffer(), content))
+      return std::make_error_code(std::errc::illegal_byte_sequence);
+    return {};
+  }
+  return error_code;
+}
+
+std::error_code OutputFile::writeFile(const llvm::Twine &filename,
+                                      llvm::StringRef content,
+                                      unsigned formats) {
+  std::string name = filename.str();
+  for (const auto &f : allFormats) {
+    if (!(formats & f.format)) {
+      llvm::sys::fs::remove(name + f.suffix);
+      continue;
+    }
+    if (auto error_code = writeFormat(name, content, f.format))
+      return error_code;
+  }
+  return {};
+}
+
+std::error_code OutputFile::writeFormat(const std::string &filename,
+                                        llvm::StringRef content,
+                                        Format format) {
+  if (format == Plain)
+    return write_file_atomically(filename, content);
+  std::string compressed;
+  {
+    llvm::raw_string_ostream os(compressed);
+    auto c = Compressor::create(format, os);
+    if (!c)
+      return std::make_error_code(std::errc::not_supported);
+    c->write(content.data(), content.size());
+    c->finish();
+  }
+  for (const auto &f : compressedFormats) {
+    if (f.format == format)
+      return write_file_atomically(filename + f.suffix, compressed);
+  }
+  return std::make_error_code(std::errc::invalid_argument);
+}
+
+void OutputFile::removeFile(const llvm::Twine &filename) {
+  std::string name = filename.str();
+  for (const auto &f : allFormats)
+    llvm::sys::fs::remove(name + f.suffix);
+}
+
+void OutputFile::prepareAppend(const std::string &filename) {
+  if (llvm::sys::fs::exists(filename))
+    return; // The uncompressed file, if any, is the most recent
+  std::string content;
+  if (readFile(filename, content))
+    return;
+  if (auto error_code = write_file_atomically(filename, content))
+    std::cerr << "Error writing " << filename << ": " << error_code.message()
+              << std::endl;
+}
+
+void OutputFile::finishAppend(const std::string &filename) {
+  if (!llvm::sys::fs::exists(filename))
+    return;
+  std::string content;
+  if (defaultFormats != Plain && readFile(filename, content))
+    return;
+  for (const auto &f : compressedFormats) {
+    if (!(defaultFormats & f.format)) {
+      // Remove the compressed files of previous runs
+      llvm::sys::fs::remove(filename + f.suffix);
+    } else if (auto error_code = writeFormat(filename, content, f.format)) {
+      std::cerr << "Error writing " << filename << f.suffix << ": "
+                << error_code.message() << std::endl;
+      return;
+    }
+  }
+  if (!(defaultFormats & Plain))
+    llvm::sys::fs::remove(filename);
+}
+
+llvm::StringRef OutputFile::stripFormatSuffix(llvm::StringRef filename) {
+  for (const auto &f : compressedFormats) {
+    if (filename.endswith(f.suffix))
+      return filename.drop_back(std::strlen(f.suffix));
+  }
+  return filename;
+}
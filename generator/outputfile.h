@@ -0,0 +1,118 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace llvm {
+class MD5;
+class Twine;
+} // namespace llvm
+
+/**
+ * A file of the output directory.
+ *
+ * Depending on the formats, "file" is written as is, and/or compressed as
+ * "file.gz" and "file.br", which web servers can serve for "file" (for
+ * example nginx with gzip_static and brotli_static), so the javascript keeps
+ * fetching the same URLs.
+ * The content is compressed while it is written.
+ */
+class OutputFile : public llvm::raw_ostream {
+public:
+  enum Format { Plain = 1, Gzip = 2, Brotli = 4 };
+
+  // The formats of the files written by the generator (--compress)
+  static unsigned defaultFormats;
+
+  // When set, what is written with an OutputFile is stored once in that
+  // directory, in a file named after the hash of the content, and the file in
+  // the output directory is a hard link to it (--blob-store). These files must
+  // not be modified in place.
+  static std::string blobStore;
+
+  // Parses a comma separated list of "gzip" and "brotli". Returns false and
+  // prints an error if a format is unknown or not supported by this build.
+  static bool parseFormats(llvm::StringRef list, unsigned &formats);
+
+  // Opens the file for writing. The variants of the file in other formats
+  // are removed.
+  OutputFile(const std::string &filename, std::error_code &error_code,
+             unsigned formats = defaultFormats);
+  ~OutputFile() override;
+
+  // Finishes writing the file, and returns the first error.
+  std::error_code close();
+
+  // Whether the file exists in any of the formats
+  static bool fileExists(const llvm::Twine &filename);
+  // The formats in which the file exists
+  static unsigned existingFormats(const llvm::Twine &filename);
+  // Reads the (uncompressed) content of the file, from any of the formats
+  static std::error_code readFile(const llvm::Twine &filename,
+                                  std::string &content);
+  // Writes the file, atomically
+  static std::error_code writeFile(const llvm::Twine &filename,
+                                   llvm::StringRef content,
+                                   unsigned formats = defaultFormats);
+  // Removes the file in all its formats
+  static void removeFile(const llvm::Twine &filename);
+
+  /* The files that are appended to during a run (fileIndex, fnSearch/...)
+   * are kept uncompressed while the generator runs: prepareAppend()
+   * decompresses the file if it only exists compressed, and finishAppend()
+   * writes the compressed formats from the uncompressed file. */
+  static void prepareAppend(const std::string &filename);
+  static void finishAppend(const std::string &filename);
+
+  // Returns the name of the file without the suffix of its format
+  static llvm::StringRef stripFormatSuffix(llvm::StringRef filename);
+
+  class Compressor;
+
+private:
+  static std::error_code writeFormat(const std::string &filename,
+                                     llvm::StringRef content, Format format);
+  void write_impl(const char *ptr, size_t size) override;
+  uint64_t current_pos() const override { return pos; }
+
+  // Moves the temporary files written with the blob store into it, and links
+  // them from the output directory
+  std::error_code storeBlobs();
+
+  std::string filename;
+  std::unique_ptr<llvm::raw_fd_ostream> plain;
+  std::vector<std::unique_ptr<llvm::raw_fd_ostream>> files;
+  std::vector<std::unique_ptr<Compressor>> compressors;
+  uint64_t pos = 0;
+  // With the blob store: the hash of the content, and the temporary file in
+  // which each format is written along with its suffix
+  std::unique_ptr<llvm::MD5> hash;
+  std::vector<std::pair<std::string, const char *>> temporaries;
+  std::error_code error;
+  bool closed = false;
+};
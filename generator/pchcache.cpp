@@ -0,0 +1,330 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#include "pchcache.h"
+#include "filesystem.h"
+#include "projectmanager.h"
+#include "stringbuilder.h"
+
+#include <clang/Basic/SourceManager.h>
+#include <clang/Basic/Version.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendActions.h>
+#include <clang/Lex/HeaderSearch.h>
+#include <clang/Lex/Preprocessor.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <iostream>
+
+namespace {
+
+/* Builds the precompiled header and lists the files that are in it */
+class BuildPchAction : public clang::GeneratePCHAction {
+  std::string output;
+  std::vector<std::string> &files;
+  bool &guarded;
+
+protected:
+#if CLANG_VERSION_MAJOR == 3 && CLANG_VERSION_MINOR <= 5
+  clang::ASTConsumer *
+#else
+  std::unique_ptr<clang::ASTConsumer>
+#endif
+  CreateASTConsumer(clang::CompilerInstance &CI,
+                    llvm::StringRef InFile) override {
+    CI.getFrontendOpts().OutputFile = output;
+    // As for the headers that are not generated (see BrowserAction)
+    CI.getFrontendOpts().SkipFunctionBodies = true;
+    return clang::GeneratePCHAction::CreateASTConsumer(CI, InFile);
+  }
+
+  void EndSourceFileAction() override {
+    clang::CompilerInstance &CI = getCompilerInstance();
+    clang::SourceManager &SM = CI.getSourceManager();
+    clang::HeaderSearch &HS = CI.getPreprocessor().getHeaderSearchInfo();
+    for (auto it = SM.fileinfo_begin(); it != SM.fileinfo_end(); ++it) {
+      const clang::FileEntry *FE = it->first;
+      clang::FileID FID = SM.translateFile(FE);
+      if (FID == SM.getMainFileID())
+        continue;
+      // The translation unit includes its first includes again, after having
+      // loaded the precompiled header: they must be skipped by the guards
+      if (SM.getFileID(SM.getIncludeLoc(FID)) == SM.getMainFileID() &&
+          !HS.isFileMultipleIncludeGuarded(FE))
+        guarded = false;
+      llvm::SmallString<256> filename;
+      canonicalize(FE->getName(), filename);
+      files.push_back(filename.str());
+    }
+    clang::GeneratePCHAction::EndSourceFileAction();
+  }
+
+public:
+  BuildPchAction(std::string output, std::vector<std::string> &files,
+                 bool &guarded)
+      : output(std::move(output)), files(files), guarded(guarded) {}
+};
+
+/* The #include lines at the beginning of the file, before any other code */
+std::vector<std::string> leadingIncludes(llvm::StringRef content) {
+  std::vector<std::string> includes;
+  bool inComment = false;
+  while (!content.empty()) {
+    llvm::StringRef line;
+    std::tie(line, content) = content.split('\n');
+    line = line.trim();
+    if (inComment) {
+      auto end = line.find("*/");
+      if (end == llvm::StringRef::npos)
+        continue;
+      line = line.substr(end + 2).ltrim();
+      inComment = false;
+    }
+    if (line.empty() || line.startswith("//"))
+      continue;
+    if (line.startswith("/*")) {
+      auto end = line.find("*/", 2);
+      if (end == llvm::StringRef::npos)
+        inComment = true;
+      else if (!line.substr(end + 2).trim().empty())
+        break;
+      continue;
+    }
+    if (!line.startswith("#"))
+      break;
+    llvm::StringRef directive = line.substr(1).ltrim();
+    // #define, #if, #pragma once, ... might change what follows
+    if (!directive.startswith("include") ||
+        directive.startswith("include_next"))
+      break;
+    auto comment = line.find("/*");
+    if (line.endswith("\\") || (comment != llvm::StringRef::npos &&
+                                line.find("*/", comment) == llvm::StringRef::npos))
+      break;
+    includes.push_back(line.str());
+  }
+  return includes;
+}
+
+bool isDependencyFlag(llvm::StringRef arg, bool &hasValue) {
+  hasValue = arg == "-MF" || arg == "-MT" || arg == "-MQ";
+  return hasValue || arg == "-M" || arg == "-MM" || arg == "-MD" ||
+         arg == "-MMD" || arg == "-MP" || arg == "-MG" ||
+         arg.startswith("-MF") || arg.startswith("-MT") ||
+         arg.startswith("-MQ");
+}
+
+/* The command to build the precompiled header 'header' for 'file': the input
+ * is replaced and the dependency file options are removed.
+ * Returns false if the command cannot be used with a precompiled header */
+bool pchCommand(const std::vector<std::string> &command, llvm::StringRef file,
+                llvm::StringRef header, std::vector<std::string> &result) {
+  llvm::StringRef language =
+      llvm::StringSwitch<llvm::StringRef>(llvm::sys::path::extension(file))
+          .Case(".c", "-xc-header")
+          .Case(".m", "-xobjective-c-header")
+          .Case(".mm", "-xobjective-c++-header")
+          .Default("-xc++-header");
+  llvm::StringRef fileName = llvm::sys::path::filename(file);
+  int inputs = 0;
+  for (std::size_t i = 0; i < command.size(); ++i) {
+    llvm::StringRef arg = command[i];
+    bool hasValue;
+    if (i > 0 && isDependencyFlag(arg, hasValue)) {
+      if (hasValue)
+        ++i;
+      continue;
+    }
+    // Those are included before the main file, and so before its includes
+    if (arg.startswith("-include") || arg.startswith("-imacros"))
+      return false;
+    if (i > 0 && !arg.startswith("-") &&
+        llvm::sys::path::filename(arg) == fileName) {
+      result.push_back(language.str());
+      result.push_back(header.str());
+      ++inputs;
+      continue;
+    }
+    result.push_back(arg.str());
+  }
+  return inputs == 1;
+}
+
+} // namespace
+
+PchCache::PchCache(std::string directory) : directory(std::move(directory)) {}
+
+bool PchCache::find(const std::vector<std::string> &command,
+                    llvm::StringRef file, ProjectManager &projectManager,
+                    clang::FileManager *FM, Use &use) {
+  std::vector<std::string> flags;
+  if (!pchCommand(command, file, {}, flags))
+    return false;
+  auto buffer = llvm::MemoryBuffer::getFile(file);
+  if (!buffer)
+    return false;
+  std::vector<std::string> includes = leadingIncludes((*buffer)->getBuffer());
+  if (includes.empty())
+    return false;
+
+  // keys[i] is the key of the first i+1 includes
+  std::vector<std::string> keys;
+  llvm::MD5 hash;
+  for (const auto &arg : flags) {
+    hash.update(arg);
+    hash.update(llvm::StringRef("", 1));
+  }
+  // The quoted includes are relative to the directory of the file
+  hash.update(llvm::sys::path::parent_path(file));
+  for (const auto &include : includes) {
+    hash.update(llvm::StringRef("\n", 1));
+    hash.update(include);
+    keys.push_back(md5Hex(hash));
+  }
+
+  // Use the longest prefix that is precompiled, or that an other translation
+  // unit had (and precompile it)
+  int best = -1;
+  bool needBuild = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int i = int(keys.size()) - 1; i >= 0 && best < 0; --i) {
+      auto it = entries.find(keys[i]);
+      if (it == entries.end()) {
+        it = entries.insert({keys[i], Entry()}).first;
+        if (load(keys[i], it->second.files))
+          it->second.state = Entry::Built;
+      }
+      Entry &entry = it->second;
+      if (entry.state == Entry::Built) {
+        best = i;
+      } else if (entry.state == Entry::Absent && entry.seen > 0) {
+        best = i;
+        needBuild = true;
+        entry.state = Entry::Building;
+      }
+    }
+    for (const auto &key : keys)
+      entries[key].seen++;
+  }
+  if (best < 0)
+    return false;
+
+  const std::string &key = keys[best];
+  if (needBuild) {
+    std::vector<std::string> files;
+    bool built = build(key, command, file,
+                       llvm::makeArrayRef(includes).slice(0, best + 1), FM,
+                       files);
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &entry = entries[key];
+    entry.state = built ? Entry::Built : Entry::Failed;
+    entry.files = std::move(files);
+    if (!built)
+      return false;
+  }
+
+  use.key = key;
+  use.pch = directory % "/" % key % ".pch";
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    use.files = entries[key].files;
+  }
+
+  // What is in the precompiled header is not seen by the annotator, so all
+  // the pages for these files must have been generated already
+  for (const auto &f : use.files) {
+    auto project = projectManager.projectForFile(f);
+    if (project && projectManager.shouldProcess(f, project))
+      return false;
+  }
+  return true;
+}
+
+bool PchCache::build(const std::string &key,
+                     const std::vector<std::string> &command,
+                     llvm::StringRef file, llvm::ArrayRef<std::string> includes,
+                     clang::FileManager *FM, std::vector<std::string> &files) {
+  std::string header = directory % "/" % key % ".h";
+  std::string pch = directory % "/" % key % ".pch";
+  std::string content;
+  for (const auto &include : includes)
+    content += include + '\n';
+  if (write_file_atomically(header, content)) {
+    std::cerr << "Error: could not write " << header << std::endl;
+    return false;
+  }
+
+  std::vector<std::string> args;
+  pchCommand(command, file, header, args);
+  // The header is not in the directory of the file
+  args.insert(args.begin() + 1,
+              {"-iquote", llvm::sys::path::parent_path(file).str()});
+
+  bool guarded = true;
+  clang::IgnoringDiagConsumer diagnostics;
+  clang::tooling::ToolInvocation Inv(
+      args, new BuildPchAction(pch, files, guarded), FM);
+  Inv.setDiagnosticConsumer(&diagnostics);
+  if (!Inv.run() || !guarded) {
+    llvm::sys::fs::remove(pch);
+    llvm::sys::fs::remove(header);
+    return false;
+  }
+
+  // The list of files is written last: it tells the next runs that the
+  // precompiled header is complete
+  std::string list;
+  for (const auto &f : files)
+    list += f + '\n';
+  return !write_file_atomically(std::string(directory % "/" % key % ".files"),
+                                list);
+}
+
+bool PchCache::load(const std::string &key, std::vector<std::string> &files) {
+  auto buffer = llvm::MemoryBuffer::getFile(std::string(directory % "/" % key % ".files"));
+  if (!buffer)
+    return false;
+  llvm::SmallVector<llvm::StringRef, 64> lines;
+  (*buffer)->getBuffer().split(lines, '\n', -1, false);
+  for (auto line : lines)
+    files.push_back(line.str());
+  return true;
+}
+
+void PchCache::discard(const Use &use) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Not built again during this run: the FileManagers have the old one
+    entries[use.key].state = Entry::Failed;
+  }
+  llvm::sys::fs::remove(std::string(directory % "/" % use.key % ".files"));
+  llvm::sys::fs::remove(use.pch);
+  llvm::sys::fs::remove(std::string(directory % "/" % use.key % ".h"));
+}
+
+std::vector<std::string> PchCache::arguments(const Use &use) {
+  return {"-include-pch", use.pch};
+}
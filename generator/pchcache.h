@@ -0,0 +1,95 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#pragma once
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace clang {
+class FileManager;
+}
+
+struct ProjectManager;
+
+/**
+ * The cache of precompiled headers used with --pch-cache
+ *
+ * The leading #include lines of a source file (before any other code) are
+ * precompiled into <cache>/<key>.pch, where the key is a hash of the compile
+ * flags, of the directory of the file and of the include lines. The
+ * translation units with the same flags and the same first includes then load
+ * that precompiled header with -include-pch. Their own #include lines are then
+ * skipped by the include guards, without lexing the headers again.
+ *
+ * A precompiled header is only built once a second translation unit shares its
+ * includes. It is only used once all the files it contains were generated by
+ * an other translation unit (the annotator does not see what is in it). It is
+ * kept between the runs: clang refuses to load it when one of its headers
+ * changed, and it is then built again.
+ */
+class PchCache {
+public:
+  explicit PchCache(std::string directory);
+
+  struct Use {
+    std::string key;
+    std::string pch;
+    // The files (canonicalized) that are in the precompiled header
+    std::vector<std::string> files;
+  };
+
+  /**
+   * Finds, or builds, a precompiled header for the leading includes of 'file',
+   * which is compiled with 'command' (already adjusted by proceedCommand).
+   * It is built with 'FM', which must provide the builtins includes. Returns
+   * false if there is none that can be used.
+   */
+  bool find(const std::vector<std::string> &command, llvm::StringRef file,
+            ProjectManager &projectManager, clang::FileManager *FM, Use &use);
+
+  // The precompiled header could not be loaded: remove it from the cache
+  void discard(const Use &use);
+
+  // Returns the arguments to use 'use' with the command
+  static std::vector<std::string> arguments(const Use &use);
+
+private:
+  std::string directory;
+
+  struct Entry {
+    enum State { Absent, Building, Built, Failed } state = Absent;
+    // Number of translation units that had this key
+    unsigned seen = 0;
+    std::vector<std::string> files;
+  };
+  std::mutex mutex;
+  llvm::StringMap<Entry> entries;
+
+  bool build(const std::string &key, const std::vector<std::string> &command,
+             llvm::StringRef file, llvm::ArrayRef<std::string> includes,
+             clang::FileManager *FM, std::vector<std::string> &files);
+  // Reads the list of the files of a precompiled header of a previous run
+  bool load(const std::string &key, std::vector<std::string> &files);
+};
@@ -22,25 +22,37 @@
 #include "preprocessorcallback.h"
 #include "annotator.h"
 #include "projectmanager.h"
+#include "stats.h"
 #include "stringbuilder.h"
 #include <clang/Basic/Version.h>
 #include <clang/Lex/MacroInfo.h>
 #include <clang/Lex/Preprocessor.h>
 #include <clang/Lex/Token.h>
 #include <llvm/ADT/Twine.h>
+#include <algorithm>
 
 void PreprocessorCallback::MacroExpands(const clang::Token &MacroNameTok,
                                         MyMacroDefinition MD,
                                         clang::SourceRange Range,
                                         const clang::MacroArgs *) {
-  if (disabled)
-    return;
-
+  Stats::Timer timer(Stats::MacroExpansion);
 #if CLANG_VERSION_MAJOR != 3 || CLANG_VERSION_MINOR >= 7
   auto *MI = MD.getMacroInfo();
 #else
   auto *MI = MD->getMacroInfo();
 #endif
+
+  if (disabled) {
+    // Expanded while computing an expansion (see expandMacro)
+    if (currentExpansion && MI) {
+      if (MI->isBuiltinMacro()) // __LINE__, __COUNTER__, ...
+        currentExpansion->cacheable = false;
+      currentExpansion->dependencies.push_back(
+          {MacroNameTok.getIdentifierInfo(), MI});
+    }
+    return;
+  }
+
   clang::SourceLocation loc = MacroNameTok.getLocation();
   if (!loc.isValid() || !loc.isFileID())
     return;
@@ -49,13 +61,78 @@ void PreprocessorCallback::MacroExpands(const clang::Token &MacroNameTok,
   if (!annotator.shouldProcess(FID))
     return;
 
-  const char *begin = sm.getCharacterData(Range.getBegin());
-  int len = sm.getCharacterData(Range.getEnd()) - begin;
-  len += clang::Lexer::MeasureTokenLength(Range.getEnd(), sm, PP.getLangOpts());
+  std::string ref =
+      llvm::Twine("_M/", MacroNameTok.getIdentifierInfo()->getName()).str();
+
+  clang::SourceLocation defLoc = MI->getDefinitionLoc();
+  clang::FileID defFID = sm.getFileID(defLoc);
+  std::string link;
+  std::string dataProj;
+  if (defFID != FID) {
+    link = annotator.pathTo(FID, defFID, &dataProj);
+    if (!dataProj.empty()) {
+      dataProj = " data-proj=\"" % dataProj % "\"";
+    }
+  }
+  // Without a link to the definition, the browser cannot show it instead
+  bool lazy = annotator.projectManager.lazyMacroExpansions &&
+              (defFID == FID || !link.empty());
+
+  std::string title;
+  if (!lazy) {
+    const char *begin = sm.getCharacterData(Range.getBegin());
+    int len = sm.getCharacterData(Range.getEnd()) - begin;
+    len += clang::Lexer::MeasureTokenLength(Range.getEnd(), sm,
+                                            PP.getLangOpts());
+    llvm::StringRef text(begin, len);
+
+    // The same macro is often invoked with the same arguments (assert,
+    // Q_OBJECT, ...): reuse the expansion if what it expanded did not change
+    auto &cache = expansions[MI];
+    auto it = cache.find(text);
+    const Expansion *expansion;
+    Expansion computed;
+    if (it != cache.end() && isUpToDate(it->second)) {
+      expansion = &it->second;
+    } else {
+      expandMacro(MacroNameTok, text, computed);
+      expansion = &computed;
+      if (computed.cacheable) {
+        Expansion &cached = cache[text];
+        cached = std::move(computed);
+        expansion = &cached;
+      }
+    }
+    title = " title=\"" % expansion->title % "\"";
+  }
+
+  if (defFID != FID && link.empty()) {
+    std::string tag =
+        "class=\"macro\"" % title % " data-ref=\"" % ref % "\"";
+    annotator.generator(FID).addTag("span", tag, sm.getFileOffset(loc),
+                                    MacroNameTok.getLength());
+    return;
+  }
+
+  if (sm.getMainFileID() != defFID) {
+    annotator.registerMacro(ref, MacroNameTok.getLocation(),
+                            Annotator::Use_Call);
+  }
 
-  std::string copy(begin, len);
-  begin = copy.c_str();
-  clang::Lexer lex(loc, PP.getLangOpts(), begin, begin, begin + len);
+  std::string tag = "class=\"macro\" href=\"" % link % "#" %
+                    llvm::Twine(sm.getExpansionLineNumber(defLoc)).str() %
+                    "\"" % title % " data-ref=\"" % ref % "\"" % dataProj;
+  annotator.generator(FID).addTag("a", tag, sm.getFileOffset(loc),
+                                  MacroNameTok.getLength());
+}
+
+void PreprocessorCallback::expandMacro(const clang::Token &MacroNameTok,
+                                       llvm::StringRef text,
+                                       Expansion &result) {
+  clang::SourceLocation loc = MacroNameTok.getLocation();
+  std::string copy = text.str();
+  const char *begin = copy.c_str();
+  clang::Lexer lex(loc, PP.getLangOpts(), begin, begin, begin + copy.size());
   std::vector<clang::Token> tokens;
   std::string expansion;
 
@@ -95,6 +172,7 @@ void PreprocessorCallback::MacroExpands(const clang::Token &MacroNameTok,
                                     new clang::IgnoringDiagConsumer);
 
   disabled = true;
+  currentExpansion = &result;
   clang::DiagnosticsEngine *OldDiags = &PP.getDiagnostics();
   PP.setDiagnostics(TmpDiags);
 
@@ -121,6 +199,11 @@ void PreprocessorCallback::MacroExpands(const clang::Token &MacroNameTok,
       continue;
     }
 
+    // An identifier in the expansion would be expanded if it was defined as a
+    // macro later
+    if (auto *II = tok.getIdentifierInfo())
+      result.dependencies.push_back({II, PP.getMacroInfo(II)});
+
     // If the tokens were already space separated, or if they must be to avoid
     // them being implicitly pasted, add a space between them.
     if (tok.hasLeadingSpace())
@@ -142,44 +225,25 @@ void PreprocessorCallback::MacroExpands(const clang::Token &MacroNameTok,
 
   PP.setDiagnostics(*OldDiags);
   PP.setPragmasEnabled(pragmasPreviouslyEnabled);
+  currentExpansion = nullptr;
   disabled = false;
 
-  std::string ref =
-      llvm::Twine("_M/", MacroNameTok.getIdentifierInfo()->getName()).str();
-
-  clang::SourceLocation defLoc = MI->getDefinitionLoc();
-  clang::FileID defFID = sm.getFileID(defLoc);
   llvm::SmallString<128> expansionBuffer;
-  std::string link;
-  std::string dataProj;
-  if (defFID != FID) {
-    link = annotator.pathTo(FID, defFID, &dataProj);
-    if (link.empty()) {
-      std::string tag = "class=\"macro\" title=\"" %
-                        Generator::escapeAttr(expansion, expansionBuffer) %
-                        "\" data-ref=\"" % ref % "\"";
-      annotator.generator(FID).addTag("span", tag, sm.getFileOffset(loc),
-                                      MacroNameTok.getLength());
-      return;
-    }
+  result.title = Generator::escapeAttr(expansion, expansionBuffer).str();
 
-    if (!dataProj.empty()) {
-      dataProj = " data-proj=\"" % dataProj % "\"";
-    }
-  }
+  // Most expansions use the same few macros many times
+  std::sort(result.dependencies.begin(), result.dependencies.end());
+  result.dependencies.erase(
+      std::unique(result.dependencies.begin(), result.dependencies.end()),
+      result.dependencies.end());
+}
 
-  if (sm.getMainFileID() != defFID) {
-    annotator.registerMacro(ref, MacroNameTok.getLocation(),
-                            Annotator::Use_Call);
+bool PreprocessorCallback::isUpToDate(const Expansion &expansion) {
+  for (const auto &dependency : expansion.dependencies) {
+    if (PP.getMacroInfo(dependency.first) != dependency.second)
+      return false;
   }
-
-  std::string tag = "class=\"macro\" href=\"" % link % "#" %
-                    llvm::Twine(sm.getExpansionLineNumber(defLoc)).str() %
-                    "\" title=\"" %
-                    Generator::escapeAttr(expansion, expansionBuffer) %
-                    "\" data-ref=\"" % ref % "\"" % dataProj;
-  annotator.generator(FID).addTag("a", tag, sm.getFileOffset(loc),
-                                  MacroNameTok.getLength());
+  return true;
 }
 
 void PreprocessorCallback::MacroDefined(const clang::Token &MacroNameTok,
@@ -24,6 +24,10 @@
 #include <clang/Basic/Version.h>
 #include <clang/Lex/MacroInfo.h>
 #include <clang/Lex/PPCallbacks.h>
+#include <llvm/ADT/StringMap.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace clang {
 class Preprocessor;
@@ -38,6 +42,26 @@ class PreprocessorCallback : public clang::PPCallbacks {
   bool seenPragma = false; // To detect _Pragma in expansion
   bool recoverIncludePath; // If we should try to find the include paths harder
 
+  // The expansion of a macro, as shown in the tooltip
+  struct Expansion {
+    std::string title; // escaped for the attribute
+    bool cacheable = true;
+    // The macros that were expanded, or that could have been, with their
+    // definition at the time
+    std::vector<std::pair<const clang::IdentifierInfo *,
+                          const clang::MacroInfo *>>
+        dependencies;
+  };
+  // The expansions already computed in this translation unit, by macro and by
+  // text of the invocation
+  std::unordered_map<const clang::MacroInfo *, llvm::StringMap<Expansion>>
+      expansions;
+  Expansion *currentExpansion = nullptr; // The one being computed
+
+  void expandMacro(const clang::Token &MacroNameTok, llvm::StringRef text,
+                   Expansion &result);
+  bool isUpToDate(const Expansion &expansion);
+
 public:
   PreprocessorCallback(Annotator &fm, clang::Preprocessor &PP,
                        bool recoverIncludePath)
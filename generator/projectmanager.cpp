@@ -21,15 +21,23 @@
 
 #include "projectmanager.h"
 #include "filesystem.h"
+#include "outputfile.h"
 #include "stringbuilder.h"
 
 #include <clang/Basic/Version.h>
 #include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/Twine.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/Path.h>
+#include <functional>
+#include <iostream>
+#include <tuple>
 
 ProjectManager::ProjectManager(std::string outputPrefix, std::string _dataPath)
-    : outputPrefix(std::move(outputPrefix)), dataPath(std::move(_dataPath)) {
+    : outputPrefix(std::move(outputPrefix)), dataPath(std::move(_dataPath)),
+      refsDatabase(this->outputPrefix), projectNodes(1) {
   if (dataPath.empty())
     dataPath = "../data";
 
@@ -47,28 +55,51 @@ void ProjectManager::addProject(ProjectInfo info) {
     filename += '/';
   info.source_path = filename.c_str();
 
+  // Insert the components of the source path (which ends with '/') in the trie
+  unsigned node = 0;
+  llvm::StringRef path = info.source_path;
+  while (!path.empty()) {
+    auto pos = path.find('/');
+    auto component = path.substr(0, pos);
+    path = path.substr(pos + 1);
+    auto it = projectNodes[node].children.find(component);
+    if (it != projectNodes[node].children.end()) {
+      node = it->second;
+    } else {
+      unsigned child = projectNodes.size();
+      projectNodes[node].children[component] = child;
+      projectNodes.emplace_back();
+      node = child;
+    }
+  }
+  // With the same source path, the last project wins
+  projectNodes[node].project = projects.size();
+
   projects.push_back(std::move(info));
 }
 
 ProjectInfo *ProjectManager::projectForFile(llvm::StringRef filename) {
-  unsigned int match_length = 0;
   ProjectInfo *result = nullptr;
 
-  for (auto &it : projects) {
-    const std::string &source_path = it.source_path;
-    if (source_path.size() < match_length) {
-      continue;
-    }
-    if (filename.startswith(source_path)) {
-      result = &it;
-      match_length = source_path.size();
-    }
+  // The deepest project whose source path is a prefix of the filename.
+  // Only the components followed by a '/' can be part of a source path.
+  unsigned node = 0;
+  for (auto pos = filename.find('/'); pos != llvm::StringRef::npos;
+       pos = filename.find('/')) {
+    const auto &children = projectNodes[node].children;
+    auto it = children.find(filename.substr(0, pos));
+    if (it == children.end())
+      break;
+    node = it->second;
+    if (projectNodes[node].project >= 0)
+      result = &projects[projectNodes[node].project];
+    filename = filename.substr(pos + 1);
   }
   return result;
 }
 
 bool ProjectManager::shouldProcess(llvm::StringRef filename,
-                                   ProjectInfo *project) {
+                                   ProjectInfo *project, const void *owner) {
   if (!project)
     return false;
   if (project->type == ProjectInfo::External)
@@ -76,33 +107,166 @@ bool ProjectManager::shouldProcess(llvm::StringRef filename,
 
   std::string fn = outputPrefix % "/" % project->name % "/" %
                    filename.substr(project->source_path.size()) % ".html";
-  return !llvm::sys::fs::exists(fn);
-  // || boost::filesystem::last_write_time(p) < entry->getModificationTime();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = claimedFiles.find(fn);
+  if (it != claimedFiles.end())
+    return it->second == owner;
+  if (OutputFile::fileExists(fn))
+    return false;
+  if (owner)
+    claimedFiles.insert({std::move(fn), owner});
+  return true;
+}
+
+void ProjectManager::releaseClaims(const void *owner) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto it = claimedFiles.begin(); it != claimedFiles.end();) {
+    if (it->second == owner)
+      it = claimedFiles.erase(it);
+    else
+      ++it;
+  }
+}
+
+namespace {
+
+// A directory of the include recovery index
+struct IndexedDirectory {
+  int64_t mtime = 0;
+  std::vector<std::string> files;
+  std::vector<std::string> subdirs;
+};
+
+// The hidden entries are not indexed
+void scanDirectory(const std::string &dir, IndexedDirectory &result) {
+  std::error_code EC;
+  for (llvm::sys::fs::directory_iterator it(dir, EC), DirEnd;
+       it != DirEnd && !EC; it.increment(EC)) {
+    auto fileName = llvm::sys::path::filename(it->path());
+    if (fileName.startswith("."))
+      continue;
+    if (llvm::sys::fs::is_directory(it->path()))
+      result.subdirs.push_back(fileName.str());
+    else
+      result.files.push_back(fileName.str());
+  }
+}
+
+// The file contains, for each directory, a line "d <mtime> <path>" followed by
+// the lines "f <name>" of its files and "s <name>" of its sub directories.
+llvm::StringMap<IndexedDirectory> loadIndex(const std::string &indexFile) {
+  llvm::StringMap<IndexedDirectory> result;
+  auto B = llvm::MemoryBuffer::getFile(indexFile);
+  if (!B)
+    return result;
+  llvm::SmallVector<llvm::StringRef, 256> lines;
+  B.get()->getBuffer().split(lines, '\n', -1, false);
+  IndexedDirectory *current = nullptr;
+  for (auto line : lines) {
+    if (line.startswith("d\t")) {
+      llvm::StringRef mtime, path;
+      std::tie(mtime, path) = line.substr(2).split('\t');
+      current = &result[path];
+      if (mtime.getAsInteger(10, current->mtime))
+        return {}; // corrupted
+    } else if (!current) {
+      return {};
+    } else if (line.startswith("f\t")) {
+      current->files.push_back(line.substr(2).str());
+    } else if (line.startswith("s\t")) {
+      current->subdirs.push_back(line.substr(2).str());
+    }
+  }
+  return result;
+}
+
+// The number of path components (at least the file name) at the end of the
+// include name that are also at the end of the candidate
+int commonSuffixComponents(llvm::StringRef candidate,
+                           llvm::StringRef includeName) {
+  int count = 0;
+  while (true) {
+    auto candidatePos = candidate.rfind('/');
+    auto includePos = includeName.rfind('/');
+    if (candidate.substr(candidatePos + 1) !=
+        includeName.substr(includePos + 1))
+      break;
+    ++count;
+    if (candidatePos == llvm::StringRef::npos ||
+        includePos == llvm::StringRef::npos)
+      break;
+    candidate = candidate.substr(0, candidatePos);
+    includeName = includeName.substr(0, includePos);
+  }
+  return count;
+}
+
+} // namespace
+
+void ProjectManager::buildIncludeRecoveryCache() {
+  // The directories whose modification time did not change since the last run
+  // are not read again
+  std::string indexFile = outputPrefix % "/.includeRecovery";
+  auto previous = loadIndex(indexFile);
+  llvm::StringMap<IndexedDirectory> current;
+  bool changed = false;
+
+  std::function<void(const std::string &)> walk = [&](const std::string &dir) {
+    llvm::sys::fs::file_status status;
+    if (llvm::sys::fs::status(dir, status))
+      return;
+    IndexedDirectory entry;
+    entry.mtime = status.getLastModificationTime().time_since_epoch().count();
+    auto it = previous.find(dir);
+    if (it != previous.end() && it->second.mtime == entry.mtime) {
+      entry = std::move(it->second);
+    } else {
+      scanDirectory(dir, entry);
+      changed = true;
+    }
+    llvm::StringRef prefix = llvm::StringRef(dir).endswith("/") ? "" : "/";
+    for (const auto &file : entry.files)
+      includeRecoveryCache.insert({file, std::string(dir % prefix % file)});
+    for (const auto &subdir : entry.subdirs)
+      walk(std::string(dir % prefix % subdir));
+    current[dir] = std::move(entry);
+  };
+
+  for (const auto &proj : projects) {
+    // skip sub project
+    llvm::StringRef sourcePath(proj.source_path);
+    auto parentPath = sourcePath.substr(0, sourcePath.rfind('/'));
+    if (projectForFile(parentPath))
+      continue;
+    walk(sourcePath.str());
+  }
+
+  if (!changed && current.size() == previous.size())
+    return;
+  std::string content;
+  for (const auto &dir : current) {
+    content %= "d\t" % llvm::Twine(dir.getValue().mtime).str() % "\t" %
+               dir.getKey() % "\n";
+    for (const auto &file : dir.getValue().files)
+      content %= "f\t" % file % "\n";
+    for (const auto &subdir : dir.getValue().subdirs)
+      content %= "s\t" % subdir % "\n";
+  }
+  create_directories(outputPrefix);
+  if (auto error_code = write_file_atomically(indexFile, content)) {
+    std::cerr << "Error writing " << indexFile << ": " << error_code.message()
+              << std::endl;
+  }
 }
 
 std::string ProjectManager::includeRecovery(llvm::StringRef includeName,
                                             llvm::StringRef from) {
 #if CLANG_VERSION_MAJOR != 3 || CLANG_VERSION_MINOR >= 5
-  if (includeRecoveryCache.empty()) {
-    for (const auto &proj : projects) {
-      // skip sub project
-      llvm::StringRef sourcePath(proj.source_path);
-      auto parentPath = sourcePath.substr(0, sourcePath.rfind('/'));
-      if (projectForFile(parentPath))
-        continue;
-
-      std::error_code EC;
-      for (llvm::sys::fs::recursive_directory_iterator it(sourcePath, EC),
-           DirEnd;
-           it != DirEnd && !EC; it.increment(EC)) {
-        auto fileName = llvm::sys::path::filename(it->path());
-        if (fileName.startswith(".")) {
-          it.no_push();
-          continue;
-        }
-        includeRecoveryCache.insert({std::string(fileName), it->path()});
-      }
-    }
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!includeRecoveryCacheBuilt) {
+    buildIncludeRecoveryCache();
+    includeRecoveryCacheBuilt = true;
   }
   llvm::StringRef includeFileName = llvm::sys::path::filename(includeName);
   std::string resolved;
@@ -110,16 +274,9 @@ std::string ProjectManager::includeRecovery(llvm::StringRef includeName,
   auto range = includeRecoveryCache.equal_range(includeFileName);
   for (auto it = range.first; it != range.second; ++it) {
     llvm::StringRef candidate(it->second);
-    unsigned int suf_len = 0;
-    while (suf_len < std::min(candidate.size(), includeName.size())) {
-      if (candidate[candidate.size() - suf_len - 1] !=
-          includeName[candidate.size() - suf_len - 1])
-        break;
-      suf_len++;
-    }
     // Each paths part that are similar from the expected name are weighted 1000
-    // points f
-    int w = includeName.substr(candidate.size() - suf_len).count('/') * 1000;
+    // points (the file name is always similar)
+    int w = (commonSuffixComponents(candidate, includeName) - 1) * 1000;
     if (w + 1000 < weight)
       continue;
 
@@ -21,11 +21,20 @@
 
 #pragma once
 
+#include "refsdatabase.h"
+#include <llvm/ADT/StringMap.h>
 #include <llvm/ADT/StringRef.h>
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+class Manifest;
+class MemoryBudget;
+class PchCache;
+class RefsBundles;
+
 struct ProjectInfo {
   std::string name;
   std::string source_path;
@@ -62,19 +71,75 @@ struct ProjectManager {
 
   std::string outputPrefix;
   std::string dataPath;
+  // Directory of the .common and .coverage overlays (see --overlay-dir)
+  std::string overlayPath;
+  // Do not compute the expansions of the macros that link to their definition
+  // (see --lazy-macro-expansions)
+  bool lazyMacroExpansions = false;
+  // Number of threads writing the pages of a translation unit (see
+  // --page-jobs)
+  unsigned pageJobs = 1;
+  // The pages of the files with more lines are split in chunks of that many
+  // lines (see --chunk-lines). 0 if they are not split
+  unsigned chunkLines = 0;
+
+  // Set when generating incrementally
+  Manifest *manifest = nullptr;
+  // Set with --pch-cache
+  PchCache *pchCache = nullptr;
+  // Set with --max-memory
+  MemoryBudget *memoryBudget = nullptr;
+  // Set with --refs-bundles
+  RefsBundles *refsBundles = nullptr;
 
   // the file name need to be canonicalized
-  ProjectInfo *projectForFile(llvm::StringRef filename); // don't keep a cache
+  // The projects must not be added while other threads are looking up.
+  ProjectInfo *projectForFile(llvm::StringRef filename);
 
   // return true if the filename should be proesseded.
   // 'project' is the value returned by projectForFile
-  bool shouldProcess(llvm::StringRef filename, ProjectInfo *project);
+  // The files that were generated before are not processed again. (With
+  // --incremental, the pages of the outdated files were removed beforehand)
+  // When an 'owner' is given, the file is also claimed for that owner, so that
+  // other owners (running in other threads) will not process it as well until
+  // the claims are released.
+  bool shouldProcess(llvm::StringRef filename, ProjectInfo *project,
+                     const void *owner = nullptr);
+
+  // Release all the files claimed by 'owner' in shouldProcess
+  void releaseClaims(const void *owner);
 
   std::string includeRecovery(llvm::StringRef includeName,
                               llvm::StringRef from);
 
+  // Must be locked while appending to the shared index files in outputPrefix
+  // (fileIndex, otherIndex and fnSearch/)
+  std::mutex outputMutex;
+
+  // The content of refs/, written at the end of the run
+  RefsDatabase refsDatabase;
+
+  // The number of pages written so far
+  std::atomic<unsigned> generatedPages{0};
+
 private:
   static std::vector<ProjectInfo> systemProjects();
 
+  std::mutex mutex;
+  // html file name -> owner which is currently generating it
+  std::unordered_map<std::string, const void *> claimedFiles;
+  // file name -> paths of the files of the projects with that name, built the
+  // first time an include is not found. It is kept in <output>/.includeRecovery
+  // for the next runs, which only read again the directories that changed.
   std::unordered_multimap<std::string, std::string> includeRecoveryCache;
+  bool includeRecoveryCacheBuilt = false;
+  void buildIncludeRecoveryCache();
+
+  // A trie of the source paths of the projects, by path component. The first
+  // node is the root.
+  struct ProjectNode {
+    llvm::StringMap<unsigned> children; // component -> index in projectNodes
+    int project = -1;                   // index in projects
+  };
+  std::vector<ProjectNode> projectNodes;
 };
@@ -32,25 +32,25 @@
 #include <clang/Lex/Lexer.h>
 #include <llvm/Support/MemoryBuffer.h>
 
-/**
- * Lookup candidates function of name \a methodName within the QObject
- * derivative \a objClass its bases, or its private implementation
- */
-static llvm::SmallVector<clang::CXXMethodDecl *, 10>
-lookUpCandidates(const clang::CXXRecordDecl *objClass,
-                 llvm::StringRef methodName) {
-  llvm::SmallVector<clang::CXXMethodDecl *, 10> candidates;
+QtSupport::Cache::Methods &
+QtSupport::Cache::methods(const clang::CXXRecordDecl *objClass) {
+  auto found = classes.find(objClass);
+  if (found != classes.end())
+    return found->second;
+
+  Methods &methods = classes[objClass];
   clang::CXXMethodDecl *d_func = nullptr;
   auto classIt = objClass;
   while (classIt) {
-    if (!classIt->getDefinition())
+    if (!classIt->getDefinition()) {
+      d_func = nullptr;
       break;
+    }
 
     for (auto mi = classIt->method_begin(); mi != classIt->method_end(); ++mi) {
       if (!(*mi)->getIdentifier())
         continue;
-      if ((*mi)->getName() == methodName)
-        candidates.push_back(*mi);
+      methods.byName[(*mi)->getName()].push_back(*mi);
       if (!d_func && (*mi)->getName() == "d_func" &&
           !getResultType(*mi).isNull())
         d_func = *mi;
@@ -61,75 +61,45 @@ lookUpCandidates(const clang::CXXRecordDecl *objClass,
     classIt = classIt->getNumBases() == 0
                   ? nullptr
                   : classIt->bases_begin()->getType()->getAsCXXRecordDecl();
-
-    if (d_func && !classIt && candidates.empty()) {
-      classIt = getResultType(d_func)->getPointeeCXXRecordDecl();
-      d_func = nullptr;
-    }
   }
-  return candidates;
+  if (d_func)
+    methods.privateClass = getResultType(d_func)->getPointeeCXXRecordDecl();
+  return methods;
 }
 
 /**
- * \a obj is an expression to a type of an QObject (or pointer to) that is the
- * sender or the receiver \a method is an expression like SIGNAL(....)  or
- * SLOT(....)
- *
- * This function try to find the matching signal or slot declaration, and
- * register its use.
+ * Lookup candidates function of name \a methodName within the QObject
+ * derivative \a objClass its bases, or its private implementation
  */
-void QtSupport::handleSignalOrSlot(clang::Expr *obj, clang::Expr *method) {
-  if (!obj || !method)
-    return;
-  obj = obj->IgnoreImpCasts();
-  method = method->IgnoreImpCasts();
-  auto objType = obj->getType().getTypePtrOrNull();
-  if (!objType)
-    return;
-
-  const clang::CXXRecordDecl *objClass = objType->getPointeeCXXRecordDecl();
-  if (!objClass) {
-    // It can be a non-pointer if called like:  foo.connect(....);
-    objClass = objType->getAsCXXRecordDecl();
-    if (!objClass)
-      return;
-  }
-
-  const clang::StringLiteral *methodLiteral =
-      clang::dyn_cast<clang::StringLiteral>(method);
-  if (!methodLiteral) {
-    // try qFlagLocation
-    clang::CallExpr *flagLoc = clang::dyn_cast<clang::CallExpr>(method);
-
-    if (!flagLoc || flagLoc->getNumArgs() != 1 || !flagLoc->getDirectCallee() ||
-        flagLoc->getDirectCallee()->getName() != "qFlagLocation")
-      return;
-
-    methodLiteral = clang::dyn_cast<clang::StringLiteral>(
-        flagLoc->getArg(0)->IgnoreImpCasts());
-    if (!methodLiteral)
-      return;
-  }
-  if (methodLiteral->getCharByteWidth() != 1)
-    return;
-
-  auto signature = methodLiteral->getString().trim();
-  if (signature.size() < 4)
-    return;
-
-  if (signature.find('\0') != signature.npos) {
-    signature = signature.substr(0, signature.find('\0')).trim();
+static llvm::SmallVector<clang::CXXMethodDecl *, 10>
+lookUpCandidates(QtSupport::Cache &cache, const clang::CXXRecordDecl *objClass,
+                 llvm::StringRef methodName) {
+  while (objClass) {
+    auto &methods = cache.methods(objClass);
+    auto it = methods.byName.find(methodName);
+    if (it != methods.byName.end())
+      return {it->second.begin(), it->second.end()};
+    objClass = methods.privateClass;
   }
+  return {};
+}
 
+/**
+ * Finds the method of \a objClass whose signature is the content of a SIGNAL()
+ * or SLOT() string, or returns null.
+ */
+static clang::CXXMethodDecl *
+resolveSignature(QtSupport::Cache &cache, const clang::CXXRecordDecl *objClass,
+                 llvm::StringRef signature) {
   auto lParenPos = signature.find('(');
   auto rParenPos = signature.find(')');
   if (rParenPos == std::string::npos || rParenPos < lParenPos || lParenPos < 2)
-    return;
+    return nullptr;
 
   llvm::StringRef methodName = signature.slice(1, lParenPos).trim();
 
   // Try to find the method which match this name in the given class or bases.
-  auto candidates = lookUpCandidates(objClass, methodName);
+  auto candidates = lookUpCandidates(cache, objClass, methodName);
 
   clang::LangOptions lo;
   lo.CPlusPlus = true;
@@ -178,7 +148,7 @@ void QtSupport::handleSignalOrSlot(clang::Expr *obj, clang::Expr *method) {
     }
 
     if (searchPos == signature.size())
-      return;
+      return nullptr;
 
     llvm::StringRef argument =
         signature.substr(argPos, searchPos - argPos).trim();
@@ -252,7 +222,7 @@ void QtSupport::handleSignalOrSlot(clang::Expr *obj, clang::Expr *method) {
   }
 
   if (argPos != signature.size())
-    return;
+    return nullptr;
 
   // Remove candidates that needs more argument
   candidates.erase(
@@ -266,9 +236,75 @@ void QtSupport::handleSignalOrSlot(clang::Expr *obj, clang::Expr *method) {
       candidates.end());
 
   if (candidates.empty())
+    return nullptr;
+
+  return candidates.front();
+}
+
+/**
+ * \a obj is an expression to a type of an QObject (or pointer to) that is the
+ * sender or the receiver \a method is an expression like SIGNAL(....)  or
+ * SLOT(....)
+ *
+ * This function try to find the matching signal or slot declaration, and
+ * register its use.
+ */
+void QtSupport::handleSignalOrSlot(clang::Expr *obj, clang::Expr *method) {
+  if (!obj || !method)
+    return;
+  obj = obj->IgnoreImpCasts();
+  method = method->IgnoreImpCasts();
+  auto objType = obj->getType().getTypePtrOrNull();
+  if (!objType)
     return;
 
-  auto used = candidates.front();
+  const clang::CXXRecordDecl *objClass = objType->getPointeeCXXRecordDecl();
+  if (!objClass) {
+    // It can be a non-pointer if called like:  foo.connect(....);
+    objClass = objType->getAsCXXRecordDecl();
+    if (!objClass)
+      return;
+  }
+
+  const clang::StringLiteral *methodLiteral =
+      clang::dyn_cast<clang::StringLiteral>(method);
+  if (!methodLiteral) {
+    // try qFlagLocation
+    clang::CallExpr *flagLoc = clang::dyn_cast<clang::CallExpr>(method);
+
+    if (!flagLoc || flagLoc->getNumArgs() != 1 || !flagLoc->getDirectCallee() ||
+        flagLoc->getDirectCallee()->getName() != "qFlagLocation")
+      return;
+
+    methodLiteral = clang::dyn_cast<clang::StringLiteral>(
+        flagLoc->getArg(0)->IgnoreImpCasts());
+    if (!methodLiteral)
+      return;
+  }
+  if (methodLiteral->getCharByteWidth() != 1)
+    return;
+
+  auto signature = methodLiteral->getString().trim();
+  if (signature.size() < 4)
+    return;
+
+  if (signature.find('\0') != signature.npos) {
+    signature = signature.substr(0, signature.find('\0')).trim();
+  }
+
+  // The strings are spelled the same way by the SIGNAL and SLOT macros, so
+  // the ones of the same class are only resolved once
+  auto &signatures = annotator.qtCache.methods(objClass).signatures;
+  auto cached = signatures.find(signature);
+  clang::CXXMethodDecl *used;
+  if (cached != signatures.end()) {
+    used = cached->second;
+  } else {
+    used = resolveSignature(annotator.qtCache, objClass, signature);
+    signatures[signature] = used;
+  }
+  if (!used)
+    return;
 
   clang::SourceRange range = methodLiteral->getSourceRange();
   if (methodLiteral->getNumConcatenated() >= 2) {
@@ -329,7 +365,7 @@ void QtSupport::handleInvokeMethod(clang::Expr *obj, clang::Expr *method) {
     return;
 
   // Try to find the method which match this name in the given class or bases.
-  auto candidates = lookUpCandidates(objClass, methodName);
+  auto candidates = lookUpCandidates(annotator.qtCache, objClass, methodName);
   if (candidates.size() != 1)
     return;
   // FIXME: overloads resolution using the Q_ARG
@@ -21,11 +21,17 @@
 
 #pragma once
 
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringMap.h>
+#include <unordered_map>
+
 namespace clang {
 class CallExpr;
 class NamedDecl;
 class Expr;
 class CXXConstructExpr;
+class CXXMethodDecl;
+class CXXRecordDecl;
 } // namespace clang
 class Annotator;
 
@@ -41,6 +47,27 @@ struct QtSupport {
   void visitCallExpr(clang::CallExpr *e);
   void visitCXXConstructExpr(clang::CXXConstructExpr *e);
 
+  /* The methods of the classes used as sender or receiver, and the signatures
+   * already resolved. Kept by the Annotator for the whole translation unit, so
+   * the classes are only walked once. */
+  class Cache {
+  public:
+    struct Methods {
+      // name -> methods of the class and of its first bases
+      llvm::StringMap<llvm::SmallVector<clang::CXXMethodDecl *, 2>> byName;
+      // The private class returned by d_func(), looked up when the name is not
+      // in byName
+      const clang::CXXRecordDecl *privateClass = nullptr;
+      // SIGNAL() or SLOT() string -> the method it refers to (or null)
+      llvm::StringMap<clang::CXXMethodDecl *> signatures;
+    };
+    // Finds the classes the first time they are seen
+    Methods &methods(const clang::CXXRecordDecl *objClass);
+
+  private:
+    std::unordered_map<const clang::CXXRecordDecl *, Methods> classes;
+  };
+
 private:
   void handleSignalOrSlot(clang::Expr *obj, clang::Expr *method);
   void handleInvokeMethod(clang::Expr *obj, clang::Expr *method);
@@ -0,0 +1,152 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+
+#include "refsbundles.h"
+#include "filesystem.h"
+#include "generator.h"
+#include "outputfile.h"
+#include "stringbuilder.h"
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+RefsBundles::RefsBundles(std::string _outputPrefix)
+    : outputPrefix(std::move(_outputPrefix)),
+      listDir(outputPrefix % "/.refsBundles") {}
+
+void RefsBundles::addPage(const std::string &page,
+                          const std::vector<std::string> &refs) {
+  // One ref per line
+  std::string content;
+  for (const auto &ref : refs)
+    content %= ref % "\n";
+  std::string listFile = listDir % "/" % page;
+  create_directories(llvm::StringRef(listFile).rsplit('/').first);
+  if (auto error_code = write_file_atomically(listFile, content)) {
+    std::cerr << "Error writing " << listFile << ": " << error_code.message()
+              << std::endl;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  pending.insert(page);
+}
+
+void RefsBundles::touch(llvm::StringRef ref) {
+  std::lock_guard<std::mutex> lock(mutex);
+  touched.insert(ref);
+}
+
+bool RefsBundles::write(unsigned jobCount, bool all) {
+  std::vector<std::string> pages;
+  for (const auto &page : pending)
+    pages.push_back(page.getKey().str());
+
+  if (all || !touched.empty()) {
+    std::error_code EC;
+    for (llvm::sys::fs::recursive_directory_iterator it(listDir, EC), DirEnd;
+         it != DirEnd && !EC; it.increment(EC)) {
+      if (llvm::sys::fs::is_directory(it->path()))
+        continue;
+      std::string page =
+          llvm::StringRef(it->path()).substr(listDir.size() + 1).str();
+      if (pending.count(page))
+        continue;
+      if (!all) {
+        auto B = llvm::MemoryBuffer::getFile(it->path());
+        if (!B)
+          continue;
+        llvm::SmallVector<llvm::StringRef, 256> refs;
+        B.get()->getBuffer().split(refs, '\n', -1, false);
+        if (std::none_of(refs.begin(), refs.end(), [&](llvm::StringRef ref) {
+              return touched.count(ref);
+            }))
+          continue;
+      }
+      pages.push_back(std::move(page));
+    }
+  }
+  pending.clear();
+  touched.clear();
+
+  std::atomic<std::size_t> next(0);
+  std::atomic<bool> success(true);
+  auto worker = [&] {
+    for (std::size_t i = next++; i < pages.size(); i = next++) {
+      if (!writeBundle(pages[i]))
+        success = false;
+    }
+  };
+  jobCount = std::max(1u, std::min<unsigned>(jobCount, pages.size()));
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < jobCount; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (auto &t : threads)
+    t.join();
+  return success;
+}
+
+bool RefsBundles::writeBundle(const std::string &page) {
+  auto B = llvm::MemoryBuffer::getFile(std::string(listDir % "/" % page));
+  if (!B)
+    return false;
+  llvm::SmallVector<llvm::StringRef, 256> refs;
+  B.get()->getBuffer().split(refs, '\n', -1, false);
+
+  std::string bundle;
+  llvm::raw_string_ostream os(bundle);
+  os << '{';
+  bool first = true;
+  std::string content;
+  for (auto ref : refs) {
+    // The local symbols have no refs/ file
+    if (OutputFile::readFile(std::string(outputPrefix % "/refs/" % ref),
+                             content) ||
+        content.size() > MaxRefSize)
+      continue;
+    // The refs are listed by priority (see Generator::bundledRefs)
+    if (os.tell() + ref.size() + content.size() > MaxBundleSize)
+      break;
+    if (!first)
+      os << ',';
+    first = false;
+    Generator::writeJsonString(os, ref);
+    os << ':';
+    Generator::writeJsonString(os, content);
+  }
+  os << '}';
+  os.flush();
+
+  std::string filename = outputPrefix % "/" % page % ".refs";
+  create_directories(llvm::StringRef(filename).rsplit('/').first);
+  if (auto error_code = OutputFile::writeFile(filename, bundle)) {
+    std::cerr << "Error writing " << filename << ": " << error_code.message()
+              << std::endl;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,76 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/StringSet.h>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * The refs bundles of the pages, written with --refs-bundles
+ *
+ * The bundle of a page, <page>.refs next to <page>.html, is a JSON object with
+ * the content of the refs/ files of the symbols used in the page, by name of
+ * their refs/ file. The browser fetches it once instead of one refs/ file per
+ * hovered symbol. The refs bigger than MaxRefSize are left out of the
+ * bundles, and a bundle stops growing at MaxBundleSize (the refs of the
+ * symbols declared in the page come first): the browser fetches the other
+ * refs from refs/ when they are needed. The bundles are copies of the refs/
+ * files, so a ref takes space again in each page using it.
+ *
+ * The refs of each page are listed in <output>/.refsBundles/<page>, so that
+ * the bundles of the pages that are not generated again are updated when one
+ * of their refs changed.
+ */
+class RefsBundles {
+public:
+  explicit RefsBundles(std::string outputPrefix);
+
+  static const std::size_t MaxRefSize = 32 * 1024;
+  static const std::size_t MaxBundleSize = 256 * 1024;
+
+  // Records the refs (refs/ file names) used in a page that was generated
+  void addPage(const std::string &page, const std::vector<std::string> &refs);
+  // Records that the refs/ file of 'ref' (refs/ file name) changed
+  void touch(llvm::StringRef ref);
+
+  /**
+   * Writes the bundles of the pages added since the last call, and of the
+   * other pages that use a ref that was touched. With 'all', the bundles of
+   * all the listed pages are written.
+   * Must be called once the refs/ files are consolidated.
+   */
+  bool write(unsigned jobCount, bool all = false);
+
+private:
+  std::string outputPrefix;
+  std::string listDir;
+
+  std::mutex mutex;
+  llvm::StringSet<> pending;
+  llvm::StringSet<> touched;
+
+  bool writeBundle(const std::string &page);
+};
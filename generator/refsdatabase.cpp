@@ -0,0 +1,430 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#include "refsdatabase.h"
+#include "filesystem.h"
+#include "generator.h"
+#include "merger.h"
+#include "outputfile.h"
+#include "refsbundles.h"
+#include "stringbuilder.h"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+// The spill files are only read back on the same machine, so the integers are
+// stored in the native byte order.
+const uint32_t ChunkMagic = 0x46524243; // "CBRF"
+
+struct ChunkHeader {
+  uint32_t magic;
+  uint32_t stringCount;
+  uint32_t stringBytes;
+  uint32_t entryCount;
+};
+
+struct PackedEntry {
+  uint32_t ref;
+  uint32_t file;
+  uint32_t text;
+  uint32_t type;
+  uint32_t line;
+  uint32_t endLine;
+  int64_t value;
+  uint8_t kind;
+  uint8_t useType;
+  uint8_t flags;
+  uint8_t unused[5];
+};
+
+enum { MacroFlag = 1, BrokenFlag = 2 };
+
+unsigned partitionForRef(llvm::StringRef ref) {
+  return fnv1a(ref) % RefsDatabase::PartitionCount;
+}
+
+/* The key by which the entries of a refs/ file are sorted, extracted from the
+ * text of the entry, so the entries that were already in the file are sorted
+ * the same way. */
+struct SortKey {
+  int section;
+  llvm::StringRef file;
+  unsigned line;
+  llvm::StringRef text;
+  unsigned count;
+
+  explicit SortKey(llvm::StringRef text, unsigned count)
+      : section(0), line(0), text(text), count(count) {
+    llvm::StringRef head = text.substr(0, text.find('>'));
+    llvm::StringRef tag = head.substr(1, head.find_first_of(" /") - 1);
+    if (tag == "size")
+      section = 1;
+    else if (tag == "offset")
+      section = 2;
+    else if (tag == "doc")
+      section = 3;
+    else if (tag == "fun" || tag == "mbr" || tag == "smbr")
+      section = 4;
+    else if (tag != "use" && tag != "dec" && tag != "def" && tag != "ovr" &&
+             tag != "inh")
+      section = 5;
+    auto attr = [&](llvm::StringRef name) -> llvm::StringRef {
+      auto pos = head.find(name);
+      if (pos == llvm::StringRef::npos)
+        return {};
+      auto value = head.substr(pos + name.size());
+      return value.substr(0, value.find('\''));
+    };
+    file = attr(" f='");
+    attr(" l='").getAsInteger(10, line);
+  }
+
+  bool operator<(const SortKey &o) const {
+    if (section != o.section)
+      return section < o.section;
+    int c = file.compare(o.file);
+    if (c != 0)
+      return c < 0;
+    if (line != o.line)
+      return line < o.line;
+    return text < o.text;
+  }
+};
+
+// Merge the counts of the entries of one source into 'result'.
+// Each source (translation unit, or the existing refs/ file) already has all
+// the occurrences of an entry, so the entries emitted by several sources are
+// only kept once.
+void mergeCounts(llvm::StringMap<unsigned> &result,
+                 const llvm::StringMap<unsigned> &counts) {
+  for (const auto &it : counts) {
+    unsigned &count = result[it.getKey()];
+    count = std::max(count, it.getValue());
+  }
+}
+
+} // namespace
+
+uint32_t RefsDatabase::Chunk::Partition::intern(llvm::StringRef str) {
+  auto inserted = stringIds.insert({str, uint32_t(stringIds.size())});
+  if (inserted.second) {
+    uint32_t len = str.size();
+    strings.append(reinterpret_cast<const char *>(&len), sizeof(len));
+    strings.append(str.data(), str.size());
+  }
+  return inserted.first->getValue();
+}
+
+size_t RefsDatabase::Chunk::memoryUsage() const {
+  size_t result = partitions.capacity() * sizeof(partitions[0]);
+  for (const auto &partition : partitions) {
+    if (!partition)
+      continue;
+    // The keys of stringIds are copies of the strings
+    result += sizeof(Partition) + partition->strings.capacity() * 2 +
+              partition->entries.capacity() +
+              partition->stringIds.getNumBuckets() * 2 * sizeof(void *) +
+              partition->stringIds.size() *
+                  sizeof(llvm::StringMapEntry<uint32_t>);
+  }
+  return result;
+}
+
+void RefsDatabase::Chunk::add(llvm::StringRef ref, const Entry &entry) {
+  if (partitions.empty())
+    partitions.resize(PartitionCount);
+  auto &partition = partitions[partitionForRef(ref)];
+  if (!partition)
+    partition.reset(new Partition);
+
+  PackedEntry packed;
+  std::memset(&packed, 0, sizeof(packed));
+  packed.ref = partition->intern(ref);
+  packed.file = partition->intern(entry.file);
+  packed.text = partition->intern(entry.text);
+  packed.type = partition->intern(entry.type);
+  packed.line = entry.line;
+  packed.endLine = entry.endLine;
+  packed.value = entry.value;
+  packed.kind = entry.kind;
+  packed.useType = entry.useType;
+  packed.flags = (entry.macro ? MacroFlag : 0) | (entry.broken ? BrokenFlag : 0);
+  partition->entries.append(reinterpret_cast<const char *>(&packed),
+                            sizeof(packed));
+  partition->entryCount++;
+}
+
+RefsDatabase::RefsDatabase(std::string outputPrefix_)
+    : outputPrefix(std::move(outputPrefix_)),
+      spillDir(outputPrefix + "/.refsdb") {}
+
+RefsDatabase::~RefsDatabase() = default;
+
+void RefsDatabase::addChunk(const Chunk &chunk) {
+  if (chunk.empty())
+    return;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (spillFiles.empty()) {
+    spillFiles.resize(PartitionCount);
+    create_directories(spillDir);
+  }
+  for (unsigned i = 0; i < PartitionCount; ++i) {
+    const auto &partition = chunk.partitions[i];
+    if (!partition)
+      continue;
+    auto &file = spillFiles[i];
+    if (!file) {
+      std::string filename = spillDir % "/" % std::to_string(i);
+      std::error_code error_code;
+      file.reset(new llvm::raw_fd_ostream(filename, error_code,
+                                          llvm::sys::fs::F_Append));
+      if (error_code) {
+        std::cerr << "Error writing " << filename << ": "
+                  << error_code.message() << std::endl;
+        file.reset();
+        continue;
+      }
+    }
+    ChunkHeader header;
+    header.magic = ChunkMagic;
+    header.stringCount = partition->stringIds.size();
+    header.stringBytes = partition->strings.size();
+    header.entryCount = partition->entryCount;
+    file->write(reinterpret_cast<const char *>(&header), sizeof(header));
+    *file << partition->strings << partition->entries;
+    // One write per partition, and an interrupted run loses nothing
+    file->flush();
+  }
+}
+
+void RefsDatabase::render(llvm::raw_ostream &os, const Entry &entry) {
+  static const char *const tags[] = {"use", "dec", "def", "ovr", "inh"};
+  switch (entry.kind) {
+  case Entry::Use:
+  case Entry::Declaration:
+  case Entry::Definition:
+  case Entry::Override:
+  case Entry::Inherit:
+    os << "<" << tags[entry.kind] << " f='";
+    Generator::escapeAttr(os, entry.file);
+    os << "' l='" << entry.line << "'";
+    if (entry.endLine)
+      os << " ll='" << entry.endLine << "'";
+    if (entry.macro)
+      os << " macro='1'";
+    if (entry.broken)
+      os << " brk='1'";
+    if (entry.useType)
+      os << " u='" << entry.useType << "'";
+    if (!entry.text.empty()) {
+      bool isDecl = entry.kind == Entry::Declaration ||
+                    entry.kind == Entry::Definition;
+      os << (isDecl ? " type='" : " c='");
+      Generator::escapeAttr(os, entry.text);
+      os << "'";
+    }
+    os << "/>";
+    break;
+  case Entry::Size:
+    os << "<size>" << entry.value << "</size>";
+    break;
+  case Entry::Offset:
+    os << "<offset>" << entry.value << "</offset>";
+    break;
+  case Entry::Doc:
+    os << "<doc f='";
+    Generator::escapeAttr(os, entry.file);
+    os << "' l='" << entry.line << "'>";
+    Generator::escapeAttr(os, entry.text);
+    os << "</doc>";
+    break;
+  case Entry::Function:
+  case Entry::Member:
+  case Entry::StaticMember:
+    os << (entry.kind == Entry::Function
+               ? "<fun "
+               : entry.kind == Entry::Member ? "<mbr " : "<smbr ");
+    os << "r='" << Generator::EscapeAttr{entry.text} << "'";
+    if (entry.value != -1)
+      os << " o='" << entry.value << "'";
+    if (!entry.type.empty())
+      os << " t='" << Generator::EscapeAttr{entry.type} << "'";
+    os << "/>";
+    break;
+  }
+}
+
+void RefsDatabase::consolidate(unsigned jobCount) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    spillFiles.clear(); // flush and close them
+  }
+
+  std::vector<std::string> files;
+  std::error_code EC;
+  for (llvm::sys::fs::directory_iterator it(spillDir, EC), end;
+       it != end && !EC; it.increment(EC)) {
+    if (llvm::sys::path::filename(it->path()).startswith("."))
+      continue;
+    files.push_back(it->path());
+  }
+  if (files.empty())
+    return;
+  std::sort(files.begin(), files.end());
+  create_directories(llvm::Twine(outputPrefix, "/refs/_M"));
+
+  std::atomic<size_t> next(0);
+  auto worker = [&] {
+    for (size_t i = next++; i < files.size(); i = next++)
+      consolidatePartition(files[i]);
+  };
+  jobCount = std::max(1u, std::min<unsigned>(jobCount, files.size()));
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < jobCount; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (auto &t : threads)
+    t.join();
+}
+
+void RefsDatabase::consolidatePartition(const std::string &spillFile) {
+  auto buffer = llvm::MemoryBuffer::getFile(spillFile);
+  if (!buffer) {
+    std::cerr << "Error reading " << spillFile << ": "
+              << buffer.getError().message() << std::endl;
+    return;
+  }
+
+  // ref -> text of the entry -> number of occurrences
+  llvm::StringMap<llvm::StringMap<unsigned>> refs;
+
+  llvm::StringRef data = (*buffer)->getBuffer();
+  std::vector<llvm::StringRef> strings;
+  std::string text;
+  while (!data.empty()) {
+    ChunkHeader header;
+    if (data.size() < sizeof(header))
+      break;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != ChunkMagic ||
+        data.size() - sizeof(header) < header.stringBytes ||
+        (data.size() - sizeof(header) - header.stringBytes) /
+                sizeof(PackedEntry) <
+            header.entryCount)
+      break;
+    llvm::StringRef stringData =
+        data.substr(sizeof(header), header.stringBytes);
+    llvm::StringRef entryData =
+        data.substr(sizeof(header) + header.stringBytes,
+                    header.entryCount * sizeof(PackedEntry));
+    data = data.substr(sizeof(header) + header.stringBytes +
+                       header.entryCount * sizeof(PackedEntry));
+
+    strings.clear();
+    while (strings.size() < header.stringCount &&
+           stringData.size() >= sizeof(uint32_t)) {
+      uint32_t len;
+      std::memcpy(&len, stringData.data(), sizeof(len));
+      strings.push_back(stringData.substr(sizeof(len), len));
+      stringData = stringData.substr(sizeof(len) + len);
+    }
+    if (strings.size() < header.stringCount)
+      break;
+
+    llvm::StringMap<llvm::StringMap<unsigned>> chunkRefs;
+    for (uint32_t i = 0; i < header.entryCount; ++i) {
+      PackedEntry packed;
+      std::memcpy(&packed, entryData.data() + i * sizeof(packed),
+                  sizeof(packed));
+      if (packed.ref >= strings.size() || packed.file >= strings.size() ||
+          packed.text >= strings.size() || packed.type >= strings.size())
+        continue;
+      Entry entry;
+      entry.kind = static_cast<Entry::Kind>(packed.kind);
+      entry.useType = packed.useType;
+      entry.macro = packed.flags & MacroFlag;
+      entry.broken = packed.flags & BrokenFlag;
+      entry.file = strings[packed.file];
+      entry.line = packed.line;
+      entry.endLine = packed.endLine;
+      entry.text = strings[packed.text];
+      entry.type = strings[packed.type];
+      entry.value = packed.value;
+      text.clear();
+      llvm::raw_string_ostream os(text);
+      render(os, entry);
+      chunkRefs[strings[packed.ref]][os.str()]++;
+    }
+    for (const auto &it : chunkRefs)
+      mergeCounts(refs[it.getKey()], it.getValue());
+  }
+  if (!data.empty())
+    std::cerr << "Error: " << spillFile << " is corrupted" << std::endl;
+
+  llvm::SmallVector<llvm::StringRef, 64> existing;
+  std::vector<SortKey> entries;
+  for (auto &it : refs) {
+    std::string refFilename = it.getKey().str();
+    replace_invalid_filename_chars(refFilename);
+    std::string filename = outputPrefix % "/refs/" % refFilename;
+    if (bundles)
+      bundles->touch(refFilename);
+
+    std::string existingContent;
+    if (!OutputFile::readFile(filename, existingContent)) {
+      existing.clear();
+      splitRefEntries(existingContent, existing);
+      llvm::StringMap<unsigned> counts;
+      for (auto e : existing)
+        counts[e]++;
+      mergeCounts(it.getValue(), counts);
+    }
+
+    entries.clear();
+    for (const auto &e : it.getValue())
+      entries.emplace_back(e.getKey(), e.getValue());
+    std::sort(entries.begin(), entries.end());
+
+    std::error_code error_code;
+    OutputFile myfile(filename, error_code);
+    if (error_code) {
+      std::cerr << "Error writing ref file " << filename << ": "
+                << error_code.message() << std::endl;
+      continue;
+    }
+    for (const auto &e : entries) {
+      for (unsigned i = 0; i < e.count; ++i)
+        myfile << e.text << '\n';
+    }
+  }
+  llvm::sys::fs::remove(spillFile);
+}
@@ -0,0 +1,128 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#pragma once
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+class raw_fd_ostream;
+} // namespace llvm
+
+class RefsBundles;
+
+/**
+ * Collects the content of the refs/ directory during a run.
+ *
+ * Each translation unit fills a Chunk with its entries and adds it with
+ * addChunk(). The chunk is appended in a compact binary form to the spill files
+ * in <output>/.refsdb/ (one file per partition of the refs, so that a
+ * translation unit does one write per partition).
+ * consolidate() reads the spill files back, one partition at a time, and writes
+ * each refs/ file once, with its entries sorted and de-duplicated.
+ */
+class RefsDatabase {
+public:
+  struct Entry {
+    enum Kind : uint8_t {
+      Use,
+      Declaration,
+      Definition,
+      Override,
+      Inherit,
+      Size,
+      Offset,
+      Doc,
+      Function,     // <fun>: sub-ref
+      Member,       // <mbr>: sub-ref
+      StaticMember, // <smbr>: sub-ref
+    };
+    Kind kind = Use;
+    char useType = '\0'; // for Use: 'a', 'c', 'r', 'w', 'm' or '\0'
+    bool macro = false;
+    bool broken = false;  // The file was not in the compilation database
+    llvm::StringRef file; // html name of the file (project/path)
+    unsigned line = 0;
+    unsigned endLine = 0;  // 0 if it is the same as line
+    llvm::StringRef text;  // type or context, doc content, or the sub-ref
+    llvm::StringRef type;  // type of a sub-ref
+    int64_t value = -1;    // size, offset, or offset of a sub-ref
+
+    // Whether the entry has a 'f' attribute
+    bool hasFile() const { return kind < Size || kind == Doc; }
+  };
+
+  /* The entries of one translation unit */
+  class Chunk {
+  public:
+    void add(llvm::StringRef ref, const Entry &entry);
+    bool empty() const { return partitions.empty(); }
+    // An estimate of the memory used by the entries
+    size_t memoryUsage() const;
+
+  private:
+    friend class RefsDatabase;
+    struct Partition {
+      llvm::StringMap<uint32_t> stringIds;
+      std::string strings;
+      std::string entries;
+      uint32_t entryCount = 0;
+      uint32_t intern(llvm::StringRef str);
+    };
+    std::vector<std::unique_ptr<Partition>> partitions;
+  };
+
+  explicit RefsDatabase(std::string outputPrefix);
+  ~RefsDatabase();
+
+  void addChunk(const Chunk &chunk);
+
+  /**
+   * Writes the refs/ files from the spill files, merged with the refs/ files
+   * that already exist, and removes the spill files.
+   * Must not be called while translation units are processed.
+   */
+  void consolidate(unsigned jobCount = 1);
+
+  /* Writes the entry as it appears in the refs/ file (without the final '\n') */
+  static void render(llvm::raw_ostream &os, const Entry &entry);
+
+  // Number of spill files; the partition of a ref also does not depend on the
+  // run, so the spill files of an interrupted run can be consolidated later.
+  static const unsigned PartitionCount = 256;
+
+  // Set with --refs-bundles: told about the refs/ files that are written
+  RefsBundles *bundles = nullptr;
+
+private:
+  std::string outputPrefix;
+  std::string spillDir;
+  std::mutex mutex;
+  std::vector<std::unique_ptr<llvm::raw_fd_ostream>> spillFiles;
+
+  void consolidatePartition(const std::string &spillFile);
+};
@@ -0,0 +1,291 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#include "searchindex.h"
+#include "filesystem.h"
+#include "outputfile.h"
+#include "stringbuilder.h"
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/Support/FileSystem.h>
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const unsigned ShardSize = 256;
+const unsigned Symbols = 26 + 10 + 1; // letters, digits and '_'
+
+unsigned symbol(char c) {
+  if (c >= 'A' && c <= 'Z')
+    return c - 'A';
+  if (c >= 'a' && c <= 'z')
+    return c - 'a';
+  if (c >= '0' && c <= '9')
+    return 26 + c - '0';
+  return 36;
+}
+
+char symbolChar(unsigned s) {
+  return s < 26 ? 'a' + s : s < 36 ? '0' + s - 26 : '_';
+}
+
+// sorted by lowercase name, then by name and ref
+struct Entry {
+  std::string key;
+  llvm::StringRef line;
+  bool operator<(const Entry &other) const {
+    return std::tie(key, line) < std::tie(other.key, other.line);
+  }
+};
+
+llvm::StringRef nameOf(llvm::StringRef line) {
+  return line.substr(std::min(line.find('|') + 1, line.size()));
+}
+
+std::string humps(llvm::StringRef name) {
+  auto pos = name.rfind("::");
+  if (pos != llvm::StringRef::npos)
+    name = name.substr(pos + 2);
+  std::string result;
+  for (std::size_t i = 0; i < name.size(); ++i) {
+    char c = name[i];
+    bool isUpper = c >= 'A' && c <= 'Z';
+    if (i == 0 || (isUpper && !(name[i - 1] >= 'A' && name[i - 1] <= 'Z')) ||
+        (name[i - 1] == '_' && c != '_'))
+      result += c;
+  }
+  return result;
+}
+
+void addTrigrams(llvm::StringRef str, std::vector<unsigned> &trigrams) {
+  for (std::size_t i = 0; i + 3 <= str.size(); ++i) {
+    trigrams.push_back((symbol(str[i]) * Symbols + symbol(str[i + 1])) *
+                           Symbols +
+                       symbol(str[i + 2]));
+  }
+}
+
+void appendBase36(std::string &out, uint32_t value) {
+  char buffer[8];
+  int pos = sizeof(buffer);
+  do {
+    unsigned digit = value % 36;
+    buffer[--pos] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= 36;
+  } while (value);
+  out.append(buffer + pos, sizeof(buffer) - pos);
+}
+
+bool write(const std::string &path, llvm::StringRef content) {
+  if (auto error_code = OutputFile::writeFile(path, content)) {
+    std::cerr << "Error writing " << path << ": " << error_code.message()
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool read(const std::string &path, std::string &content) {
+  if (auto error_code = OutputFile::readFile(path, content)) {
+    std::cerr << "Error reading " << path << ": " << error_code.message()
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Creates the hidden directory in which 'name' is written again
+bool prepareIndex(llvm::StringRef outputPrefix, llvm::StringRef name,
+                  std::initializer_list<const char *> subdirs) {
+  std::string newIndex = outputPrefix % "/." % name % ".new";
+  llvm::sys::fs::remove_directories(newIndex);
+  for (const char *subdir : subdirs) {
+    if (auto error_code = create_directories(newIndex + "/" + subdir)) {
+      std::cerr << "Error creating " << newIndex << ": "
+                << error_code.message() << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Replaces the directory 'name' by the one created with prepareIndex
+bool replaceIndex(llvm::StringRef outputPrefix, llvm::StringRef name) {
+  std::string index = outputPrefix % "/" % name;
+  std::string newIndex = outputPrefix % "/." % name % ".new";
+  std::string oldIndex = outputPrefix % "/." % name % ".old";
+  llvm::sys::fs::remove_directories(oldIndex);
+  if (llvm::sys::fs::exists(index))
+    llvm::sys::fs::rename(index, oldIndex);
+  if (auto error_code = llvm::sys::fs::rename(newIndex, index)) {
+    std::cerr << "Error renaming " << newIndex << ": " << error_code.message()
+              << std::endl;
+    return false;
+  }
+  llvm::sys::fs::remove_directories(oldIndex);
+  return true;
+}
+
+// Same as the keys of fnSearch/
+char bucketChar(char c) {
+  if (c >= 'A' && c <= 'Z')
+    c = c - 'A' + 'a';
+  if (c < 'a' || c > 'z')
+    return '_';
+  return c;
+}
+
+} // namespace
+
+bool writeSearchIndex(llvm::StringRef outputPrefix) {
+  // All the lines of fnSearch/, without the duplicates
+  std::vector<std::string> contents;
+  std::error_code EC;
+  std::string fnSearch = outputPrefix % "/fnSearch";
+  for (llvm::sys::fs::directory_iterator it(fnSearch, EC), DirEnd;
+       it != DirEnd && !EC; it.increment(EC)) {
+    llvm::StringRef path = it->path();
+    llvm::StringRef logical = OutputFile::stripFormatSuffix(path);
+    if (logical != path && llvm::sys::fs::exists(logical))
+      continue; // The same file, compressed
+    contents.emplace_back();
+    if (!read(logical.str(), contents.back()))
+      return false;
+  }
+  std::vector<Entry> entries;
+  for (const auto &content : contents) {
+    llvm::SmallVector<llvm::StringRef, 256> lines;
+    llvm::StringRef(content).split(lines, '\n', -1, false);
+    for (auto line : lines)
+      entries.push_back({nameOf(line).lower(), line});
+  }
+  std::sort(entries.begin(), entries.end());
+  entries.erase(std::unique(entries.begin(), entries.end(),
+                            [](const Entry &a, const Entry &b) {
+                              return a.line == b.line;
+                            }),
+                entries.end());
+
+  std::vector<std::vector<uint32_t>> postings(Symbols * Symbols * Symbols);
+  std::vector<unsigned> trigrams;
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    trigrams.clear();
+    addTrigrams(entries[i].key, trigrams);
+    addTrigrams(humps(nameOf(entries[i].line)), trigrams);
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()),
+                   trigrams.end());
+    for (unsigned t : trigrams)
+      postings[t].push_back(i);
+  }
+
+  // Written next to the old one, which is replaced at the end
+  if (!prepareIndex(outputPrefix, "fnIndex", {"e", "t"}))
+    return false;
+  std::string newIndex = outputPrefix % "/.fnIndex.new";
+
+  bool success = true;
+  std::string content;
+  for (std::size_t shard = 0; shard * ShardSize < entries.size(); ++shard) {
+    content.clear();
+    for (std::size_t i = shard * ShardSize;
+         i < entries.size() && i < (shard + 1) * ShardSize; ++i)
+      content %= entries[i].line % "\n";
+    success &= write(newIndex % "/e/" % llvm::Twine(shard).str(), content);
+  }
+
+  std::string manifest = llvm::Twine(ShardSize).str() + "\n";
+  for (unsigned t = 0; t < postings.size(); ++t) {
+    const auto &posting = postings[t];
+    if (posting.empty())
+      continue;
+    char trigram[4] = {symbolChar(t / (Symbols * Symbols)),
+                       symbolChar(t / Symbols % Symbols),
+                       symbolChar(t % Symbols), '\0'};
+    content.clear();
+    uint32_t previous = 0;
+    for (uint32_t id : posting) {
+      if (!content.empty())
+        content += ',';
+      appendBase36(content, id - previous);
+      previous = id;
+    }
+    success &= write(newIndex % "/t/" % trigram, content);
+    manifest %= llvm::StringRef(trigram) % " " %
+                llvm::Twine(posting.size()).str() % "\n";
+  }
+  success &= write(newIndex % "/trigrams", manifest);
+  return success && replaceIndex(outputPrefix, "fnIndex");
+}
+
+bool writeFileIndex(llvm::StringRef outputPrefix) {
+  std::string content;
+  std::string fileIndex = outputPrefix % "/fileIndex";
+  if (OutputFile::fileExists(fileIndex) && !read(fileIndex, content))
+    return false;
+  llvm::SmallVector<llvm::StringRef, 256> files;
+  llvm::StringRef(content).split(files, '\n', -1, false);
+  std::sort(files.begin(), files.end());
+  files.erase(std::unique(files.begin(), files.end()), files.end());
+
+  if (!prepareIndex(outputPrefix, "fileTree", {"d", "n"}))
+    return false;
+  std::string newIndex = outputPrefix % "/.fileTree.new";
+
+  // The files are sorted, so the files of a directory are consecutive (the
+  // files of its sub directories may come in between)
+  llvm::StringMap<std::string> pages;
+  llvm::StringMap<std::string> buckets;
+  for (auto file : files) {
+    auto pos = file.rfind('/');
+    llvm::StringRef dir =
+        pos == llvm::StringRef::npos ? "." : file.substr(0, pos);
+    llvm::StringRef name = file.substr(pos + 1);
+    pages[dir] %= name % "\n";
+    char bucket[3] = {name.empty() ? '_' : bucketChar(name[0]),
+                      name.size() < 2 ? '_' : bucketChar(name[1]), '\0'};
+    buckets[bucket] %= file % "\n";
+  }
+
+  std::vector<llvm::StringRef> dirs;
+  for (const auto &page : pages)
+    dirs.push_back(page.getKey());
+  std::sort(dirs.begin(), dirs.end());
+
+  bool success = true;
+  std::string manifest;
+  for (std::size_t i = 0; i < dirs.size(); ++i) {
+    manifest %= dirs[i] % "\n";
+    success &= write(newIndex % "/d/" % llvm::Twine(i).str(), pages[dirs[i]]);
+  }
+  for (const auto &bucket : buckets)
+    success &= write(newIndex % "/n/" % bucket.getKey(), bucket.getValue());
+  success &= write(newIndex % "/dirs", manifest);
+  return success && replaceIndex(outputPrefix, "fileTree");
+}
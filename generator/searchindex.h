@@ -0,0 +1,63 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+
+/**
+ * Writes <output>/fnIndex/, the index used by the function search of the
+ * browser, from the content of <output>/fnSearch/ (which is what the
+ * translation units append to).
+ *
+ *  - fnIndex/e/<n>: The entries ("ref|qualified name"), sorted by name, by
+ *    shards of a fixed number of entries. An entry is identified by its index.
+ *  - fnIndex/t/<trigram>: The entries whose name contains the trigram, or whose
+ *    humps (the first letter of the words of the last component: "qsl" for
+ *    QStringList) contain it. Ascending indexes, delta-encoded in base 36 and
+ *    separated by ','.
+ *  - fnIndex/trigrams: The number of entries per shard on the first line, then
+ *    one line "<trigram> <count>" per trigram.
+ *
+ * The names are normalized for the trigrams: lower case letters and digits,
+ * all the other characters are '_'.
+ * The browser looks up the smallest postings of the trigrams of the query and
+ * fetches only the shards of the entries in their intersection. The queries of
+ * less than 3 characters are looked up in the fnSearch/ file of their first
+ * two letters instead, so fnSearch/ stays in the output.
+ */
+bool writeSearchIndex(llvm::StringRef outputPrefix);
+
+/**
+ * Writes <output>/fileTree/, the index of the generated files used by the
+ * browser, from the content of <output>/fileIndex (which is what the
+ * translation units append to). The files are sorted and without duplicates.
+ *
+ *  - fileTree/dirs: The directories that contain files, sorted, one per line
+ *    ("." for the files at the top). A directory is identified by its line.
+ *  - fileTree/d/<n>: The names of the files of the n-th directory.
+ *  - fileTree/n/<xx>: The paths of the files whose name starts with 'xx',
+ *    normalized like the keys of fnSearch/.
+ *
+ * The search line fetches the bucket of the name being typed, or the pages of
+ * the directories matching the path being typed; the folder tree of the index
+ * pages only fetches the pages of the directories that are opened.
+ */
+bool writeFileIndex(llvm::StringRef outputPrefix);
@@ -0,0 +1,254 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#include "stats.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+struct Stats::Record {
+  std::string file;
+  double wall = 0, cpu = 0;
+  double phaseWall[PhaseCount] = {};
+  double phaseCpu[PhaseCount] = {};
+  uint64_t counters[CounterCount] = {};
+
+  void add(const Record &other) {
+    for (int i = 0; i < PhaseCount; ++i) {
+      phaseWall[i] += other.phaseWall[i];
+      phaseCpu[i] += other.phaseCpu[i];
+    }
+    for (int i = 0; i < CounterCount; ++i)
+      counters[i] += other.counters[i];
+  }
+};
+
+bool Stats::isEnabled = false;
+
+namespace {
+
+const char *const phaseNames[] = {
+    "parse",    "traversal", "macroExpansion", "syntaxHighlight", "comments",
+    "generate", "refs",      "fnSearch",       "consolidate",     "indexes"};
+static_assert(sizeof(phaseNames) / sizeof(*phaseNames) == Stats::PhaseCount,
+              "a phase has no name");
+const char *const counterNames[] = {"tags", "references", "bytesWritten",
+                                    "filesEmitted", "skippedDecls"};
+static_assert(sizeof(counterNames) / sizeof(*counterNames) ==
+                  Stats::CounterCount,
+              "a counter has no name");
+
+double wallTime() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// The CPU time of the current thread
+double cpuTime() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+  return double(std::clock()) / CLOCKS_PER_SEC;
+}
+
+// The maximum resident set size of the process so far, in bytes
+uint64_t peakRss() {
+#ifndef _WIN32
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+  }
+#endif
+  return 0;
+}
+
+void writeString(llvm::raw_ostream &os, llvm::StringRef str) {
+  os << '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\')
+      os << '\\' << c;
+    else if (static_cast<unsigned char>(c) < 0x20)
+      os << "\\u" << llvm::format_hex_no_prefix(c, 4);
+    else
+      os << c;
+  }
+  os << '"';
+}
+
+void writeRecord(llvm::raw_ostream &os, const Stats::Record &record) {
+  os << llvm::format("\"wall\":%.6f,\"cpu\":%.6f,\"phases\":{", record.wall,
+                     record.cpu);
+  for (int i = 0; i < Stats::PhaseCount; ++i) {
+    os << (i ? "," : "") << '"' << phaseNames[i] << '"'
+       << llvm::format(":{\"wall\":%.6f,\"cpu\":%.6f}", record.phaseWall[i],
+                       record.phaseCpu[i]);
+  }
+  os << "},\"counters\":{";
+  for (int i = 0; i < Stats::CounterCount; ++i) {
+    os << (i ? "," : "") << '"' << counterNames[i]
+       << "\":" << record.counters[i];
+  }
+  os << "},\"peakRss\":" << peakRss();
+}
+
+// Protects all the following
+std::mutex mutex;
+std::unique_ptr<llvm::raw_fd_ostream> output;
+Stats::Record run;
+double runStart = 0;
+std::vector<std::pair<double, std::string>> translationUnits; // wall, file
+
+thread_local Stats::Record *current = nullptr;
+
+} // namespace
+
+bool Stats::enable(const std::string &filename) {
+  std::error_code error_code;
+  output.reset(
+      new llvm::raw_fd_ostream(filename, error_code, llvm::sys::fs::F_Text));
+  if (error_code) {
+    std::cerr << "Error opening " << filename << ": " << error_code.message()
+              << std::endl;
+    output.reset();
+    return false;
+  }
+  runStart = wallTime();
+  isEnabled = true;
+  return true;
+}
+
+void Stats::finish(std::size_t top) {
+  if (!isEnabled)
+    return;
+  std::lock_guard<std::mutex> lock(mutex);
+  run.wall = wallTime() - runStart;
+  run.cpu = double(std::clock()) / CLOCKS_PER_SEC;
+  *output << "{\"run\":true,\"translationUnits\":" << translationUnits.size()
+          << ',';
+  writeRecord(*output, run);
+  *output << "}\n";
+  output->close();
+  if (output->has_error()) {
+    std::cerr << "Error writing the stats" << std::endl;
+    output->clear_error();
+  }
+  output.reset();
+  isEnabled = false;
+
+  top = std::min(top, translationUnits.size());
+  std::partial_sort(translationUnits.begin(), translationUnits.begin() + top,
+                    translationUnits.end(),
+                    [](const std::pair<double, std::string> &a,
+                       const std::pair<double, std::string> &b) {
+                      return a.first > b.first;
+                    });
+  if (top)
+    llvm::errs() << "Slowest translation units:\n";
+  for (std::size_t i = 0; i < top; ++i) {
+    llvm::errs() << llvm::format("%10.3fs  ", translationUnits[i].first)
+                 << translationUnits[i].second << '\n';
+  }
+  llvm::errs() << llvm::format("Total: %.3fs, %.3fs CPU, peak RSS %llu MiB\n",
+                               run.wall, run.cpu,
+                               (unsigned long long)(peakRss() >> 20));
+}
+
+Stats::TranslationUnit::TranslationUnit(llvm::StringRef file) {
+  if (!isEnabled)
+    return;
+  record = new Record;
+  record->file = file.str();
+  record->wall = wallTime();
+  record->cpu = cpuTime();
+  previous = current;
+  current = record;
+}
+
+Stats::TranslationUnit::~TranslationUnit() {
+  if (!record)
+    return;
+  current = previous;
+  record->wall = wallTime() - record->wall;
+  record->cpu = cpuTime() - record->cpu;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (output) {
+    *output << "{\"file\":";
+    writeString(*output, record->file);
+    *output << ',';
+    writeRecord(*output, *record);
+    *output << "}\n";
+    run.add(*record);
+    translationUnits.push_back({record->wall, std::move(record->file)});
+  }
+  delete record;
+}
+
+Stats::Timer::Timer(Phase phase) : phase(phase) {
+  if (!isEnabled)
+    return;
+  running = true;
+  wallStart = wallTime();
+  cpuStart = cpuTime();
+}
+
+void Stats::Timer::stop() {
+  if (!running)
+    return;
+  running = false;
+  double wall = wallTime() - wallStart;
+  double cpu = cpuTime() - cpuStart;
+  if (current) {
+    current->phaseWall[phase] += wall;
+    current->phaseCpu[phase] += cpu;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  run.phaseWall[phase] += wall;
+  run.phaseCpu[phase] += cpu;
+}
+
+void Stats::count(Counter counter, uint64_t value) {
+  if (!isEnabled)
+    return;
+  if (current) {
+    current->counters[counter] += value;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  run.counters[counter] += value;
+}
@@ -0,0 +1,109 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * The instrumentation of the generation, enabled with --stats.
+ *
+ * The time spent in each phase and the counters are recorded for the
+ * translation unit processed by the current thread (see TranslationUnit), or
+ * for the whole run when no translation unit is being processed (as in the
+ * threads writing the pages with --page-jobs). Once a
+ * translation unit is done, it is written as a JSON line in the stats file.
+ * The phases are inclusive: the parsing contains the macro expansions, and the
+ * syntax highlighting contains the comments.
+ *
+ * When the stats are not enabled, the timers and counters do nothing.
+ */
+class Stats {
+public:
+  struct Record; // the phases and counters of a translation unit, or the run
+
+  enum Phase {
+    Parse,
+    Traversal,
+    MacroExpansion,
+    SyntaxHighlight,
+    Comments,
+    Generate,
+    Refs,
+    FnSearch,
+    Consolidate, // refs/, at the end of the run
+    Indexes,     // fnIndex/ and fileTree/, at the end of the run
+    PhaseCount
+  };
+  enum Counter {
+    Tags,
+    References,
+    BytesWritten,
+    FilesEmitted,
+    SkippedDecls, // not traversed as they are in files that are not processed
+    CounterCount
+  };
+
+  // Opens the stats file. Returns false and prints an error if it can't.
+  static bool enable(const std::string &filename);
+  static bool enabled() { return isEnabled; }
+
+  // Writes the JSON line of the whole run, and prints the 'top' translation
+  // units that took the most time.
+  static void finish(std::size_t top);
+
+  // Accounts the phases and counters to 'file' while this object lives, in
+  // the current thread.
+  class TranslationUnit {
+  public:
+    explicit TranslationUnit(llvm::StringRef file);
+    ~TranslationUnit();
+    TranslationUnit(const TranslationUnit &) = delete;
+    TranslationUnit &operator=(const TranslationUnit &) = delete;
+
+  private:
+    Record *record = nullptr;
+    Record *previous = nullptr;
+  };
+
+  // Adds the time from the construction until stop() or the destruction to
+  // the phase
+  class Timer {
+  public:
+    explicit Timer(Phase phase);
+    ~Timer() { stop(); }
+    void stop();
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+
+  private:
+    Phase phase;
+    bool running = false;
+    double wallStart = 0, cpuStart = 0;
+  };
+
+  static void count(Counter counter, uint64_t value = 1);
+
+private:
+  static bool isEnabled;
+};
@@ -0,0 +1,50 @@
+/****************************************************************************
+ * Copyright (C) 2026 Woboq GmbH
+ * https://woboq.com/codebrowser.html
+ *
+ * This file is part of the Woboq Code Browser.
+ *
+ * Commercial License Usage:
+ * Licensees holding valid commercial licenses provided by Woboq may use
+ * this file in accordance with the terms contained in a written agreement
+ * between the licensee and Woboq.
+ * For further information see https://woboq.com/codebrowser.html
+ *
+ * Alternatively, this work may be used under a Creative Commons
+ * Attribution-NonCommercial-ShareAlike 3.0 (CC-BY-NC-SA 3.0) License.
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/deed.en_US
+ * This license does not allow you to use the code browser to assist the
+ * development of your commercial software. If you intent to do so, consider
+ * purchasing a commercial licence.
+ ****************************************************************************/
+
+#pragma once
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <vector>
+
+/**
+ * Gives a compact id to each distinct string, so that the tables can be keyed
+ * and the strings stored by id. The strings are kept once, for the lifetime of
+ * the interner, and an id is valid as an index in vectors of size size().
+ * The id of the empty string is 0.
+ */
+class StringInterner {
+public:
+  StringInterner() { intern(llvm::StringRef()); }
+
+  unsigned intern(llvm::StringRef str) {
+    auto inserted = ids.insert({str, unsigned(strings.size())});
+    if (inserted.second)
+      strings.push_back(inserted.first->getKey());
+    return inserted.first->getValue();
+  }
+
+  llvm::StringRef operator[](unsigned id) const { return strings[id]; }
+  unsigned size() const { return strings.size(); }
+
+private:
+  llvm::StringMap<unsigned> ids;
+  std::vector<llvm::StringRef> strings; // the keys of 'ids', by id
+};